@@ -0,0 +1,320 @@
+// cfping-bench：IPUtils、CidrExpander、SockaddrBatch与PingResultModel的微基准
+// 每个基准输出一行JSON，便于在版本之间对比回归
+#include "iputils.h"
+#include "cidrexpander.h"
+#include "sockaddrbatch.h"
+#include "pingresultmodel.h"
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QStringList>
+#include <boost/asio/ip/tcp.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+volatile uint64_t g_sink = 0; // 防止编译器消除被测代码
+
+void consume(uint64_t value)
+{
+    g_sink = g_sink + value;
+}
+
+struct BenchOptions {
+    std::string filter;   // 只运行名称包含该子串的基准
+    int repeat = 5;       // 重复次数，报告中位数与最小值
+};
+
+// 运行一个基准：body返回本次执行的操作数
+void runBench(const BenchOptions& options, const char* name, const std::function<uint64_t()>& body)
+{
+    if (!options.filter.empty() && std::string(name).find(options.filter) == std::string::npos) {
+        return;
+    }
+
+    std::vector<double> nsPerOp;
+    uint64_t ops = 0;
+    for (int i = 0; i < options.repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        ops = body();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        nsPerOp.push_back(ops > 0 ? ns / ops : ns);
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    double median = nsPerOp[nsPerOp.size() / 2];
+
+    std::printf("{\"benchmark\":\"%s\",\"ops\":%llu,\"repeat\":%d,\"ns_per_op_median\":%.3f,"
+                "\"ns_per_op_min\":%.3f,\"ops_per_sec\":%.0f}\n",
+                name, static_cast<unsigned long long>(ops), options.repeat,
+                median, nsPerOp.front(), median > 0 ? 1e9 / median : 0.0);
+    std::fflush(stdout);
+}
+
+// 生成连续地址字符串
+QStringList makeAddresses(const QString& cidr, int count)
+{
+    return IPUtils::expandCIDR(cidr, count);
+}
+
+// 通过元对象调用模型的私有刷新槽，模拟定时器触发
+void flushModel(PingResultModel& model)
+{
+    QMetaObject::invokeMethod(&model, "processPendingUpdates", Qt::DirectConnection);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "usage: cfping-bench [--filter <substring>] [--repeat <n>]\n");
+            return 2;
+        }
+    }
+
+    constexpr int ADDRESS_COUNT = 100000;
+    const QStringList v4Strings = makeAddresses("10.0.0.0/8", ADDRESS_COUNT);
+    const QStringList v6Strings = makeAddresses("2606:4700::/96", ADDRESS_COUNT);
+
+    // 地址解析与格式化
+    runBench(options, "ip_parse_v4", [&]() {
+        uint64_t sum = 0;
+        for (const QString& ip : v4Strings) {
+            sum += IPUtils::stringToIP(ip).ipv4;
+        }
+        consume(sum);
+        return static_cast<uint64_t>(v4Strings.size());
+    });
+    runBench(options, "ip_parse_v6", [&]() {
+        uint64_t sum = 0;
+        for (const QString& ip : v6Strings) {
+            sum += IPUtils::stringToIP(ip).ipv6[15];
+        }
+        consume(sum);
+        return static_cast<uint64_t>(v6Strings.size());
+    });
+    runBench(options, "ip_format_v4", [&]() {
+        IPAddress ip(0x0A000000u);
+        uint64_t sum = 0;
+        for (int i = 0; i < ADDRESS_COUNT; ++i) {
+            sum += IPUtils::ipToString(ip).size();
+            ip = IPUtils::incrementIP(ip);
+        }
+        consume(sum);
+        return static_cast<uint64_t>(ADDRESS_COUNT);
+    });
+    runBench(options, "ip_format_v6", [&]() {
+        IPAddress ip = IPUtils::stringToIP("2606:4700::");
+        uint64_t sum = 0;
+        for (int i = 0; i < ADDRESS_COUNT; ++i) {
+            sum += IPUtils::ipToString(ip).size();
+            ip = IPUtils::incrementIP(ip);
+        }
+        consume(sum);
+        return static_cast<uint64_t>(ADDRESS_COUNT);
+    });
+
+    // 地址递增与比较
+    runBench(options, "increment_v4", [&]() {
+        constexpr uint64_t count = 10000000;
+        IPAddress ip(0u);
+        IPAddress end(static_cast<uint32_t>(count - 1));
+        uint64_t n = 0;
+        while (IPUtils::compareIP(ip, end) && n < count) {
+            ip = IPUtils::incrementIP(ip);
+            ++n;
+        }
+        consume(ip.ipv4);
+        return n;
+    });
+    runBench(options, "increment_v6", [&]() {
+        constexpr uint64_t count = 10000000;
+        auto range = IPUtils::cidrToRange("2606:4700::/104");
+        IPAddress ip = range.first;
+        uint64_t n = 0;
+        while (IPUtils::compareIP(ip, range.second) && n < count) {
+            ip = IPUtils::incrementIP(ip);
+            ++n;
+        }
+        consume(ip.ipv6[15]);
+        return n;
+    });
+
+    // 按地址族特化的范围遍历，只有整数运算（不含格式化）
+    runBench(options, "range_v4_/8", [&]() {
+        const AddressRange<IPv4Family> range{0x0A000000u, uint64_t(1) << 24, 1};
+        uint64_t sum = 0;
+        for (uint32_t value : range) {
+            sum += value;
+        }
+        consume(sum);
+        return range.count;
+    });
+    runBench(options, "range_v6_/104", [&]() {
+        const AddressRange<IPv6Family> range{IPv6Family::fromAddress(IPUtils::stringToIP("2606:4700::")),
+                                             uint64_t(1) << 24, 1};
+        UInt128 last = 0;
+        for (UInt128 value : range) {
+            last = value;
+        }
+        consume(static_cast<uint64_t>(IPv6Family::toBytes(last)[15]));
+        return range.count;
+    });
+
+    // CIDR展开
+    runBench(options, "expand_cidr_v4_/16", [&]() {
+        QStringList ips = IPUtils::expandCIDR("104.16.0.0/16");
+        consume(ips.size());
+        return static_cast<uint64_t>(ips.size());
+    });
+    runBench(options, "expand_cidr_v6_/112", [&]() {
+        QStringList ips = IPUtils::expandCIDR("2606:4700::/112");
+        consume(ips.size());
+        return static_cast<uint64_t>(ips.size());
+    });
+
+    // 批次生成（与PingWorker相同的批大小）
+    constexpr int WORKER_BATCH = 500;
+    runBench(options, "batch_v4_/12", [&]() {
+        CidrExpander expander;
+        expander.setCidrRanges({"104.16.0.0/12"});
+        uint64_t n = 0;
+        while (expander.hasMore()) {
+            n += expander.getNextBatch(WORKER_BATCH).size();
+        }
+        consume(n);
+        return n;
+    });
+    runBench(options, "batch_v6_/108", [&]() {
+        CidrExpander expander;
+        expander.setCidrRanges({"2606:4700::/108"});
+        uint64_t n = 0;
+        while (expander.hasMore()) {
+            n += expander.getNextBatch(WORKER_BATCH).size();
+        }
+        consume(n);
+        return n;
+    });
+    runBench(options, "batch_mixed_many_ranges", [&]() {
+        QStringList ranges;
+        for (int i = 0; i < 4096; ++i) {
+            ranges.append(QString("10.%1.%2.0/24").arg(i / 256).arg(i % 256));
+        }
+        CidrExpander expander;
+        expander.setCidrRanges(ranges);
+        uint64_t n = 0;
+        while (expander.hasMore()) {
+            n += expander.getNextBatch(WORKER_BATCH).size();
+        }
+        consume(n);
+        return n;
+    });
+
+    // 扫描引擎在调度锁内只领取地址段，展开在各工作线程上进行：
+    // chunk_claim只计领取的开销，chunk_expand为单个线程展开同样地址的开销
+    constexpr uint64_t ENGINE_CHUNK = 64;
+    runBench(options, "chunk_claim_v4_/12", [&]() {
+        CidrExpander expander;
+        expander.setCidrRanges({"104.16.0.0/12"});
+        ScanChunk chunk;
+        uint64_t n = 0;
+        while (expander.takeChunk(ENGINE_CHUNK, chunk)) {
+            n += chunk.count;
+        }
+        consume(n);
+        return n;
+    });
+    runBench(options, "chunk_expand_v4_/12", [&]() {
+        CidrExpander expander;
+        expander.setCidrRanges({"104.16.0.0/12"});
+        ScanChunk chunk;
+        uint64_t n = 0;
+        while (expander.takeChunk(ENGINE_CHUNK, chunk)) {
+            for (uint32_t value : AddressRange<IPv4Family>{chunk.first.ipv4, chunk.count, chunk.stride}) {
+                n += static_cast<uint64_t>(IPv4Family::toString(value).size() > 0);
+            }
+        }
+        consume(n);
+        return n;
+    });
+
+    // 引擎展开地址段时按批生成首个端口的套接字地址：SIMD与逐个填写对比，
+    // endpoint_v4_asio为逐个经过ip::address构造端点的原做法
+    constexpr std::size_t SOCKADDR_BATCH = 64;
+    constexpr uint64_t SOCKADDR_COUNT = uint64_t(1) << 22;
+    runBench(options, "sockaddr_v4_scalar", [&]() {
+        sockaddr_in addresses[SOCKADDR_BATCH];
+        uint64_t sum = 0;
+        for (uint64_t done = 0; done < SOCKADDR_COUNT; done += SOCKADDR_BATCH) {
+            SockaddrBatch::fillV4Scalar(0x0A000000u + static_cast<uint32_t>(done), 1, 443, addresses, SOCKADDR_BATCH);
+            sum += addresses[SOCKADDR_BATCH - 1].sin_addr.s_addr;
+        }
+        consume(sum);
+        return SOCKADDR_COUNT;
+    });
+    runBench(options, SockaddrBatch::vectorized() ? "sockaddr_v4_simd" : "sockaddr_v4_simd_unavailable", [&]() {
+        sockaddr_in addresses[SOCKADDR_BATCH];
+        uint64_t sum = 0;
+        for (uint64_t done = 0; done < SOCKADDR_COUNT; done += SOCKADDR_BATCH) {
+            SockaddrBatch::fillV4(0x0A000000u + static_cast<uint32_t>(done), 1, 443, addresses, SOCKADDR_BATCH);
+            sum += addresses[SOCKADDR_BATCH - 1].sin_addr.s_addr;
+        }
+        consume(sum);
+        return SOCKADDR_COUNT;
+    });
+    runBench(options, "sockaddr_v6", [&]() {
+        sockaddr_in6 addresses[SOCKADDR_BATCH];
+        const UInt128 base = IPv6Family::fromAddress(IPUtils::stringToIP("2606:4700::"));
+        uint64_t sum = 0;
+        for (uint64_t done = 0; done < SOCKADDR_COUNT; done += SOCKADDR_BATCH) {
+            SockaddrBatch::fillV6(IPv6Family::advance(base, done), 1, 443, addresses, SOCKADDR_BATCH);
+            sum += addresses[SOCKADDR_BATCH - 1].sin6_addr.s6_addr[15];
+        }
+        consume(sum);
+        return SOCKADDR_COUNT;
+    });
+    runBench(options, "endpoint_v4_asio", [&]() {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < SOCKADDR_COUNT; ++i) {
+            boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4(0x0A000000u + static_cast<uint32_t>(i)), 443);
+            sum += endpoint.size();
+        }
+        consume(sum);
+        return SOCKADDR_COUNT;
+    });
+
+    // 结果模型更新：按真实节奏每批5000条刷新一次
+    for (int count : {1000, 10000, 100000, 1000000}) {
+        std::string name = "model_update_" + std::to_string(count);
+        runBench(options, name.c_str(), [&]() {
+            PingResultModel model;
+            constexpr int FLUSH_EVERY = 5000;
+            for (int i = 0; i < count; ++i) {
+                double latency = static_cast<double>((i * 7919) % 100000) / 100.0;
+                model.addResult(PingResult(v4Strings[i % v4Strings.size()], latency, true));
+                if ((i + 1) % FLUSH_EVERY == 0) {
+                    flushModel(model);
+                }
+            }
+            flushModel(model);
+            consume(model.rowCount());
+            return static_cast<uint64_t>(count);
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,531 @@
+// cfping-loadtest：在本地回环目标农场上端到端运行PingWorker
+// 报告探测吞吐、每次探测的CPU开销、峰值内存以及排序准确度，输出一行JSON；
+// 指定--speed-top时扫描结束后对延迟最低的K个地址测速，报告测得带宽与注入限速的一致率
+//
+// 目标农场在子进程中运行，父进程的rusage只包含扫描器自身的开销。
+// 127.0.0.0/8在Linux上整体路由到lo，任意127.x.y.z可直接监听；
+// IPv6除::1外需要先添加AnyIP路由，例如：
+//   ip -6 route add local fd00:cf::/112 dev lo
+//
+// --sweep不启动农场：范围内的全部连接改发到127.0.0.1（端口上没有监听时立即被拒绝），
+// 可以安全地扫描0.0.0.0/0，核对每个地址都有结果且峰值内存不超过--max-rss
+#include "pingworker.h"
+#include "scanengine.h"
+#include "eventlog.h"
+#include "iputils.h"
+#include "loopbackfarm.h"
+#include "speedtest.h"
+#include "socketfactory.h"
+#include "threadplacement.h"
+#include <QCoreApplication>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+struct LoadTestOptions {
+    QStringList cidrs{"127.20.0.0/20"};  // 目标农场地址段
+    int port = 18080;
+    int refusePercent = 10;   // 不监听的地址比例
+    int dropPercent = 10;     // 丢弃SYN的地址比例
+    int delayMaxMs = 50;      // 注入延迟上限
+    int threads = 4;          // 扫描线程数
+    int concurrency = 1000;   // 最大并发
+    int timeoutMs = 500;      // 连接超时
+    int farmThreads = 2;      // 农场线程数
+    unsigned seed = 1;
+    ProbeType probeType = ProbeType::Tcp; // 探测方式，农场按相同方式应答
+    QString host = "cloudflare.com";      // HTTP Host / TLS SNI
+    bool abortiveClose = false; // 成功后以RST关闭
+    int speedTop = 0;           // 扫描后测速的地址数，0为不测速
+    int speedParallel = 2;      // 测速并发
+    uint64_t speedBytes = 4 * 1024 * 1024; // 每个地址的下载字节数
+    int rateMaxKBps = 0;        // 注入限速上限（KB/s），0为不限速
+    ThreadPlacement placement;  // 扫描线程的CPU绑定，比较多次运行的速率时使用
+    bool sweep = false;         // 全部连接改发到回环地址，不建立逐地址的目标
+    long maxRssMb = 256;        // 扫掠模式允许的峰值内存
+};
+
+// HTTP模式下分配给目标的机房代码
+const char* const FARM_COLOS[] = {"HKG", "NRT", "SJC", "LAX", "SIN", "FRA"};
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: cfping-loadtest [--cidr <range>]... [--port <n>] [--refuse <pct>] [--drop <pct>]\n"
+                 "                       [--delay-max <ms>] [--threads <n>] [--concurrency <n>]\n"
+                 "                       [--timeout <ms>] [--farm-threads <n>] [--seed <n>]\n"
+                 "                       [--http | --tls] [--host <name>] [--rst]\n"
+                 "                       [--speed-top <k>] [--speed-parallel <n>] [--speed-bytes <n>]\n"
+                 "                       [--rate-max <KB/s>] [--cpus <auto|node:N|list>]\n"
+                 "       cfping-loadtest --sweep [--cidr <range>]... [--max-rss <MB>] [--port <n>]\n"
+                 "                       [--threads <n>] [--concurrency <n>] [--timeout <ms>] [--cpus ...]\n");
+}
+
+bool parseOptions(int argc, char* argv[], LoadTestOptions& options)
+{
+    bool customCidr = false;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* arg = argv[i];
+        const char* value = nullptr;
+        if (std::strcmp(arg, "--cidr") == 0 && (value = next())) {
+            if (!customCidr) options.cidrs.clear();
+            customCidr = true;
+            options.cidrs.append(QString::fromLocal8Bit(value));
+        } else if (std::strcmp(arg, "--port") == 0 && (value = next())) {
+            options.port = std::atoi(value);
+        } else if (std::strcmp(arg, "--refuse") == 0 && (value = next())) {
+            options.refusePercent = std::atoi(value);
+        } else if (std::strcmp(arg, "--drop") == 0 && (value = next())) {
+            options.dropPercent = std::atoi(value);
+        } else if (std::strcmp(arg, "--delay-max") == 0 && (value = next())) {
+            options.delayMaxMs = std::atoi(value);
+        } else if (std::strcmp(arg, "--cpus") == 0 && (value = next())) {
+            if (!ThreadPlacement::parse(QString::fromLocal8Bit(value), options.placement)) return false;
+        } else if (std::strcmp(arg, "--threads") == 0 && (value = next())) {
+            options.threads = std::max(1, std::atoi(value));
+        } else if (std::strcmp(arg, "--concurrency") == 0 && (value = next())) {
+            options.concurrency = std::max(1, std::atoi(value));
+        } else if (std::strcmp(arg, "--timeout") == 0 && (value = next())) {
+            options.timeoutMs = std::max(1, std::atoi(value));
+        } else if (std::strcmp(arg, "--farm-threads") == 0 && (value = next())) {
+            options.farmThreads = std::max(1, std::atoi(value));
+        } else if (std::strcmp(arg, "--seed") == 0 && (value = next())) {
+            options.seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--http") == 0) {
+            options.probeType = ProbeType::Http;
+        } else if (std::strcmp(arg, "--tls") == 0) {
+            options.probeType = ProbeType::Tls;
+        } else if (std::strcmp(arg, "--host") == 0 && (value = next())) {
+            options.host = QString::fromLocal8Bit(value);
+        } else if (std::strcmp(arg, "--sweep") == 0) {
+            options.sweep = true;
+        } else if (std::strcmp(arg, "--max-rss") == 0 && (value = next())) {
+            options.maxRssMb = std::max(1L, std::atol(value));
+        } else if (std::strcmp(arg, "--rst") == 0) {
+            options.abortiveClose = true;
+        } else if (std::strcmp(arg, "--speed-top") == 0 && (value = next())) {
+            options.speedTop = std::max(0, std::atoi(value));
+        } else if (std::strcmp(arg, "--speed-parallel") == 0 && (value = next())) {
+            options.speedParallel = std::max(1, std::atoi(value));
+        } else if (std::strcmp(arg, "--speed-bytes") == 0 && (value = next())) {
+            options.speedBytes = std::max<uint64_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--rate-max") == 0 && (value = next())) {
+            options.rateMaxKBps = std::max(0, std::atoi(value));
+        } else {
+            return false;
+        }
+    }
+    return options.port > 0 && options.port <= 65535;
+}
+
+// 按种子为每个地址确定行为与延迟，父子进程各自生成相同的结果
+std::vector<FarmTarget> buildTargets(const LoadTestOptions& options, QStringList& addresses)
+{
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> delay(0, std::max(0, options.delayMaxMs));
+    std::uniform_int_distribution<int> colo(0, static_cast<int>(std::size(FARM_COLOS)) - 1);
+    std::uniform_int_distribution<int> rate(std::max(1, options.rateMaxKBps / 10), std::max(1, options.rateMaxKBps));
+
+    std::vector<FarmTarget> targets;
+    for (const QString& cidr : options.cidrs) {
+        for (const QString& ip : IPUtils::expandCIDR(cidr)) {
+            boost::system::error_code ec;
+            auto address = boost::asio::ip::make_address(ip.toStdString(), ec);
+            if (ec) continue;
+
+            FarmTarget target;
+            target.address = address;
+            int roll = percent(rng);
+            if (roll < options.refusePercent) {
+                target.behaviour = TargetBehaviour::Refuse;
+            } else if (roll < options.refusePercent + options.dropPercent) {
+                target.behaviour = TargetBehaviour::Drop;
+            } else {
+                target.behaviour = TargetBehaviour::Accept;
+                target.delayMs = delay(rng);
+                if (options.probeType == ProbeType::Http) target.colo = FARM_COLOS[colo(rng)];
+                if (options.rateMaxKBps > 0) target.rateKBps = rate(rng);
+            }
+            targets.push_back(target);
+            addresses.append(ip);
+        }
+    }
+    return targets;
+}
+
+// 农场应答方式：测速需要HTTP下载，TCP探测时农场也按HTTP模式运行（不发请求的连接直接关闭）
+FarmMode farmMode(const LoadTestOptions& options)
+{
+    if (options.probeType == ProbeType::Tls) return FarmMode::Tls;
+    if (options.probeType == ProbeType::Http || options.speedTop > 0) return FarmMode::Http;
+    return FarmMode::Tcp;
+}
+
+// 子进程：运行目标农场，直到父进程关闭控制管道
+[[noreturn]] void runFarm(const LoadTestOptions& options, const std::vector<FarmTarget>& targets,
+                          int readyFd, int controlFd)
+{
+    // 大量监听与并发连接都需要提高文件描述符限制
+    SocketFactory::raiseFileLimit();
+    LoopbackFarm farm(static_cast<uint16_t>(options.port));
+    farm.setMode(farmMode(options));
+    for (const FarmTarget& target : targets) {
+        farm.addTarget(target);
+    }
+
+    std::string error;
+    char status = farm.start(options.farmThreads, &error) ? 1 : 0;
+    if (!status) {
+        std::fprintf(stderr, "farm: %s\n", error.c_str());
+    }
+    if (write(readyFd, &status, 1) != 1 || !status) {
+        _exit(1);
+    }
+    close(readyFd);
+
+    char byte;
+    while (read(controlFd, &byte, 1) > 0) {
+    }
+    farm.stop();
+    _exit(0);
+}
+
+double cpuSeconds(const rusage& usage)
+{
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+long peakRssKb(const rusage& usage)
+{
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// 扫掠：直接向引擎提交任务，结果只计数，不保留逐地址的结构，内存只随并发数与线程数增长；
+// 每个地址都有结果且峰值内存不超过上限时返回0
+int runSweep(const LoadTestOptions& options, int argc, char* argv[])
+{
+    SocketFactory::raiseFileLimit();
+    QCoreApplication app(argc, argv);
+    EventLog::setLevel(LogLevel::Warning);
+
+    ScanEngine engine(options.threads, options.placement);
+    ThreadPlacement::bindCurrentThread(engine.otherCpus());
+    std::fprintf(stderr, "%s\n", engine.placementReport().toLocal8Bit().constData());
+
+    ScanJobSpec spec;
+    spec.cidrRanges = options.cidrs;
+    spec.timeoutMs = options.timeoutMs;
+    spec.maxConcurrentTasks = options.concurrency;
+    spec.ports = {static_cast<uint16_t>(options.port)};
+    spec.probeType = options.probeType;
+    spec.hostName = options.host;
+    spec.abortiveClose = options.abortiveClose;
+    spec.loopbackTarget = "127.0.0.1";
+
+    std::atomic<uint64_t> results{0};
+    std::atomic<uint64_t> successes{0};
+    std::mutex reportMutex;
+    auto lastReport = std::chrono::steady_clock::now();
+    ScanJobSinks sinks;
+    sinks.onResult = [&](const ProbeResult& result) {
+        results.fetch_add(1, std::memory_order_relaxed);
+        if (result.success) successes.fetch_add(1, std::memory_order_relaxed);
+    };
+    // 每10秒输出一次进度；最终快照可能来自另一个线程
+    sinks.onProgress = [&](const ScanJobStats& stats) {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        auto now = std::chrono::steady_clock::now();
+        if (!stats.final && now - lastReport < std::chrono::seconds(10)) return;
+        lastReport = now;
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        std::fprintf(stderr, "%llu / %llu  %.0f/s  rss %ld KB\n",
+                     static_cast<unsigned long long>(stats.completed), static_cast<unsigned long long>(stats.total),
+                     stats.probesPerSecond, peakRssKb(usage));
+    };
+    sinks.onFinished = [](bool) {};
+
+    rusage usageBefore{};
+    getrusage(RUSAGE_SELF, &usageBefore);
+    auto startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<ScanJob> job = engine.submit(std::move(spec), std::move(sinks));
+    job->wait();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    rusage usageAfter{};
+    getrusage(RUSAGE_SELF, &usageAfter);
+
+    const ScanJobStats stats = job->stats();
+    const long peakKb = peakRssKb(usageAfter);
+    const bool complete = stats.completed == stats.total && results.load() == stats.total;
+    const bool bounded = peakKb <= options.maxRssMb * 1024;
+    std::printf("{\"mode\":\"sweep\",\"total\":%llu,\"completed\":%llu,\"results\":%llu,\"successes\":%llu,"
+                "\"threads\":%d,\"concurrency\":%d,\"elapsed_s\":%.3f,\"probes_per_sec\":%.0f,"
+                "\"cpu_us_per_probe\":%.3f,\"peak_rss_kb\":%ld,\"max_rss_kb\":%ld,"
+                "\"complete\":%s,\"bounded\":%s,\"cpus\":\"%s\"}\n",
+                static_cast<unsigned long long>(stats.total), static_cast<unsigned long long>(stats.completed),
+                static_cast<unsigned long long>(results.load()), static_cast<unsigned long long>(successes.load()),
+                options.threads, options.concurrency, elapsed, elapsed > 0 ? results.load() / elapsed : 0.0,
+                results.load() > 0 ? (cpuSeconds(usageAfter) - cpuSeconds(usageBefore)) * 1e6 / results.load() : 0.0,
+                peakKb, options.maxRssMb * 1024, complete ? "true" : "false", bounded ? "true" : "false",
+                options.placement.toString().toUtf8().constData());
+    return complete && bounded ? 0 : 1;
+}
+
+// 成对一致率：测得值与注入值顺序一致的比例（注入值相同的对不计）
+double rankingConcordance(const std::vector<std::pair<int, double>>& samples)
+{
+    uint64_t concordant = 0;
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        for (std::size_t j = i + 1; j < samples.size(); ++j) {
+            if (samples[i].first == samples[j].first) continue;
+            bool injected = samples[i].first < samples[j].first;
+            bool measured = samples[i].second < samples[j].second;
+            concordant += injected == measured ? 1 : 0;
+            ++total;
+        }
+    }
+    return total > 0 ? static_cast<double>(concordant) / total : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    LoadTestOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    if (options.sweep) {
+        return runSweep(options, argc, argv);
+    }
+
+    QStringList addresses;
+    std::vector<FarmTarget> targets = buildTargets(options, addresses);
+    if (targets.empty()) {
+        std::fprintf(stderr, "no target addresses\n");
+        return 2;
+    }
+
+    // 在创建任何线程之前启动农场子进程
+    int readyPipe[2];
+    int controlPipe[2];
+    if (pipe(readyPipe) != 0 || pipe(controlPipe) != 0) {
+        std::perror("pipe");
+        return 1;
+    }
+    pid_t farmPid = fork();
+    if (farmPid < 0) {
+        std::perror("fork");
+        return 1;
+    }
+    if (farmPid == 0) {
+        close(readyPipe[0]);
+        close(controlPipe[1]);
+        runFarm(options, targets, readyPipe[1], controlPipe[0]);
+    }
+    close(readyPipe[1]);
+    close(controlPipe[0]);
+
+    char status = 0;
+    if (read(readyPipe[0], &status, 1) != 1 || !status) {
+        std::fprintf(stderr, "target farm failed to start\n");
+        close(controlPipe[1]);
+        waitpid(farmPid, nullptr, 0);
+        return 1;
+    }
+    close(readyPipe[0]);
+
+    SocketFactory::raiseFileLimit();
+    QCoreApplication app(argc, argv);
+    EventLog::setLevel(LogLevel::Warning);
+
+    // 地址 -> 目标下标
+    QHash<QString, int> targetIndex;
+    targetIndex.reserve(addresses.size());
+    for (int i = 0; i < addresses.size(); ++i) {
+        targetIndex.insert(addresses[i], i);
+    }
+
+    std::vector<double> measured(targets.size(), -1.0);
+    std::vector<char> reported(targets.size(), 0);
+    std::vector<QString> colos(targets.size());
+    uint64_t results = 0;
+
+    // 引擎先于计时创建，测得的是热引擎上的扫描开销
+    ScanEngine engine(options.threads, options.placement);
+    ThreadPlacement::bindCurrentThread(engine.otherCpus());
+    std::fprintf(stderr, "%s\n", engine.placementReport().toLocal8Bit().constData());
+    PingWorker worker(engine);
+    worker.setSettings(options.timeoutMs, options.concurrency, {static_cast<uint16_t>(options.port)});
+    worker.setProbeType(options.probeType, options.host);
+    worker.setAbortiveClose(options.abortiveClose);
+    QObject::connect(&worker, &PingWorker::pingResult, &app, [&](const ProbeResult& result) {
+        auto it = targetIndex.constFind(result.ip);
+        if (it == targetIndex.constEnd()) return;
+        reported[it.value()] = 1;
+        measured[it.value()] = result.success ? result.latencyMs : -1.0;
+        colos[it.value()] = result.colo;
+        ++results;
+    });
+
+    // 测速结果：目标下标 -> Mbit/s，失败为-1
+    std::vector<double> speeds(targets.size(), -1.0);
+    std::vector<char> speedReported(targets.size(), 0);
+    SpeedTestWorker speedWorker;
+    QObject::connect(&speedWorker, &SpeedTestWorker::speedResult, &app, [&](const SpeedTestResult& result) {
+        auto it = targetIndex.constFind(result.ip);
+        if (it == targetIndex.constEnd()) return;
+        speedReported[it.value()] = 1;
+        speeds[it.value()] = result.success ? result.mbps : -1.0;
+    });
+    QObject::connect(&speedWorker, &SpeedTestWorker::logMessage, &app, [](const QString& message) {
+        std::fprintf(stderr, "%s\n", message.toLocal8Bit().constData());
+    });
+    QObject::connect(&speedWorker, &SpeedTestWorker::finished, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+
+    // 扫描开销只统计到扫描结束，测速阶段单独计时
+    std::chrono::steady_clock::time_point endTime;
+    std::chrono::steady_clock::time_point speedStart;
+    rusage usageAfter{};
+    SocketHeadroom headroom;
+    QObject::connect(&worker, &PingWorker::finished, &app, [&]() {
+        endTime = std::chrono::steady_clock::now();
+        getrusage(RUSAGE_SELF, &usageAfter);
+        headroom = SocketFactory::headroom();
+        if (options.speedTop <= 0) {
+            app.quit();
+            return;
+        }
+
+        std::vector<int> candidates;
+        for (std::size_t i = 0; i < measured.size(); ++i) {
+            if (measured[i] >= 0.0) candidates.push_back(static_cast<int>(i));
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](int a, int b) { return measured[a] < measured[b]; });
+        if (static_cast<int>(candidates.size()) > options.speedTop) candidates.resize(options.speedTop);
+
+        SpeedTestSpec spec;
+        for (int index : candidates) {
+            spec.targets.append(SpeedTestTarget{addresses[index], measured[index]});
+        }
+        spec.url = QString("%1://%2:%3/__down?bytes=%4")
+                       .arg(options.probeType == ProbeType::Tls ? "https" : "http")
+                       .arg(options.host).arg(options.port).arg(options.speedBytes);
+        spec.parallelism = options.speedParallel;
+        spec.timeoutMs = options.timeoutMs;
+        speedStart = std::chrono::steady_clock::now();
+        speedWorker.start(spec);
+    });
+
+    rusage usageBefore{};
+    getrusage(RUSAGE_SELF, &usageBefore);
+    auto startTime = std::chrono::steady_clock::now();
+
+    QTimer::singleShot(0, &worker, [&worker, &options]() {
+        worker.startPing(options.cidrs);
+    });
+    app.exec();
+    auto speedEnd = std::chrono::steady_clock::now();
+
+    close(controlPipe[1]);
+    waitpid(farmPid, nullptr, 0);
+
+    // 可达性：Accept应成功，Drop/Refuse应失败
+    uint64_t expectedCounts[3] = {0, 0, 0};
+    uint64_t correct = 0;
+    uint64_t coloCorrect = 0;
+    std::vector<std::pair<int, double>> ranked;
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        expectedCounts[static_cast<int>(targets[i].behaviour)]++;
+        bool expectSuccess = targets[i].behaviour == TargetBehaviour::Accept;
+        bool success = measured[i] >= 0.0;
+        if (reported[i] && expectSuccess == success) ++correct;
+        if (success && expectSuccess) {
+            ranked.emplace_back(targets[i].delayMs, measured[i]);
+            if (colos[i] == QString::fromStdString(targets[i].colo)) ++coloCorrect;
+        }
+    }
+
+    // 测速：注入限速与测得带宽的一致率，中位带宽
+    uint64_t speedTested = 0;
+    std::vector<double> speedValues;
+    std::vector<std::pair<int, double>> speedRanked;
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        if (!speedReported[i]) continue;
+        ++speedTested;
+        if (speeds[i] < 0.0) continue;
+        speedValues.push_back(speeds[i]);
+        if (targets[i].rateKBps > 0) speedRanked.emplace_back(targets[i].rateKBps, speeds[i]);
+    }
+    double speedMedian = 0.0;
+    if (!speedValues.empty()) {
+        std::nth_element(speedValues.begin(), speedValues.begin() + speedValues.size() / 2, speedValues.end());
+        speedMedian = speedValues[speedValues.size() / 2];
+    }
+    double speedElapsed = options.speedTop > 0 ? std::chrono::duration<double>(speedEnd - speedStart).count() : 0.0;
+
+    double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+    double cpu = cpuSeconds(usageAfter) - cpuSeconds(usageBefore);
+    long peakKb = peakRssKb(usageAfter);
+
+    // TCP模式下注入的延迟在内核完成握手之后，测得的延迟与它无关，一致率没有意义，输出null
+    char rankingText[16] = "null";
+    if (options.probeType != ProbeType::Tcp) {
+        std::snprintf(rankingText, sizeof(rankingText), "%.4f", rankingConcordance(ranked));
+    }
+
+    std::printf("{\"targets\":%zu,\"accept\":%llu,\"drop\":%llu,\"refuse\":%llu,"
+                "\"threads\":%d,\"concurrency\":%d,\"timeout_ms\":%d,"
+                "\"results\":%llu,\"elapsed_s\":%.3f,\"probes_per_sec\":%.0f,"
+                "\"cpu_us_per_probe\":%.3f,\"peak_rss_kb\":%ld,"
+                "\"reachability_accuracy\":%.4f,\"ranking_concordance\":%s,"
+                "\"mode\":\"%s\",\"colo_accuracy\":%.4f,"
+                "\"speed_tested\":%llu,\"speed_success\":%zu,\"speed_elapsed_s\":%.3f,"
+                "\"speed_median_mbps\":%.1f,\"throughput_concordance\":%.4f,"
+                "\"close\":\"%s\",\"fd_limit\":%lld,\"time_wait_after\":%lld,\"cpus\":\"%s\"}\n",
+                targets.size(),
+                static_cast<unsigned long long>(expectedCounts[static_cast<int>(TargetBehaviour::Accept)]),
+                static_cast<unsigned long long>(expectedCounts[static_cast<int>(TargetBehaviour::Drop)]),
+                static_cast<unsigned long long>(expectedCounts[static_cast<int>(TargetBehaviour::Refuse)]),
+                options.threads, options.concurrency, options.timeoutMs,
+                static_cast<unsigned long long>(results), elapsed,
+                elapsed > 0 ? results / elapsed : 0.0,
+                results > 0 ? cpu * 1e6 / results : 0.0,
+                peakKb,
+                static_cast<double>(correct) / targets.size(),
+                rankingText,
+                options.probeType == ProbeType::Http ? "http"
+                : options.probeType == ProbeType::Tls ? "tls" : "tcp",
+                options.probeType != ProbeType::Http || ranked.empty() ? 0.0 : static_cast<double>(coloCorrect) / ranked.size(),
+                static_cast<unsigned long long>(speedTested), speedValues.size(), speedElapsed,
+                speedMedian, rankingConcordance(speedRanked),
+                options.abortiveClose ? "rst" : "fin",
+                static_cast<long long>(headroom.fdLimit), static_cast<long long>(headroom.timeWait),
+                options.placement.toString().toUtf8().constData());
+    return 0;
+}
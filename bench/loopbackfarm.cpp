@@ -0,0 +1,273 @@
+#include "loopbackfarm.h"
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <string_view>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+LoopbackFarm::LoopbackFarm(uint16_t port)
+    : m_port(port)
+{
+}
+
+LoopbackFarm::~LoopbackFarm()
+{
+    stop();
+}
+
+void LoopbackFarm::addTarget(const FarmTarget& target)
+{
+    m_targets.push_back(target);
+}
+
+// 打开监听：Accept正常监听，Drop监听后占满队列，Refuse不监听
+bool LoopbackFarm::start(int threadCount, std::string* error)
+{
+    if (m_mode == FarmMode::Tls && !createTlsContext(error)) {
+        return false;
+    }
+
+    try {
+        for (const FarmTarget& target : m_targets) {
+            if (target.behaviour == TargetBehaviour::Refuse) continue;
+
+            boost::asio::ip::tcp::endpoint endpoint(target.address, m_port);
+            auto acceptor = std::make_unique<boost::asio::ip::tcp::acceptor>(m_ioContext);
+            acceptor->open(endpoint.protocol());
+            acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+            acceptor->bind(endpoint);
+
+            if (target.behaviour == TargetBehaviour::Drop) {
+                // 最小队列且从不accept，填满后新的SYN会被丢弃
+                acceptor->listen(0);
+                if (!saturateBacklog(endpoint)) {
+                    if (error) *error = "failed to saturate backlog of " + target.address.to_string();
+                    return false;
+                }
+            } else {
+                acceptor->listen(boost::asio::socket_base::max_listen_connections);
+                boost::asio::co_spawn(m_ioContext, acceptLoop(*acceptor, target), boost::asio::detached);
+            }
+            m_acceptors.push_back(std::move(acceptor));
+        }
+    } catch (const boost::system::system_error& e) {
+        if (error) *error = e.what();
+        return false;
+    }
+
+    for (int i = 0; i < std::max(1, threadCount); ++i) {
+        m_threads.emplace_back([this]() { m_ioContext.run(); });
+    }
+    return true;
+}
+
+void LoopbackFarm::stop()
+{
+    m_ioContext.stop();
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) thread.join();
+    }
+    m_threads.clear();
+    m_fillers.clear();
+    m_acceptors.clear();
+}
+
+// 生成临时的P-256密钥与自签名证书，只允许TLS 1.3
+bool LoopbackFarm::createTlsContext(std::string* error)
+{
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    bool generated = keyContext && EVP_PKEY_keygen_init(keyContext) > 0 &&
+                     EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) > 0 &&
+                     EVP_PKEY_keygen(keyContext, &key) > 0;
+    EVP_PKEY_CTX_free(keyContext);
+
+    X509* certificate = generated ? X509_new() : nullptr;
+    bool ready = false;
+    if (certificate) {
+        X509_set_version(certificate, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+        X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+        X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 3600);
+        X509_NAME* name = X509_get_subject_name(certificate);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>("cfping-loadtest"), -1, -1, 0);
+        X509_set_issuer_name(certificate, name);
+        X509_set_pubkey(certificate, key);
+        ready = X509_sign(certificate, key, EVP_sha256()) > 0;
+    }
+
+    if (ready) {
+        m_tlsContext = std::make_unique<boost::asio::ssl::context>(boost::asio::ssl::context::tls_server);
+        SSL_CTX* native = m_tlsContext->native_handle();
+        SSL_CTX_set_min_proto_version(native, TLS1_3_VERSION);
+        ready = SSL_CTX_use_certificate(native, certificate) == 1 &&
+                  SSL_CTX_use_PrivateKey(native, key) == 1;
+    }
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+
+    if (!ready && error) *error = "failed to create self-signed TLS certificate";
+    return ready;
+}
+
+// 用非阻塞连接占满监听队列，直到新的连接在100ms内无法完成
+bool LoopbackFarm::saturateBacklog(const boost::asio::ip::tcp::endpoint& endpoint)
+{
+    constexpr int MAX_FILLERS = 16;
+    for (int i = 0; i < MAX_FILLERS; ++i) {
+        auto socket = std::make_unique<boost::asio::ip::tcp::socket>(m_ioContext);
+        socket->open(endpoint.protocol());
+        socket->non_blocking(true);
+
+        // asio的同步connect即使在非阻塞模式下也会等待完成，这里直接调用系统connect
+        if (::connect(socket->native_handle(), endpoint.data(), static_cast<socklen_t>(endpoint.size())) == 0) {
+            m_fillers.push_back(std::move(socket));
+            continue;
+        }
+        if (errno != EINPROGRESS) {
+            return false;
+        }
+
+        pollfd pfd{};
+        pfd.fd = socket->native_handle();
+        pfd.events = POLLOUT;
+        if (::poll(&pfd, 1, 100) == 0) {
+            return true; // 此连接的SYN已被丢弃，队列已满
+        }
+        m_fillers.push_back(std::move(socket));
+    }
+    return false;
+}
+
+// 接受连接循环；target引用m_targets中的元素，start之后不再修改
+boost::asio::awaitable<void> LoopbackFarm::acceptLoop(boost::asio::ip::tcp::acceptor& acceptor, const FarmTarget& target)
+{
+    auto executor = co_await boost::asio::this_coro::executor;
+    for (;;) {
+        auto [ec, socket] = co_await acceptor.async_accept(boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (ec == boost::asio::error::operation_aborted) co_return;
+        if (ec) continue;
+        boost::asio::co_spawn(executor, respond(std::move(socket), target), boost::asio::detached);
+    }
+}
+
+namespace {
+
+constexpr std::size_t DOWNLOAD_CHUNK = 16 * 1024; // 下载正文每次写出的块大小
+
+// 下载正文的内容无关紧要，所有连接共用一块只读数据
+const std::array<char, DOWNLOAD_CHUNK>& downloadBlock()
+{
+    static const std::array<char, DOWNLOAD_CHUNK> block = [] {
+        std::array<char, DOWNLOAD_CHUNK> data;
+        for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>('a' + i % 26);
+        return data;
+    }();
+    return block;
+}
+
+// 从请求行中取出/__down?bytes=N的N，不是下载请求时返回false
+bool parseDownloadRequest(std::string_view request, uint64_t& bytes)
+{
+    constexpr std::string_view prefix = "GET /__down?bytes=";
+    if (request.substr(0, prefix.size()) != prefix) return false;
+    bytes = 0;
+    std::size_t i = prefix.size();
+    if (i >= request.size() || request[i] < '0' || request[i] > '9') return false;
+    for (; i < request.size() && request[i] >= '0' && request[i] <= '9'; ++i) {
+        bytes = bytes * 10 + static_cast<uint64_t>(request[i] - '0');
+    }
+    return true;
+}
+
+} // namespace
+
+template <typename Stream>
+boost::asio::awaitable<void> LoopbackFarm::serveHttp(Stream& stream, const FarmTarget& target, bool delayResponse)
+{
+    std::array<char, 1024> request;
+    std::size_t used = 0;
+    bool complete = false;
+    while (used < request.size() && !complete) {
+        auto [ec, n] = co_await stream.async_read_some(
+            boost::asio::buffer(request.data() + used, request.size() - used),
+            boost::asio::as_tuple(boost::asio::use_awaitable));
+        used += n;
+        complete = std::string_view(request.data(), used).find("\r\n\r\n") != std::string_view::npos;
+        if (ec) break;
+    }
+    if (!complete) co_return;
+
+    auto executor = co_await boost::asio::this_coro::executor;
+    boost::asio::steady_timer timer(executor);
+    if (delayResponse && target.delayMs > 0) {
+        timer.expires_after(std::chrono::milliseconds(target.delayMs));
+        co_await timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable));
+    }
+
+    uint64_t bytes = 0;
+    if (!parseDownloadRequest(std::string_view(request.data(), used), bytes)) {
+        std::string body = "fl=0f0\nh=loopback\nip=" + target.address.to_string() +
+                           "\nvisit_scheme=http\ncolo=" + target.colo + "\nhttp=http/1.1\n";
+        std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " +
+                               std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        co_await boost::asio::async_write(stream, boost::asio::buffer(response),
+                                          boost::asio::as_tuple(boost::asio::use_awaitable));
+        co_return;
+    }
+
+    std::string header = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " +
+                         std::to_string(bytes) + "\r\nConnection: close\r\n\r\n";
+    auto [headerError, headerWritten] = co_await boost::asio::async_write(
+        stream, boost::asio::buffer(header), boost::asio::as_tuple(boost::asio::use_awaitable));
+    if (headerError) co_return;
+
+    // 限速：每写完一块，等到按速率应当写完这些字节的时刻再继续
+    const auto& block = downloadBlock();
+    const auto started = std::chrono::steady_clock::now();
+    uint64_t sent = 0;
+    while (sent < bytes) {
+        std::size_t chunk = static_cast<std::size_t>(std::min<uint64_t>(block.size(), bytes - sent));
+        auto [ec, n] = co_await boost::asio::async_write(stream, boost::asio::buffer(block.data(), chunk),
+                                                         boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (ec) co_return;
+        sent += n;
+        if (target.rateKBps > 0 && sent < bytes) {
+            timer.expires_at(started + std::chrono::microseconds(sent * 1000 / static_cast<uint64_t>(target.rateKBps)));
+            co_await timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable));
+        }
+    }
+}
+
+// TCP模式按注入延迟保持连接后关闭；HTTP模式读完请求头，延迟后应答；TLS模式延迟后完成握手再按HTTP应答
+boost::asio::awaitable<void> LoopbackFarm::respond(boost::asio::ip::tcp::socket socket, const FarmTarget& target)
+{
+    if (m_mode == FarmMode::Http) {
+        co_await serveHttp(socket, target, true);
+    } else {
+        if (target.delayMs > 0) {
+            boost::asio::steady_timer timer(socket.get_executor());
+            timer.expires_after(std::chrono::milliseconds(target.delayMs));
+            co_await timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable));
+        }
+        if (m_mode == FarmMode::Tls) {
+            boost::asio::ssl::stream<boost::asio::ip::tcp::socket&> stream(socket, *m_tlsContext);
+            auto [ec] = co_await stream.async_handshake(boost::asio::ssl::stream_base::server,
+                                                        boost::asio::as_tuple(boost::asio::use_awaitable));
+            if (!ec) co_await serveHttp(stream, target, false);
+        }
+    }
+    boost::system::error_code ec;
+    socket.close(ec);
+}
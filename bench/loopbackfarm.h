@@ -0,0 +1,76 @@
+#ifndef LOOPBACKFARM_H
+#define LOOPBACKFARM_H
+
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 本地目标的行为
+enum class TargetBehaviour {
+    Accept,  // 正常监听，接受后按注入延迟响应
+    Drop,    // 监听队列被占满，SYN被内核丢弃（表现为超时）
+    Refuse   // 不监听，内核直接回RST（表现为拒绝）
+};
+
+// 接受连接后的应答方式
+enum class FarmMode {
+    Tcp,   // 按注入延迟保持连接后关闭
+    Http,  // 读取请求后按注入延迟返回/cdn-cgi/trace风格的响应，/__down?bytes=N返回N字节正文
+    Tls    // 按注入延迟后用自签名证书完成TLS 1.3握手，之后在加密连接上按HTTP模式应答
+};
+
+// 一个本地目标地址及其注入的行为
+struct FarmTarget {
+    boost::asio::ip::address address;
+    TargetBehaviour behaviour = TargetBehaviour::Accept;
+    int delayMs = 0; // 接受连接后到响应之前的延迟
+    std::string colo; // HTTP模式下trace响应中的机房代码
+    int rateKBps = 0; // 下载正文的限速（KB/s），0为不限
+};
+
+// 回环目标农场：在大量127.x.y.z（以及已配置AnyIP路由的IPv6）地址上监听，
+// 模拟延迟、丢包与拒绝，供端到端吞吐测试使用，不访问外网
+class LoopbackFarm
+{
+public:
+    explicit LoopbackFarm(uint16_t port);
+    ~LoopbackFarm();
+
+    LoopbackFarm(const LoopbackFarm&) = delete;
+    LoopbackFarm& operator=(const LoopbackFarm&) = delete;
+
+    void addTarget(const FarmTarget& target);
+    const std::vector<FarmTarget>& targets() const { return m_targets; }
+
+    // 在start之前设置
+    void setMode(FarmMode mode) { m_mode = mode; }
+
+    // 打开全部监听并启动线程，失败时返回false并写入错误信息
+    bool start(int threadCount, std::string* error = nullptr);
+    void stop();
+
+private:
+    boost::asio::awaitable<void> acceptLoop(boost::asio::ip::tcp::acceptor& acceptor, const FarmTarget& target);
+    boost::asio::awaitable<void> respond(boost::asio::ip::tcp::socket socket, const FarmTarget& target);
+    // 在明文或TLS连接上读取一个请求并应答，delayResponse为true时在应答前注入延迟
+    template <typename Stream>
+    boost::asio::awaitable<void> serveHttp(Stream& stream, const FarmTarget& target, bool delayResponse);
+    bool saturateBacklog(const boost::asio::ip::tcp::endpoint& endpoint);
+    bool createTlsContext(std::string* error);
+
+    uint16_t m_port;
+    FarmMode m_mode = FarmMode::Tcp;
+    std::unique_ptr<boost::asio::ssl::context> m_tlsContext; // TLS模式的服务端上下文
+    std::vector<FarmTarget> m_targets;
+    boost::asio::io_context m_ioContext;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> m_acceptors;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> m_fillers; // 占满丢包目标监听队列的连接
+    std::vector<std::thread> m_threads;
+};
+
+#endif // LOOPBACKFARM_H
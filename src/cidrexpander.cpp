@@ -1,5 +1,8 @@
 #include "cidrexpander.h"
 #include "iputils.h"
+#include "cidrfile.h"
+#include <algorithm>
+#include <tuple>
 
 // 构造函数，初始化成员变量
 CidrExpander::CidrExpander(QObject *parent)
@@ -13,72 +16,233 @@ CidrExpander::CidrExpander(QObject *parent)
 void CidrExpander::setCidrRanges(const QStringList& cidrRanges)
 {
     // 清空已有的范围
-    while (!m_ranges.empty()) {
-        m_ranges.pop();
-    }
+    m_ranges = decltype(m_ranges)();
+    m_source.reset();
+    m_sourceOffset = 0;
     
     m_totalIPs = 0;
     m_processedIPs = 0;
+    m_position = 0;
+    m_sequence = 0;
+    
+    // 连续块分片先对全部输入计数，确定本片的序号范围
+    if (m_shard.isActive() && m_shard.mode == ScanShard::Mode::Block) {
+        uint64_t total = 0;
+        for (const QString& cidr : cidrRanges) {
+            total += rangeCount(toCidr(cidr));
+        }
+        setBlockBounds(total);
+    }
     
-    // 处理每个CIDR范围
+    // 处理每个CIDR范围，跳过无效的CIDR
     for (const QString& cidr : cidrRanges) {
-        if (!IPUtils::isValidCIDR(cidr)) {
-            continue; // 跳过无效的CIDR
+        addRange(toCidr(cidr));
+    }
+}
+
+// 设置文件输入，第一批范围在首次取批次时解析
+void CidrExpander::setSource(std::shared_ptr<CidrFileSource> source)
+{
+    setCidrRanges(QStringList());
+    m_source = std::move(source);
+    if (m_shard.isActive() && m_shard.mode == ScanShard::Mode::Block) {
+        // 界面在统计完成后才提交连续块分片的任务；其他直接向引擎提交文件的调用方在此同步统计
+        uint64_t total = 0;
+        if (!m_source->addressCount(total)) {
+            total = m_source->summarize().addressCount;
         }
-        
-        // 先计算IP数量
-        uint64_t count = IPUtils::getCIDRIPCount(cidr);
-        if (count == UINT64_MAX) {
-            // IPv6范围太大，设置为合理的上限
-            count = 1000000; // 可根据需要调整
-        } else if (count == 0) {
-            // 无效的CIDR，跳过
-            continue;
+        setBlockBounds(total);
+    }
+}
+
+// 按地址总数划分连续块：第i块为[total*i/N, total*(i+1)/N)，拆开计算避免乘法溢出
+void CidrExpander::setBlockBounds(uint64_t total)
+{
+    std::tie(m_blockBegin, m_blockEnd) = m_shard.blockRange(total);
+}
+
+bool CidrExpander::selectShard(uint64_t first, uint64_t count, uint64_t& offset, uint64_t& selected,
+                               uint64_t& stride) const
+{
+    if (m_shard.mode == ScanShard::Mode::Block) {
+        uint64_t begin = std::max(first, m_blockBegin);
+        uint64_t end = std::min(first + count, m_blockEnd);
+        if (begin >= end) return false;
+        offset = begin - first;
+        selected = end - begin;
+        stride = 1;
+        return true;
+    }
+    const uint64_t shards = m_shard.count;
+    offset = (m_shard.index + shards - first % shards) % shards;
+    if (offset >= count) return false;
+    selected = (count - offset + shards - 1) / shards;
+    stride = shards;
+    return true;
+}
+
+bool ScanShard::parse(const QString& text, ScanShard& shard)
+{
+    const QStringList parts = text.trimmed().split('/');
+    if (parts.size() != 2) return false;
+    bool indexOk = false;
+    bool countOk = false;
+    uint index = parts[0].trimmed().toUInt(&indexOk);
+    uint count = parts[1].trimmed().toUInt(&countOk);
+    if (!indexOk || !countOk || count == 0 || index == 0 || index > count) return false;
+    shard.index = index - 1;
+    shard.count = count;
+    return true;
+}
+
+bool ScanShard::parseMode(const QString& text, Mode& mode)
+{
+    QString name = text.trimmed().toLower();
+    if (name == "interleave") {
+        mode = Mode::Interleave;
+    } else if (name == "block") {
+        mode = Mode::Block;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString ScanShard::toString() const
+{
+    return QString("%1/%2").arg(index + 1).arg(count);
+}
+
+std::pair<uint64_t, uint64_t> ScanShard::blockRange(uint64_t total) const
+{
+    auto bound = [total](uint64_t i, uint64_t n) {
+        return total / n * i + total % n * i / n;
+    };
+    return {bound(index, count), bound(index + 1, count)};
+}
+
+uint64_t ScanShard::share(uint64_t total) const
+{
+    if (!isActive()) return total;
+    if (mode == Mode::Block) {
+        const auto range = blockRange(total);
+        return range.second - range.first;
+    }
+    return total > index ? (total - index + count - 1) / count : 0;
+}
+
+QString CidrExpander::toCidr(const QString& entry)
+{
+    QString trimmed = entry.trimmed();
+    if (!trimmed.contains('/') && IPUtils::isValidIP(trimmed)) {
+        return trimmed + (IPUtils::isIPv6(trimmed) ? "/128" : "/32");
+    }
+    return trimmed;
+}
+
+uint64_t CidrExpander::rangeCount(const QString& cidr)
+{
+    if (!IPUtils::isValidCIDR(cidr)) {
+        return 0;
+    }
+    uint64_t count = IPUtils::getCIDRIPCount(cidr);
+    if (count == UINT64_MAX) {
+        // IPv6范围太大，设置为合理的上限
+        count = MAX_RANGE_COUNT;
+    }
+    return count;
+}
+
+bool CidrExpander::addRange(const QString& cidr)
+{
+    // 先计算IP数量
+    uint64_t count = rangeCount(cidr);
+    if (count == 0) {
+        return false;
+    }
+    
+    // 获取起始IP
+    IPAddress first = IPUtils::cidrToRange(cidr).first;
+    
+    // 拆块不改变全局序号，分片结果与是否使用先验无关；很大的范围按更粗的块拆，块数不超过MAX_PRIOR_BLOCKS
+    const uint64_t blockSize = std::max(uint64_t(1) << (32 - ScanPrior::IPV4_PREFIX), count / MAX_PRIOR_BLOCKS);
+    if (m_prior && first.type == IPAddress::IPv4 && count > blockSize) {
+        for (uint64_t done = 0; done < count; done += blockSize) {
+            addBlock(IPUtils::advanceIP(first, done), blockSize);
         }
-        
-        // 获取起始和结束IP
-        auto range = IPUtils::cidrToRange(cidr);
-        m_ranges.emplace(range.first, range.second, cidr);
-        
-        // 累加IP数量
-        m_totalIPs += count;
+    } else {
+        addBlock(first, count);
+    }
+    return true;
+}
+
+void CidrExpander::addBlock(const IPAddress& first, uint64_t count)
+{
+    // 本块占用全局序号[m_position, m_position + count)，只保留属于本分片的部分
+    uint64_t position = m_position;
+    m_position += count;
+    uint64_t offset = 0;
+    uint64_t selected = count;
+    uint64_t stride = 1;
+    if (m_shard.isActive() && !selectShard(position, count, offset, selected, stride)) {
+        return;
+    }
+    
+    ScanPrior::Rank rank = m_prior ? m_prior->rank(first) : ScanPrior::Rank();
+    m_ranges.emplace(IPUtils::advanceIP(first, offset), selected, stride, m_sequence++, rank);
+    
+    // 累加IP数量
+    m_totalIPs += selected;
+}
+
+// 无法解析的行直接跳过，错误由文件统计报告
+void CidrExpander::refill()
+{
+    // 分片时不属于本片的条目不入队，一直读到补够或读完；有先验时多读一些，在更大的窗口内排序
+    const std::size_t window = static_cast<std::size_t>(m_prior ? PRIOR_REFILL_ENTRIES : REFILL_ENTRIES);
+    std::string_view entry;
+    while (m_ranges.size() < window && m_source->nextEntry(m_sourceOffset, entry)) {
+        addRange(toCidr(QString::fromLatin1(entry.data(), static_cast<int>(entry.size()))));
     }
 }
 
 // 判断是否还有未处理的IP
 bool CidrExpander::hasMore() const
 {
-    return !m_ranges.empty();
+    return !m_ranges.empty() || (m_source && m_sourceOffset < m_source->size());
 }
 
 // 获取下一个批次的IP地址
 QStringList CidrExpander::getNextBatch(int batchSize)
 {
     QStringList batch;
+    batch.reserve(batchSize);
     
-    while (batch.size() < batchSize && !m_ranges.empty()) {
-        auto& range = m_ranges.front();
-        
-        // 从当前范围添加IP到批次
-        while (batch.size() < batchSize && IPUtils::compareIP(range.current, range.end)) {
-            batch.append(IPUtils::ipToString(range.current));
-            range.current = IPUtils::incrementIP(range.current);
-            m_processedIPs++;
-            
-            // 确保处理IP数不超过总IP数
-            if (m_processedIPs.load() >= m_totalIPs.load()) {
-                break;
-            }
+    while (batch.size() < batchSize) {
+        if (m_ranges.empty() && m_source) {
+            refill();
         }
-        
-        // 如果当前范围已处理完，移除它
-        if (!IPUtils::compareIP(range.current, range.end) || m_processedIPs.load() >= m_totalIPs.load()) {
-            m_ranges.pop();
+        if (m_ranges.empty()) {
+            break;
         }
+        // 优先队列的队首不可修改，取出后处理，未处理完的放回（优先级不变，仍在队首）
+        CidrRange range = m_ranges.top();
+        m_ranges.pop();
         
-        // 如果已经处理了足够的IP，提前结束
-        if (m_processedIPs.load() >= m_totalIPs.load()) {
-            break;
+        // 从当前范围添加IP到批次，按地址族分派一次后逐个格式化
+        const uint64_t take = std::min(static_cast<uint64_t>(batchSize - batch.size()), range.remaining);
+        visitFamily(range.current.type, [&](auto family) {
+            using Family = decltype(family);
+            for (auto value : AddressRange<Family>{Family::fromAddress(range.current), take, range.stride}) {
+                batch.append(Family::toString(value));
+            }
+        });
+        m_processedIPs += take;
+        range.remaining -= take;
+        
+        if (range.remaining > 0) {
+            range.current = IPUtils::advanceIP(range.current, take * range.stride);
+            m_ranges.push(range);
         }
     }
     
@@ -90,9 +254,37 @@ QStringList CidrExpander::getNextBatch(int batchSize)
     return batch;
 }
 
-// 获取总IP数量
+bool CidrExpander::takeChunk(uint64_t maxCount, ScanChunk& chunk)
+{
+    if (m_ranges.empty() && m_source) {
+        refill();
+    }
+    if (m_ranges.empty() || maxCount == 0) {
+        return false;
+    }
+    CidrRange range = m_ranges.top();
+    m_ranges.pop();
+
+    chunk.first = range.current;
+    chunk.count = std::min(maxCount, range.remaining);
+    chunk.stride = range.stride;
+    range.remaining -= chunk.count;
+    if (range.remaining > 0) {
+        range.current = IPUtils::advanceIP(range.current, chunk.count * range.stride);
+        m_ranges.push(range);
+    }
+    m_processedIPs += chunk.count;
+    emit expansionProgress(m_processedIPs.load(), m_totalIPs.load());
+    return true;
+}
+
+// 获取总IP数量（分片时为本片的数量），文件输入统计完成后使用统计结果
 uint64_t CidrExpander::getTotalIPCount() const
 {
+    uint64_t fileTotal = 0;
+    if (m_source && m_source->addressCount(fileTotal)) {
+        return std::max(m_shard.share(fileTotal), m_totalIPs.load());
+    }
     return m_totalIPs.load();
 }
 
@@ -5,10 +5,43 @@
 #include <QString>
 #include <QStringList>
 #include "iputils.h"
+#include "scanprior.h"
 #include <queue>
 #include <atomic>
+#include <memory>
 
-// CIDR扩展器类，用于将CIDR范围展开为IP列表
+class CidrFileSource;
+
+// 扫描分片：输入的全部地址按展开顺序编号，N个进程各取一片，无需协调即可不重不漏地覆盖
+struct ScanShard {
+    enum class Mode {
+        Interleave, // 序号对N取模等于index的地址，各片均匀分布在每个网段中，文件输入无需预先计数
+        Block       // 序号连续的第index块，需要先知道地址总数
+    };
+    uint32_t index = 0; // 从0开始
+    uint32_t count = 1; // 为1时不分片
+    Mode mode = Mode::Interleave;
+
+    bool isActive() const { return count > 1; }
+    // 解析“i/N”（i从1开始）与分片方式（interleave/block），失败时返回false
+    static bool parse(const QString& text, ScanShard& shard);
+    static bool parseMode(const QString& text, Mode& mode);
+    QString toString() const; // “i/N”，i从1开始
+    // 全部输入共total个地址时连续块分片的序号范围[first, second)
+    std::pair<uint64_t, uint64_t> blockRange(uint64_t total) const;
+    // 全部输入共total个地址时本片的地址数
+    uint64_t share(uint64_t total) const;
+};
+
+// 扫描计划中的一段地址：从first开始每隔stride取一个，共count个
+struct ScanChunk {
+    IPAddress first;
+    uint64_t count = 0;
+    uint64_t stride = 1;
+};
+
+// CIDR扩展器类，用于将CIDR范围展开为IP列表。
+// 不是线程安全的：调用方须串行调用（ScanEngine在任务的调度锁内调用），计数可以在任意线程读取
 class CidrExpander : public QObject
 {
     Q_OBJECT
@@ -16,34 +49,86 @@ class CidrExpander : public QObject
 public:
     explicit CidrExpander(QObject *parent = nullptr);
     
+    // 设置分片，须在setCidrRanges/setSource之前调用
+    void setShard(const ScanShard& shard) { m_shard = shard; }
+    // 设置先验（热启动），须在setCidrRanges/setSource之前调用：IPv4范围拆分为/24，
+    // 先验中成功过的网段按评分先调度，没有记录的其次，从未成功的最后；
+    // 文件输入时在PRIOR_REFILL_ENTRIES个范围的窗口内排序
+    void setPrior(std::shared_ptr<const ScanPrior> prior) { m_prior = std::move(prior); }
     // 设置CIDR范围
     void setCidrRanges(const QStringList& cidrRanges);
+    // 从文件读取：按需每次解析一小批行，队列中只保留少量范围；
+    // 文件统计完成前总数为已解析部分的地址数；连续块分片需要总数，文件尚未统计时在此同步统计
+    void setSource(std::shared_ptr<CidrFileSource> source);
     // 判断是否还有未处理的IP
     bool hasMore() const;
     // 获取下一个批次的IP地址
     QStringList getNextBatch(int batchSize = 1000);
+    // 取出扫描计划的下一段，最多maxCount个地址且不跨范围，没有剩余时返回false；
+    // 只移动游标而不展开地址，顺序与getNextBatch相同，展开由取得该段的线程自己完成
+    bool takeChunk(uint64_t maxCount, ScanChunk& chunk);
     // 获取总IP数量
     uint64_t getTotalIPCount() const;
     // 获取已处理的IP数量
     uint64_t getProcessedIPCount() const;
 
+    // 单个IP规范化为/32或/128，其他内容去除首尾空白后原样返回
+    static QString toCidr(const QString& entry);
+    // 一个CIDR计入总数的地址数，过大的IPv6范围按上限计，无效时为0
+    static uint64_t rangeCount(const QString& cidr);
+
 signals:
     // 扩展进度信号，参数为已处理和总数
     void expansionProgress(uint64_t processed, uint64_t total);
 
 private:
-    // CIDR范围结构体，支持IPv4和IPv6
+    // CIDR范围结构体，支持IPv4和IPv6；分片时只包含本片的地址
     struct CidrRange {
-        IPAddress start;        // 起始IP
-        IPAddress end;          // 结束IP
         IPAddress current;      // 当前处理到的IP
-        QString originalCidr;   // 原始CIDR字符串
+        uint64_t remaining;     // 尚未输出的地址数（过大的IPv6范围已按上限截断）
+        uint64_t stride;        // 相邻两个输出地址的间隔，交错分片时为分片数
+        uint64_t sequence;      // 入队顺序，优先级相同时先入先出
+        ScanPrior::Rank rank;   // 先验等级与评分，没有先验时都为Unknown
         
-        CidrRange(const IPAddress& s, const IPAddress& e, const QString& cidr)
-            : start(s), end(e), current(s), originalCidr(cidr) {}
+        CidrRange(const IPAddress& first, uint64_t count, uint64_t step, uint64_t order, ScanPrior::Rank priority)
+            : current(first), remaining(count), stride(step), sequence(order), rank(priority) {}
+    };
+    // 优先队列的比较：等级高、评分高、入队早的范围在前
+    struct RangeOrder {
+        bool operator()(const CidrRange& a, const CidrRange& b) const
+        {
+            if (a.rank.tier != b.rank.tier) return a.rank.tier < b.rank.tier;
+            if (a.rank.score != b.rank.score) return a.rank.score < b.rank.score;
+            return a.sequence > b.sequence;
+        }
     };
     
-    std::queue<CidrRange> m_ranges;         // CIDR范围队列
+    // 加入一个范围中属于本分片的部分并累加总数，CIDR无效时返回false；
+    // 有先验时IPv4范围按/24拆开，各块分别排序
+    bool addRange(const QString& cidr);
+    // 加入全局序号连续的一块地址中属于本分片的部分
+    void addBlock(const IPAddress& first, uint64_t count);
+    // 队列为空时从文件补充下一批范围
+    void refill();
+    // 全局序号[first, first + count)中属于本分片的部分：起始偏移、个数与步长，没有时返回false
+    bool selectShard(uint64_t first, uint64_t count, uint64_t& offset, uint64_t& selected, uint64_t& stride) const;
+    // 按总数计算连续块分片的序号范围
+    void setBlockBounds(uint64_t total);
+
+    static constexpr uint64_t MAX_RANGE_COUNT = 1000000; // 单个IPv6范围计入的地址数上限
+    static constexpr int REFILL_ENTRIES = 1024;          // 每次从文件解析的条目数
+    static constexpr int PRIOR_REFILL_ENTRIES = 65536;   // 有先验时文件输入的排序窗口（范围数）
+    static constexpr uint64_t MAX_PRIOR_BLOCKS = 65536;  // 有先验时单个范围最多拆成的块数
+
+    std::priority_queue<CidrRange, std::vector<CidrRange>, RangeOrder> m_ranges; // 待扫描范围，按先验优先级出队
+    std::shared_ptr<const ScanPrior> m_prior; // 先验，为空时按输入顺序
+    uint64_t m_sequence = 0;                // 下一个入队范围的顺序号
+    std::shared_ptr<CidrFileSource> m_source; // 文件输入，为空时只使用setCidrRanges的范围
+    qint64 m_sourceOffset = 0;              // 文件中下一条待解析的位置
+    ScanShard m_shard;                      // 分片设置
+    uint64_t m_position = 0;                // 下一个范围首地址的全局序号（含不属于本分片的地址）
+    uint64_t m_blockBegin = 0;              // 连续块分片的序号范围[m_blockBegin, m_blockEnd)
+    uint64_t m_blockEnd = 0;
     std::atomic<uint64_t> m_totalIPs;       // 总IP数量
     std::atomic<uint64_t> m_processedIPs;   // 已处理IP数量
 };
@@ -0,0 +1,109 @@
+#include "cidrfile.h"
+#include "cidrexpander.h"
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+} // namespace
+
+CidrFileSource::~CidrFileSource()
+{
+    if (m_data) {
+        m_file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+    }
+}
+
+bool CidrFileSource::open(const QString& path, QString* error)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size == 0) {
+        return true; // 空文件无需映射
+    }
+    uchar* data = m_file.map(0, m_size);
+    if (!data) {
+        if (error) *error = m_file.errorString();
+        m_size = 0;
+        return false;
+    }
+    m_data = reinterpret_cast<const char*>(data);
+#ifdef Q_OS_UNIX
+    // 扫描与统计都是顺序读取，提示内核预读并及早回收已读页
+    madvise(data, static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+bool CidrFileSource::nextEntry(qint64& offset, std::string_view& entry, qint64* lineNumber) const
+{
+    while (offset < m_size) {
+        const char* begin = m_data + offset;
+        const void* newline = std::memchr(begin, '\n', static_cast<size_t>(m_size - offset));
+        const char* end = newline ? static_cast<const char*>(newline) : m_data + m_size;
+        offset = (end - m_data) + (newline ? 1 : 0);
+        if (lineNumber) ++*lineNumber;
+
+        while (begin < end && isBlank(*begin)) ++begin;
+        while (end > begin && isBlank(end[-1])) --end;
+        // 首行可能带UTF-8 BOM
+        if (end - begin >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0) begin += 3;
+        if (begin == end || *begin == '#') continue;
+
+        entry = std::string_view(begin, static_cast<size_t>(end - begin));
+        return true;
+    }
+    return false;
+}
+
+CidrFileSummary CidrFileSource::summarize(const std::atomic<bool>* cancel)
+{
+    CidrFileSummary summary;
+    qint64 offset = 0;
+    qint64 line = 0;
+    qint64 read = 0;
+    std::string_view entry;
+    while (nextEntry(offset, entry, &line)) {
+        // 每读取16384条检查一次取消
+        if (cancel && (++read & 0x3FFF) == 0 && cancel->load(std::memory_order_relaxed)) {
+            summary.cancelled = true;
+            break;
+        }
+        QString cidr = CidrExpander::toCidr(QString::fromLatin1(entry.data(), static_cast<int>(entry.size())));
+        uint64_t count = CidrExpander::rangeCount(cidr);
+        if (count == 0) {
+            ++summary.errorCount;
+            if (summary.errors.size() < MAX_REPORTED_ERRORS) {
+                summary.errors.append(CidrParseError{line, QString::fromLatin1(entry.data(), static_cast<int>(entry.size()))});
+            }
+            continue;
+        }
+        ++summary.entryCount;
+        summary.addressCount += count;
+    }
+    // nextEntry对空行与注释行同样计数，读完时line即为总行数
+    summary.lineCount = line;
+    if (!summary.cancelled) {
+        m_addressCount.store(summary.addressCount, std::memory_order_relaxed);
+        m_summarized.store(true, std::memory_order_release);
+    }
+    return summary;
+}
+
+bool CidrFileSource::addressCount(uint64_t& count) const
+{
+    if (!m_summarized.load(std::memory_order_acquire)) return false;
+    count = m_addressCount.load(std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef CIDRFILE_H
+#define CIDRFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+// 一条无法解析的输入行
+struct CidrParseError {
+    qint64 line = 0;   // 行号（从1开始）
+    QString text;
+};
+
+// 文件输入的统计摘要
+struct CidrFileSummary {
+    qint64 lineCount = 0;          // 总行数
+    qint64 entryCount = 0;         // 有效条目数（CIDR或单个IP）
+    uint64_t addressCount = 0;     // 展开后的地址数（与CidrExpander的计数规则一致）
+    qint64 errorCount = 0;         // 无法解析的行数
+    QVector<CidrParseError> errors; // 前MAX_REPORTED_ERRORS条错误
+    bool cancelled = false;        // 统计被中途取消，以上数字不完整
+};
+
+// 文件输入源：只读映射整个文件，按行惰性读取，扫描时内存占用与文件大小无关。
+// 映射建立后只读，可同时被统计线程与扫描线程使用
+class CidrFileSource
+{
+public:
+    static constexpr int MAX_REPORTED_ERRORS = 100;
+
+    CidrFileSource() = default;
+    ~CidrFileSource();
+
+    CidrFileSource(const CidrFileSource&) = delete;
+    CidrFileSource& operator=(const CidrFileSource&) = delete;
+
+    // 映射文件，失败时返回false并写入错误信息
+    bool open(const QString& path, QString* error = nullptr);
+
+    QString path() const { return m_file.fileName(); }
+    qint64 size() const { return m_size; }
+
+    // 从offset开始读取下一条非空、非注释行（已去除首尾空白），offset前移到下一行；
+    // lineNumber非空时同步累加行号；读完时返回false
+    bool nextEntry(qint64& offset, std::string_view& entry, qint64* lineNumber = nullptr) const;
+
+    // 完整读取一遍得到摘要，在后台线程调用；完成后addressCount()可用
+    CidrFileSummary summarize(const std::atomic<bool>* cancel = nullptr);
+
+    // 统计完成后的地址总数，未完成时返回false
+    bool addressCount(uint64_t& count) const;
+
+private:
+    QFile m_file;
+    const char* m_data = nullptr;
+    qint64 m_size = 0;
+    std::atomic<bool> m_summarized{false};
+    std::atomic<uint64_t> m_addressCount{0};
+};
+
+#endif // CIDRFILE_H
@@ -0,0 +1,264 @@
+#include "eventlog.h"
+#include "threadplacement.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+// 获取全局日志实例
+EventLog& EventLog::instance()
+{
+    static EventLog log;
+    return log;
+}
+
+EventLog::EventLog()
+    : m_ring(RING_CAPACITY)
+    , m_dropped(0)
+    , m_reportedDropped(0)
+    , m_running(false)
+{
+}
+
+EventLog::~EventLog()
+{
+    stop();
+}
+
+// 设置全局日志级别
+void EventLog::setLevel(LogLevel level)
+{
+    s_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+// 记录探测事件，只做字段拷贝
+void EventLog::probe(LogLevel level, LogEvent event, const boost::asio::ip::address& address,
+                     uint16_t port, double latencyMs, int error)
+{
+    LogRecord record;
+    record.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.event = event;
+    record.level = level;
+    record.port = port;
+    record.error = error;
+    record.latencyMs = latencyMs;
+    if (address.is_v6()) {
+        record.ipv6 = true;
+        record.address = address.to_v6().to_bytes();
+    } else {
+        auto bytes = address.to_v4().to_bytes();
+        std::copy(bytes.begin(), bytes.end(), record.address.begin());
+    }
+
+    if (!m_ring.push(record)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// 设置日志文件
+void EventLog::setLogFile(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    if (!path.empty()) {
+        m_file.open(path, std::ios::out | std::ios::app);
+    }
+}
+
+// 设置界面转发回调
+void EventLog::setLineSink(LineSink sink)
+{
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    m_lineSink = std::move(sink);
+}
+
+// 记录后台线程的CPU，由后台线程自己绑定
+void EventLog::setThreadCpus(std::vector<int> cpus)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_cpusMutex);
+        m_threadCpus = std::move(cpus);
+    }
+    m_cpusChanged.store(true);
+}
+
+// 启动后台线程
+void EventLog::start()
+{
+    if (m_running.exchange(true)) return;
+    m_sinkThread = std::thread([this]() { sinkLoop(); });
+}
+
+// 停止后台线程，剩余记录会被写出
+void EventLog::stop()
+{
+    if (!m_running.exchange(false)) return;
+    m_wake.notify_all();
+    if (m_sinkThread.joinable()) {
+        m_sinkThread.join();
+    }
+    drain();
+
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+}
+
+// 后台线程主循环，定期清空队列
+void EventLog::sinkLoop()
+{
+    while (m_running.load()) {
+        if (m_cpusChanged.exchange(false)) {
+            std::vector<int> cpus;
+            {
+                std::lock_guard<std::mutex> lock(m_cpusMutex);
+                cpus = m_threadCpus;
+            }
+            ThreadPlacement::bindCurrentThread(cpus);
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(DRAIN_INTERVAL_MS),
+                            [this]() { return !m_running.load(); });
+        }
+        drain();
+    }
+}
+
+// 取出队列中的全部记录，写文件并把最新的若干行转发给界面
+void EventLog::drain()
+{
+    std::vector<LogRecord> records;
+    records.reserve(1024);
+    LogRecord record;
+    while (records.size() < m_ring.capacity() && m_ring.pop(record)) {
+        records.push_back(record);
+    }
+
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    uint64_t newlyDropped = dropped - m_reportedDropped.exchange(dropped);
+    if (records.empty() && newlyDropped == 0) return;
+
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    bool writeFile = m_file.is_open();
+    if (!writeFile && !m_lineSink) return;
+
+    // 不写文件时只格式化需要显示的尾部记录
+    std::size_t uiStart = records.size() > MAX_UI_LINES ? records.size() - MAX_UI_LINES : 0;
+    std::size_t first = writeFile ? 0 : uiStart;
+
+    std::vector<Line> uiLines;
+    uiLines.reserve(records.size() - uiStart + 1);
+    for (std::size_t i = first; i < records.size(); ++i) {
+        std::string text = format(records[i]);
+        int64_t timestampMs = records[i].timestampUs / 1000;
+
+        if (writeFile) {
+            std::time_t seconds = static_cast<std::time_t>(records[i].timestampUs / 1000000);
+            std::tm tm{};
+#ifdef _WIN32
+            localtime_s(&tm, &seconds);
+#else
+            localtime_r(&seconds, &tm);
+#endif
+            char stamp[32];
+            std::snprintf(stamp, sizeof(stamp), "%04d-%02d-%02d %02d:%02d:%02d.%03d ",
+                          tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                          tm.tm_hour, tm.tm_min, tm.tm_sec,
+                          static_cast<int>((records[i].timestampUs / 1000) % 1000));
+            m_file << stamp << levelName(records[i].level) << ' ' << text << '\n';
+        }
+        if (i >= uiStart && m_lineSink) {
+            uiLines.push_back({timestampMs, std::move(text)});
+        }
+    }
+
+    if (newlyDropped > 0) {
+        std::string text = "Log queue full, " + std::to_string(newlyDropped) + " records dropped";
+        if (writeFile) {
+            m_file << text << '\n';
+        }
+        if (m_lineSink) {
+            int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            uiLines.push_back({nowMs, std::move(text)});
+        }
+    }
+
+    if (writeFile) {
+        m_file.flush();
+    }
+    if (m_lineSink && !uiLines.empty()) {
+        m_lineSink(std::move(uiLines));
+    }
+}
+
+// 日志级别名称
+const char* EventLog::levelName(LogLevel level)
+{
+    switch (level) {
+    case LogLevel::Error: return "ERROR";
+    case LogLevel::Warning: return "WARN ";
+    case LogLevel::Info: return "INFO ";
+    case LogLevel::Debug: return "DEBUG";
+    }
+    return "?";
+}
+
+// 将二进制记录格式化为文本
+std::string EventLog::format(const LogRecord& record)
+{
+    std::string address;
+    if (record.ipv6) {
+        address = boost::asio::ip::make_address_v6(record.address).to_string();
+    } else {
+        boost::asio::ip::address_v4::bytes_type bytes;
+        std::copy(record.address.begin(), record.address.begin() + 4, bytes.begin());
+        address = boost::asio::ip::make_address_v4(bytes).to_string();
+    }
+    const char* protocol = record.ipv6 ? "IPv6" : "IPv4";
+
+    char buffer[256] = {0};
+    switch (record.event) {
+    case LogEvent::ProbeConnected:
+        std::snprintf(buffer, sizeof(buffer), "TCP connect %s (%s):%u: %.2fms",
+                      address.c_str(), protocol, record.port, record.latencyMs);
+        break;
+    case LogEvent::ProbeRefused:
+        std::snprintf(buffer, sizeof(buffer), "TCP connect %s (%s):%u: %.2fms (port closed but reachable)",
+                      address.c_str(), protocol, record.port, record.latencyMs);
+        break;
+    case LogEvent::ProbeTimeout:
+        std::snprintf(buffer, sizeof(buffer), "TCP connect %s:%u timeout",
+                      address.c_str(), record.port);
+        break;
+    case LogEvent::ProbeFailed:
+        std::snprintf(buffer, sizeof(buffer), "TCP connect %s (%s):%u failed (error %d)",
+                      address.c_str(), protocol, record.port, record.error);
+        break;
+    case LogEvent::HttpTrace:
+        std::snprintf(buffer, sizeof(buffer), "HTTP trace %s (%s):%u: status %d, ttfb %.2fms",
+                      address.c_str(), protocol, record.port, record.error, record.latencyMs);
+        break;
+    case LogEvent::TlsHandshake:
+        if (record.error == 0) {
+            std::snprintf(buffer, sizeof(buffer), "TLS handshake %s (%s):%u: completed in %.2fms",
+                          address.c_str(), protocol, record.port, record.latencyMs);
+        } else if (record.error < 0) {
+            std::snprintf(buffer, sizeof(buffer), "TLS handshake %s (%s):%u: timeout",
+                          address.c_str(), protocol, record.port);
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "TLS handshake %s (%s):%u: failed (error %d)",
+                          address.c_str(), protocol, record.port, record.error);
+        }
+        break;
+    case LogEvent::ProbeException:
+        std::snprintf(buffer, sizeof(buffer), "TCP connect %s (%s):%u failed with exception",
+                      address.c_str(), protocol, record.port);
+        break;
+    }
+    return buffer;
+}
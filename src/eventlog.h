@@ -0,0 +1,122 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include "lockfreering.h"
+#include <boost/asio/ip/address.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 日志级别，数值越大越详细
+enum class LogLevel : uint8_t {
+    Error = 0,
+    Warning = 1,
+    Info = 2,
+    Debug = 3
+};
+
+// 结构化日志事件码，格式化推迟到后台线程
+enum class LogEvent : uint16_t {
+    ProbeConnected,     // 连接成功
+    ProbeRefused,       // 端口关闭但主机可达
+    ProbeTimeout,       // 连接超时
+    ProbeFailed,        // 连接失败（附带errno）
+    ProbeException,     // 协程内异常
+    HttpTrace,          // HTTP trace响应（latencyMs为首字节时间，error为状态码）
+    TlsHandshake        // TLS握手（latencyMs为握手完成时间，失败时error为系统错误码或TLS原因码，-1表示超时）
+};
+
+// 二进制日志记录，生产者只填字段不做任何字符串操作
+struct LogRecord {
+    int64_t timestampUs = 0;            // 系统时间（微秒）
+    LogEvent event = LogEvent::ProbeFailed;
+    LogLevel level = LogLevel::Debug;
+    bool ipv6 = false;                  // 地址族
+    uint16_t port = 0;                  // 端口号
+    int32_t error = 0;                  // 系统错误码
+    double latencyMs = 0.0;             // 延迟（毫秒）
+    std::array<uint8_t, 16> address{};  // IPv4使用前4字节
+};
+
+// 异步结构化日志：探测线程将二进制记录压入无锁环形队列，
+// 后台线程负责格式化、写入可选的日志文件并分批转发给界面
+class EventLog
+{
+public:
+    // 格式化后的一行日志
+    struct Line {
+        int64_t timestampMs;
+        std::string text;
+    };
+    using LineSink = std::function<void(std::vector<Line>&&)>;
+
+    static EventLog& instance();
+
+    // 级别检查，必须在构造任何记录之前调用，关闭时只有一次原子读
+    static bool enabled(LogLevel level)
+    {
+        return static_cast<int>(level) <= s_level.load(std::memory_order_relaxed);
+    }
+    static void setLevel(LogLevel level);
+
+    // 记录一次探测事件，队列满时丢弃并计数
+    void probe(LogLevel level, LogEvent event, const boost::asio::ip::address& address,
+               uint16_t port, double latencyMs, int error = 0);
+
+    // 设置日志文件，空路径表示不写文件
+    void setLogFile(const std::filesystem::path& path);
+    // 设置界面转发回调，在后台线程中调用
+    void setLineSink(LineSink sink);
+
+    // 把后台线程限制在cpus上（为空时恢复全部CPU），后台线程下一次醒来时自己绑定
+    void setThreadCpus(std::vector<int> cpus);
+
+    // 启动/停止后台格式化线程
+    void start();
+    void stop();
+
+    // 因队列满而丢弃的记录数
+    uint64_t droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    EventLog();
+    ~EventLog();
+
+    void sinkLoop();
+    void drain();
+    static std::string format(const LogRecord& record);
+    static const char* levelName(LogLevel level);
+
+    static inline std::atomic<int> s_level{static_cast<int>(LogLevel::Info)};
+
+    LockFreeRing<LogRecord> m_ring;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_reportedDropped;
+
+    std::thread m_sinkThread;
+    std::atomic<bool> m_running;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+
+    std::mutex m_cpusMutex;         // 保护m_threadCpus
+    std::vector<int> m_threadCpus;
+    std::atomic<bool> m_cpusChanged{false};
+
+    std::mutex m_outputMutex;       // 保护文件与回调的切换
+    std::ofstream m_file;
+    LineSink m_lineSink;
+
+    static constexpr std::size_t RING_CAPACITY = 1 << 16;  // 队列容量
+    static constexpr int DRAIN_INTERVAL_MS = 50;            // 后台线程刷新间隔
+    static constexpr std::size_t MAX_UI_LINES = 100;        // 每次最多转发给界面的行数
+};
+
+#endif // EVENTLOG_H
@@ -0,0 +1,539 @@
+#include "historystore.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QLockFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 段文件头，其后紧跟recordCount条HistoryRecord
+struct SegmentHeader {
+    char magic[4] = {'C', 'F', 'H', 'S'};
+    uint32_t version = 1;
+    uint32_t runId = 0;
+    uint32_t sealed = 0;      // 1表示记录已按地址排序、计数已填写
+    int64_t startedMs = 0;
+    int64_t finishedMs = 0;
+    int64_t minTimeMs = 0;
+    int64_t maxTimeMs = 0;
+    uint64_t recordCount = 0;
+    uint64_t successCount = 0;
+    char label[64] = {};      // UTF-8，补0
+};
+static_assert(sizeof(SegmentHeader) == 128, "SegmentHeader is written to disk as-is");
+
+constexpr qint64 HEADER_SIZE = sizeof(SegmentHeader);
+constexpr qint64 RECORD_SIZE = sizeof(HistoryRecord);
+
+// 排序与查找用的地址键：IPv4排在IPv6之前，同族按字节序比较
+struct AddressKey {
+    bool ipv6 = false;
+    std::array<uint8_t, 16> bytes{};
+};
+
+int compareKey(const AddressKey& a, const AddressKey& b)
+{
+    if (a.ipv6 != b.ipv6) return a.ipv6 ? 1 : -1;
+    return std::memcmp(a.bytes.data(), b.bytes.data(), 16);
+}
+
+AddressKey keyOf(const HistoryRecord& record)
+{
+    return AddressKey{record.isIPv6(), record.address};
+}
+
+AddressKey keyOf(const IPAddress& ip)
+{
+    AddressKey key;
+    key.ipv6 = ip.type == IPAddress::IPv6;
+    if (key.ipv6) {
+        key.bytes = ip.ipv6;
+    } else {
+        key.bytes[0] = static_cast<uint8_t>(ip.ipv4 >> 24);
+        key.bytes[1] = static_cast<uint8_t>(ip.ipv4 >> 16);
+        key.bytes[2] = static_cast<uint8_t>(ip.ipv4 >> 8);
+        key.bytes[3] = static_cast<uint8_t>(ip.ipv4);
+    }
+    return key;
+}
+
+// 保留前prefix位，其余清零；网段汇总时同一网段的记录得到相同的键
+AddressKey maskKey(AddressKey key, int prefix)
+{
+    prefix = std::clamp(prefix, 0, key.ipv6 ? 128 : 32);
+    for (int i = 0; i < 16; ++i) {
+        int keep = std::clamp(prefix - i * 8, 0, 8);
+        key.bytes[i] &= static_cast<uint8_t>(0xFF00u >> keep);
+    }
+    return key;
+}
+
+bool recordLess(const HistoryRecord& a, const HistoryRecord& b)
+{
+    int order = compareKey(keyOf(a), keyOf(b));
+    return order != 0 ? order < 0 : a.timeMs < b.timeMs;
+}
+
+int64_t nowMs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+QString segmentName(uint32_t runId, const char* suffix)
+{
+    return QString("run-%1.%2").arg(runId, 8, 10, QChar('0')).arg(QString::fromLatin1(suffix));
+}
+
+// 只读映射一个已封存的段；文件头不完整或未封存时isValid()为false
+class SegmentView
+{
+public:
+    explicit SegmentView(const QString& path)
+        : m_file(path)
+    {
+        if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < HEADER_SIZE) return;
+        uchar* data = m_file.map(0, m_file.size());
+        if (!data) return;
+        const auto* header = reinterpret_cast<const SegmentHeader*>(data);
+        if (std::memcmp(header->magic, "CFHS", 4) != 0 || header->version != 1 || !header->sealed
+            || static_cast<uint64_t>(m_file.size() - HEADER_SIZE) / RECORD_SIZE < header->recordCount) {
+            return;
+        }
+        m_header = header;
+        m_records = reinterpret_cast<const HistoryRecord*>(data + HEADER_SIZE);
+    }
+
+    bool isValid() const { return m_header != nullptr; }
+    const SegmentHeader& header() const { return *m_header; }
+    const HistoryRecord* begin() const { return m_records; }
+    const HistoryRecord* end() const { return m_records + m_header->recordCount; }
+
+    // 地址不小于key的第一条记录
+    const HistoryRecord* lowerBound(const AddressKey& key) const
+    {
+        return std::lower_bound(begin(), end(), key, [](const HistoryRecord& record, const AddressKey& value) {
+            return compareKey(keyOf(record), value) < 0;
+        });
+    }
+
+private:
+    QFile m_file; // 关闭时自动解除映射
+    const SegmentHeader* m_header = nullptr;
+    const HistoryRecord* m_records = nullptr;
+};
+
+// 解析查询范围，cidr为空时覆盖全部地址
+bool addressRange(const QString& cidr, AddressKey& first, AddressKey& last)
+{
+    if (cidr.trimmed().isEmpty()) {
+        first = AddressKey{false, {}};
+        last = AddressKey{true, {}};
+        last.bytes.fill(0xFF);
+        return true;
+    }
+    QString range = cidr.trimmed();
+    if (!range.contains('/') && IPUtils::isValidIP(range)) {
+        range += IPUtils::isIPv6(range) ? "/128" : "/32";
+    }
+    if (!IPUtils::isValidCIDR(range)) return false;
+    auto bounds = IPUtils::cidrToRange(range);
+    first = keyOf(bounds.first);
+    last = keyOf(bounds.second);
+    return true;
+}
+
+} // namespace
+
+IPAddress HistoryRecord::ip() const
+{
+    if (isIPv6()) return IPAddress(address);
+    return IPAddress((uint32_t(address[0]) << 24) | (uint32_t(address[1]) << 16) | (uint32_t(address[2]) << 8)
+                     | uint32_t(address[3]));
+}
+
+QString HistoryRecord::ipString() const
+{
+    return IPUtils::ipToString(ip());
+}
+
+QString HistoryRecord::coloString() const
+{
+    return QString::fromLatin1(colo, static_cast<int>(strnlen(colo, sizeof(colo))));
+}
+
+HistoryRunWriter::HistoryRunWriter(uint32_t runId, const QString& openPath, const QString& sealedPath)
+    : m_runId(runId)
+    , m_openPath(openPath)
+    , m_sealedPath(sealedPath)
+{
+    m_pending.reserve(BATCH_RECORDS);
+    m_thread = std::thread([this]() { writerLoop(); });
+}
+
+HistoryRunWriter::~HistoryRunWriter()
+{
+    finish();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void HistoryRunWriter::append(const QString& ip, double latencyMs, bool success, uint16_t port, const QString& colo)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_finishing) return;
+    m_pending.push_back(PendingResult{ip, colo, nowMs(), static_cast<float>(latencyMs), port, success});
+    if (m_pending.size() == BATCH_RECORDS) {
+        m_wake.notify_one();
+    }
+}
+
+void HistoryRunWriter::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finishing = true;
+    }
+    m_wake.notify_one();
+}
+
+// 地址解析与文件写入都在后台线程；写完后封存段并释放运行锁
+void HistoryRunWriter::writerLoop()
+{
+    QFile file(m_openPath);
+    const bool writable = file.open(QIODevice::WriteOnly | QIODevice::Append);
+    std::vector<PendingResult> batch;
+    std::vector<HistoryRecord> records;
+    batch.reserve(BATCH_RECORDS);
+    records.reserve(BATCH_RECORDS);
+
+    for (;;) {
+        bool finishing = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this]() {
+                return m_finishing || m_pending.size() >= BATCH_RECORDS;
+            });
+            batch.swap(m_pending);
+            finishing = m_finishing;
+        }
+
+        records.clear();
+        for (const PendingResult& result : batch) {
+            if (!IPUtils::isValidIP(result.ip)) continue;
+            HistoryRecord record;
+            AddressKey key = keyOf(IPUtils::stringToIP(result.ip));
+            record.address = key.bytes;
+            record.timeMs = result.timeMs;
+            record.runId = m_runId;
+            record.latencyMs = result.latencyMs;
+            record.port = result.port;
+            record.flags = (result.success ? HistoryRecord::FLAG_SUCCESS : 0)
+                           | (key.ipv6 ? HistoryRecord::FLAG_IPV6 : 0);
+            QByteArray colo = result.colo.toLatin1();
+            std::memcpy(record.colo, colo.constData(), std::min<std::size_t>(colo.size(), sizeof(record.colo)));
+            records.push_back(record);
+        }
+        batch.clear();
+        if (writable && !records.empty()) {
+            file.write(reinterpret_cast<const char*>(records.data()),
+                       static_cast<qint64>(records.size() * sizeof(HistoryRecord)));
+        }
+        if (finishing) break;
+    }
+
+    file.close();
+    if (writable) {
+        HistoryStore::seal(m_openPath, m_sealedPath);
+    }
+}
+
+HistoryStore::HistoryStore(const QString& directory)
+    : m_directory(directory)
+{
+}
+
+QString HistoryStore::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/CFPing/history";
+}
+
+// 上次异常退出留下的段：运行锁可以取得（持有进程已不存在）时封存，正在写入的段跳过
+bool HistoryStore::open(QString* error)
+{
+    QDir dir(m_directory);
+    if (!dir.mkpath(".")) {
+        if (error) *error = QString("无法创建目录 %1").arg(m_directory);
+        return false;
+    }
+    const QStringList openSegments = dir.entryList(QStringList{"run-*.open"}, QDir::Files, QDir::Name);
+    for (const QString& name : openSegments) {
+        QString base = dir.filePath(name.left(name.size() - 5));
+        QLockFile lock(base + ".lock");
+        lock.setStaleLockTime(0);
+        if (!lock.tryLock()) continue;
+        seal(base + ".open", base + ".seg");
+    }
+    return true;
+}
+
+std::unique_ptr<HistoryRunWriter> HistoryStore::beginRun(const QString& label)
+{
+    QDir dir(m_directory);
+    // 同一目录可能被多个进程（如同机运行的多个分片）共用，以独占创建确定编号
+    const uint32_t firstId = nextRunId();
+    for (uint32_t runId = firstId; runId < firstId + 64; ++runId) {
+        QString openPath = dir.filePath(segmentName(runId, "open"));
+        auto lock = std::make_shared<QLockFile>(dir.filePath(segmentName(runId, "lock")));
+        lock->setStaleLockTime(0); // 扫描可能持续很久，只按持有进程是否存在判断失效
+        if (!lock->tryLock()) continue;
+        QFile file(openPath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::NewOnly)) continue;
+
+        SegmentHeader header;
+        header.runId = runId;
+        header.startedMs = nowMs();
+        QByteArray name = label.toUtf8().left(static_cast<int>(sizeof(header.label) - 1));
+        std::memcpy(header.label, name.constData(), static_cast<std::size_t>(name.size()));
+        file.write(reinterpret_cast<const char*>(&header), HEADER_SIZE);
+        file.close();
+
+        // 锁在封存完成、写入器析构时释放
+        std::unique_ptr<HistoryRunWriter> writer(
+            new HistoryRunWriter(runId, openPath, dir.filePath(segmentName(runId, "seg"))));
+        writer->m_lock = std::move(lock);
+        return writer;
+    }
+    return nullptr;
+}
+
+uint32_t HistoryStore::nextRunId() const
+{
+    uint32_t maxId = 0;
+    const QStringList names = QDir(m_directory).entryList(QStringList{"run-*"}, QDir::Files);
+    for (const QString& name : names) {
+        maxId = std::max(maxId, name.mid(4, 8).toUInt());
+    }
+    return maxId + 1;
+}
+
+// 原地映射排序，不在内存中复制整个段；末尾不完整的记录（写入中途退出）被截掉
+bool HistoryStore::seal(const QString& openPath, const QString& sealedPath)
+{
+    QFile file(openPath);
+    if (!file.open(QIODevice::ReadWrite)) return false;
+    if (file.size() < HEADER_SIZE) {
+        file.remove();
+        return false;
+    }
+    const uint64_t count = static_cast<uint64_t>(file.size() - HEADER_SIZE) / RECORD_SIZE;
+    const qint64 size = HEADER_SIZE + static_cast<qint64>(count) * RECORD_SIZE;
+    if (file.size() != size && !file.resize(size)) return false;
+
+    uchar* data = file.map(0, size);
+    if (!data) return false;
+    auto* header = reinterpret_cast<SegmentHeader*>(data);
+    if (std::memcmp(header->magic, "CFHS", 4) != 0) return false;
+    auto* records = reinterpret_cast<HistoryRecord*>(data + HEADER_SIZE);
+    std::sort(records, records + count, recordLess);
+
+    header->recordCount = count;
+    header->successCount = 0;
+    header->minTimeMs = count ? records[0].timeMs : header->startedMs;
+    header->maxTimeMs = header->minTimeMs;
+    for (uint64_t i = 0; i < count; ++i) {
+        header->successCount += records[i].success() ? 1 : 0;
+        header->minTimeMs = std::min(header->minTimeMs, records[i].timeMs);
+        header->maxTimeMs = std::max(header->maxTimeMs, records[i].timeMs);
+    }
+    header->finishedMs = std::max(header->startedMs, header->maxTimeMs);
+    header->sealed = 1;
+    file.unmap(data);
+    file.close();
+
+    QFile::remove(sealedPath);
+    return QFile::rename(openPath, sealedPath);
+}
+
+QVector<HistoryRun> HistoryStore::runs() const
+{
+    QVector<HistoryRun> result;
+    QDir dir(m_directory);
+    const QStringList names = dir.entryList(QStringList{"run-*.seg"}, QDir::Files, QDir::Name);
+    for (const QString& name : names) {
+        QFile file(dir.filePath(name));
+        SegmentHeader header;
+        if (!file.open(QIODevice::ReadOnly)
+            || file.read(reinterpret_cast<char*>(&header), HEADER_SIZE) != HEADER_SIZE
+            || std::memcmp(header.magic, "CFHS", 4) != 0 || !header.sealed) {
+            continue;
+        }
+        HistoryRun run;
+        run.runId = header.runId;
+        run.startedMs = header.startedMs;
+        run.finishedMs = header.finishedMs;
+        run.recordCount = header.recordCount;
+        run.successCount = header.successCount;
+        run.minTimeMs = header.minTimeMs;
+        run.maxTimeMs = header.maxTimeMs;
+        run.label = QString::fromUtf8(header.label, static_cast<int>(strnlen(header.label, sizeof(header.label))));
+        run.path = file.fileName();
+        result.append(run);
+    }
+    std::sort(result.begin(), result.end(), [](const HistoryRun& a, const HistoryRun& b) {
+        return a.runId < b.runId;
+    });
+    return result;
+}
+
+QVector<HistoryRecord> HistoryStore::query(const HistoryQuery& query) const
+{
+    QVector<HistoryRecord> result;
+    AddressKey first;
+    AddressKey last;
+    if (!addressRange(query.cidr, first, last)) return result;
+
+    for (const HistoryRun& run : runs()) {
+        // 段的时间范围与查询不相交时整段跳过
+        if ((query.fromMs && run.maxTimeMs < query.fromMs) || (query.toMs && run.minTimeMs > query.toMs)) continue;
+        SegmentView view(run.path);
+        if (!view.isValid()) continue;
+        for (const HistoryRecord* record = view.lowerBound(first);
+             record != view.end() && compareKey(keyOf(*record), last) <= 0; ++record) {
+            if ((query.fromMs && record->timeMs < query.fromMs) || (query.toMs && record->timeMs > query.toMs)) continue;
+            if (query.successOnly && !record->success()) continue;
+            result.append(*record);
+            if (result.size() >= query.maxRecords) break;
+        }
+        if (result.size() >= query.maxRecords) break;
+    }
+    std::sort(result.begin(), result.end(), recordLess);
+    return result;
+}
+
+// 各段已按地址排序，按（汇总后的）地址归并：每次取所有段中最小的键，把各段中该键的记录一起统计，
+// 只保留前count名，内存与历史总量无关
+QVector<HistoryStability> HistoryStore::best(const HistoryBestQuery& query, const std::atomic<bool>* cancel) const
+{
+    QVector<HistoryStability> result;
+    AddressKey first;
+    AddressKey last;
+    if (!addressRange(query.cidr, first, last) || query.count <= 0) return result;
+
+    QVector<HistoryRun> all = runs();
+    const int windowStart = std::max(0, all.size() - std::max(1, query.lastRuns));
+    std::vector<std::unique_ptr<SegmentView>> views;
+    std::vector<const HistoryRecord*> cursors;
+    for (int i = windowStart; i < all.size(); ++i) {
+        auto view = std::make_unique<SegmentView>(all[i].path);
+        if (!view->isValid()) continue;
+        cursors.push_back(view->lowerBound(first));
+        views.push_back(std::move(view));
+    }
+
+    auto groupKey = [&query](const HistoryRecord& record) {
+        AddressKey key = keyOf(record);
+        return maskKey(key, key.ipv6 ? query.ipv6Prefix : query.ipv4Prefix);
+    };
+    auto inRange = [&](std::size_t i) {
+        return cursors[i] != views[i]->end() && compareKey(keyOf(*cursors[i]), last) <= 0;
+    };
+    // 小顶堆按评分淘汰，堆顶为当前第count名
+    auto worse = [](const HistoryStability& a, const HistoryStability& b) { return a.score > b.score; };
+    std::vector<HistoryStability> top;
+    std::vector<double> latencies;
+    uint64_t groups = 0;
+
+    for (;;) {
+        if (cancel && (++groups & 0x3FFF) == 0 && cancel->load(std::memory_order_relaxed)) return result;
+        bool found = false;
+        AddressKey key;
+        for (std::size_t i = 0; i < cursors.size(); ++i) {
+            if (!inRange(i)) continue;
+            AddressKey candidate = groupKey(*cursors[i]);
+            if (!found || compareKey(candidate, key) < 0) {
+                key = candidate;
+                found = true;
+            }
+        }
+        if (!found) break;
+
+        HistoryStability stats;
+        latencies.clear();
+        int64_t lastTime = -1;
+        for (std::size_t i = 0; i < cursors.size(); ++i) {
+            bool seen = false;
+            while (inRange(i) && compareKey(groupKey(*cursors[i]), key) == 0) {
+                const HistoryRecord& record = *cursors[i]++;
+                seen = true;
+                ++stats.samples;
+                if (record.success()) {
+                    ++stats.successes;
+                    latencies.push_back(record.latencyMs);
+                }
+                if (record.timeMs > lastTime) {
+                    lastTime = record.timeMs;
+                    stats.lastLatencyMs = record.success() ? record.latencyMs : -1.0;
+                }
+            }
+            stats.runs += seen ? 1 : 0;
+        }
+        if (stats.samples < query.minSamples || stats.successes == 0) continue;
+
+        stats.lastSeenMs = lastTime;
+        stats.successRate = static_cast<double>(stats.successes) / stats.samples;
+        auto middle = latencies.begin() + static_cast<std::ptrdiff_t>(latencies.size() / 2);
+        std::nth_element(latencies.begin(), middle, latencies.end());
+        stats.medianMs = *middle;
+        double mean = 0.0;
+        for (double latency : latencies) mean += latency;
+        mean /= static_cast<double>(latencies.size());
+        double variance = 0.0;
+        for (double latency : latencies) variance += (latency - mean) * (latency - mean);
+        stats.jitterMs = std::sqrt(variance / static_cast<double>(latencies.size()));
+        stats.score = stabilityScore(stats.successRate, stats.medianMs, stats.jitterMs);
+
+        if (static_cast<int>(top.size()) == query.count) {
+            if (stats.score <= top.front().score) continue;
+            std::pop_heap(top.begin(), top.end(), worse);
+            top.pop_back();
+        }
+        HistoryRecord sample;
+        sample.address = key.bytes;
+        sample.flags = key.ipv6 ? HistoryRecord::FLAG_IPV6 : 0;
+        const int prefix = key.ipv6 ? query.ipv6Prefix : query.ipv4Prefix;
+        stats.key = sample.ipString();
+        if (prefix < (key.ipv6 ? 128 : 32)) {
+            stats.key += QString("/%1").arg(prefix);
+        }
+        top.push_back(std::move(stats));
+        std::push_heap(top.begin(), top.end(), worse);
+    }
+
+    std::sort(top.begin(), top.end(), [](const HistoryStability& a, const HistoryStability& b) {
+        return a.score > b.score;
+    });
+    result.reserve(static_cast<int>(top.size()));
+    for (HistoryStability& stats : top) result.append(std::move(stats));
+    return result;
+}
+
+int HistoryStore::prune(int keepRuns)
+{
+    QVector<HistoryRun> all = runs();
+    int removed = 0;
+    for (int i = 0; i < all.size() - std::max(0, keepRuns); ++i) {
+        removed += QFile::remove(all[i].path) ? 1 : 0;
+    }
+    return removed;
+}
+
+double HistoryStore::stabilityScore(double successRate, double medianMs, double jitterMs)
+{
+    return 100.0 * successRate * LATENCY_REFERENCE_MS / (LATENCY_REFERENCE_MS + medianMs + 2.0 * jitterMs);
+}
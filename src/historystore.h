@@ -0,0 +1,172 @@
+#ifndef HISTORYSTORE_H
+#define HISTORYSTORE_H
+
+#include "iputils.h"
+#include <QString>
+#include <QVector>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 一个地址在一次扫描中的结果，定长40字节，按原样写入段文件
+struct HistoryRecord {
+    static constexpr uint8_t FLAG_SUCCESS = 0x01;
+    static constexpr uint8_t FLAG_IPV6 = 0x02;
+
+    std::array<uint8_t, 16> address{}; // IPv4为前4字节（网络字节序），其余为0
+    int64_t timeMs = 0;                // 结果时间（Unix毫秒）
+    uint32_t runId = 0;
+    float latencyMs = 0.0f;
+    uint16_t port = 0;
+    uint8_t flags = 0;
+    char colo[3] = {};                 // 应答机房代码（HTTP探测），不足3字符时补0
+    uint8_t reserved[2] = {};
+
+    bool success() const { return flags & FLAG_SUCCESS; }
+    bool isIPv6() const { return flags & FLAG_IPV6; }
+    IPAddress ip() const;
+    QString ipString() const;
+    QString coloString() const;
+};
+static_assert(sizeof(HistoryRecord) == 40, "HistoryRecord is written to disk as-is");
+
+// 一次扫描（一个段文件）的概要
+struct HistoryRun {
+    uint32_t runId = 0;
+    int64_t startedMs = 0;
+    int64_t finishedMs = 0;   // 未正常结束（崩溃后恢复）时为最后一条记录的时间
+    uint64_t recordCount = 0;
+    uint64_t successCount = 0;
+    int64_t minTimeMs = 0;    // 记录时间范围，查询时据此跳过整个段
+    int64_t maxTimeMs = 0;
+    QString label;            // 扫描说明（探测方式与端口）
+    QString path;
+};
+
+// 按地址与时间的范围查询
+struct HistoryQuery {
+    QString cidr;             // 地址范围（CIDR或单个IP），为空时不限
+    int64_t fromMs = 0;       // 时间范围[fromMs, toMs]，0为不限
+    int64_t toMs = 0;
+    bool successOnly = false;
+    int maxRecords = 100000;  // 结果上限
+};
+
+// 最近N次扫描的稳定性排名
+struct HistoryBestQuery {
+    int lastRuns = 10;        // 参与统计的最近扫描次数
+    int count = 100;          // 返回前多少名
+    int minSamples = 2;       // 少于此样本数的地址不参与排名
+    QString cidr;             // 只统计此范围，为空时不限
+    int ipv4Prefix = 32;      // 按网段汇总时的前缀长度，32/128为按单个IP
+    int ipv6Prefix = 128;
+};
+
+// 一个地址（或网段）在统计窗口内的表现
+struct HistoryStability {
+    QString key;              // IP，或按网段汇总时的CIDR
+    int runs = 0;             // 出现过的扫描次数
+    int samples = 0;          // 记录数（网段汇总时为网段内全部记录）
+    int successes = 0;
+    double successRate = 0.0;
+    double medianMs = 0.0;    // 成功样本的延迟中位数
+    double jitterMs = 0.0;    // 成功样本延迟的标准差
+    double lastLatencyMs = -1.0; // 最近一次的延迟，失败为-1
+    int64_t lastSeenMs = 0;
+    double score = 0.0;       // 稳定性评分（0–100），越高越好
+};
+
+class HistoryStore;
+class QLockFile;
+
+// 一次扫描的写入器：界面线程只把结果追加到内存批次，后台线程按批写入段文件；
+// 结束时后台线程把段按地址排序并封存，之后才出现在查询中
+class HistoryRunWriter
+{
+public:
+    ~HistoryRunWriter(); // 完成写入与封存后返回
+
+    HistoryRunWriter(const HistoryRunWriter&) = delete;
+    HistoryRunWriter& operator=(const HistoryRunWriter&) = delete;
+
+    uint32_t runId() const { return m_runId; }
+    void append(const QString& ip, double latencyMs, bool success, uint16_t port, const QString& colo);
+    // 结束本次扫描，不等待封存完成
+    void finish();
+
+private:
+    friend class HistoryStore;
+    HistoryRunWriter(uint32_t runId, const QString& openPath, const QString& sealedPath);
+
+    struct PendingResult {
+        QString ip;
+        QString colo;
+        int64_t timeMs;
+        float latencyMs;
+        uint16_t port;
+        bool success;
+    };
+
+    void writerLoop();
+
+    const uint32_t m_runId;
+    const QString m_openPath;
+    const QString m_sealedPath;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<PendingResult> m_pending;
+    bool m_finishing = false;
+    std::shared_ptr<QLockFile> m_lock; // 运行锁，表示段仍在写入；析构时（封存之后）释放
+    std::thread m_thread;
+
+    static constexpr std::size_t BATCH_RECORDS = 4096; // 攒够一批再唤醒后台线程
+    static constexpr int FLUSH_INTERVAL_MS = 1000;     // 批次不满时的最长等待
+};
+
+// 本地历史结果库：每次扫描一个只追加的段文件（run-<id>.open），扫描结束后按地址排序
+// 并封存为run-<id>.seg；查询只读映射封存的段，按地址二分查找，多段之间按地址归并，
+// 内存占用与历史总量无关
+class HistoryStore
+{
+public:
+    explicit HistoryStore(const QString& directory = defaultDirectory());
+
+    // 默认目录：<用户数据目录>/CFPing/history
+    static QString defaultDirectory();
+    QString directory() const { return m_directory; }
+
+    // 创建目录并封存上次未正常结束的段，失败时返回false
+    bool open(QString* error = nullptr);
+
+    // 开始记录一次扫描
+    std::unique_ptr<HistoryRunWriter> beginRun(const QString& label);
+
+    // 已封存的扫描，按runId升序
+    QVector<HistoryRun> runs() const;
+    // 按地址与时间查询原始记录，结果按地址、时间排序
+    QVector<HistoryRecord> query(const HistoryQuery& query) const;
+    // 最近N次扫描中稳定性评分最高的地址或网段；要归并窗口内全部段，界面中在后台线程调用，cancel置位时提前返回空结果
+    QVector<HistoryStability> best(const HistoryBestQuery& query, const std::atomic<bool>* cancel = nullptr) const;
+    // 只保留最近keepRuns次扫描，返回删除的段数
+    int prune(int keepRuns);
+
+    // 稳定性评分：成功率乘以按延迟与抖动折减的系数，中位延迟加两倍抖动等于参考值时折减一半
+    static double stabilityScore(double successRate, double medianMs, double jitterMs);
+    // 把未封存的段按地址排序并写入段头，成功后改名为封存文件
+    static bool seal(const QString& openPath, const QString& sealedPath);
+
+    static constexpr double LATENCY_REFERENCE_MS = 100.0;
+
+private:
+    uint32_t nextRunId() const;
+
+    QString m_directory;
+};
+
+#endif // HISTORYSTORE_H
@@ -0,0 +1,173 @@
+#include "httptrace.h"
+#include "socketfactory.h"
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+// 不区分大小写比较ASCII字符串
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        char x = a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] + 32) : a[i];
+        char y = b[i] >= 'A' && b[i] <= 'Z' ? static_cast<char>(b[i] + 32) : b[i];
+        if (x != y) return false;
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r')) value.remove_suffix(1);
+    return value;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// 构造请求报文，Connection: close让服务端发送完毕后关闭连接
+std::string HttpTrace::buildRequest(std::string_view host)
+{
+    std::string request;
+    request.reserve(96 + host.size());
+    request += "GET /cdn-cgi/trace HTTP/1.1\r\nHost: ";
+    request += host;
+    request += "\r\nUser-Agent: cfping\r\nAccept: */*\r\nConnection: close\r\n\r\n";
+    return request;
+}
+
+// 解析状态行、Content-Length/Transfer-Encoding以及正文中的colo=行
+HttpTraceResponse HttpTrace::parse(std::string_view data)
+{
+    HttpTraceResponse response;
+
+    // 状态行：HTTP/1.x NNN
+    std::size_t lineEnd = data.find("\r\n");
+    if (lineEnd == std::string_view::npos) return response;
+    std::string_view statusLine = data.substr(0, lineEnd);
+    if (statusLine.size() >= 12 && statusLine.substr(0, 5) == "HTTP/") {
+        std::size_t space = statusLine.find(' ');
+        if (space != std::string_view::npos && statusLine.size() >= space + 4) {
+            int code = 0;
+            for (std::size_t i = space + 1; i < space + 4; ++i) {
+                char c = statusLine[i];
+                if (c < '0' || c > '9') { code = 0; break; }
+                code = code * 10 + (c - '0');
+            }
+            response.status = code;
+        }
+    }
+
+    std::size_t headerEnd = data.find("\r\n\r\n");
+    if (headerEnd == std::string_view::npos) return response;
+    response.headersComplete = true;
+    response.headerSize = headerEnd + 4;
+
+    // 头部字段（含最后一行的\r\n）
+    long long& contentLength = response.contentLength;
+    bool chunked = false;
+    std::string_view headers = headerEnd > lineEnd ? data.substr(lineEnd + 2, headerEnd - lineEnd)
+                                                   : std::string_view();
+    while (!headers.empty()) {
+        std::size_t end = headers.find("\r\n");
+        std::string_view line = headers.substr(0, end);
+        headers.remove_prefix(end == std::string_view::npos ? headers.size() : end + 2);
+
+        std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view name = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+        if (equalsIgnoreCase(name, "content-length")) {
+            contentLength = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9') break;
+                contentLength = contentLength * 10 + (c - '0');
+            }
+        } else if (equalsIgnoreCase(name, "transfer-encoding")) {
+            chunked = value.find("chunked") != std::string_view::npos;
+        }
+    }
+
+    std::string_view body = data.substr(headerEnd + 4);
+    if (contentLength >= 0) {
+        response.bodyComplete = static_cast<long long>(body.size()) >= contentLength;
+        body = body.substr(0, static_cast<std::size_t>(std::min<long long>(contentLength, body.size())));
+    } else if (chunked) {
+        // 分块编码的结束标记；块长度行不会以colo=开头，逐行扫描不受影响
+        response.bodyComplete = body.size() >= 5 && body.substr(body.size() - 5) == "0\r\n\r\n";
+    }
+
+    // 正文为key=value行
+    while (!body.empty()) {
+        std::size_t end = body.find('\n');
+        if (end == std::string_view::npos) break; // 行尚未收完整
+        std::string_view line = body.substr(0, end);
+        body.remove_prefix(end + 1);
+        if (line.substr(0, 5) == "colo=") {
+            response.colo = trim(line.substr(5));
+            break;
+        }
+    }
+    return response;
+}
+
+// 写请求后循环读取到固定缓冲区，直到响应完整、对端关闭或缓冲区写满
+boost::asio::awaitable<HttpTraceResult> HttpTrace::exchange(boost::asio::ip::tcp::socket& socket,
+                                                            const std::string& request,
+                                                            std::chrono::steady_clock::time_point connectStart)
+{
+    HttpTraceResult result;
+
+    auto [writeError, written] = co_await boost::asio::async_write(
+        socket, boost::asio::buffer(request), boost::asio::as_tuple(boost::asio::use_awaitable));
+    if (writeError) {
+        result.error = SocketFactory::systemError(writeError);
+        co_return result;
+    }
+
+    std::array<char, BUFFER_SIZE> buffer;
+    std::size_t used = 0;
+    HttpTraceResponse response;
+    while (used < buffer.size()) {
+        auto [readError, n] = co_await socket.async_read_some(
+            boost::asio::buffer(buffer.data() + used, buffer.size() - used),
+            boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (n > 0 && used == 0) {
+            result.ttfbMs = elapsedMs(connectStart);
+        }
+        used += n;
+
+        if (readError) {
+            // 对端按Connection: close关闭视为正常结束
+            if (readError != boost::asio::error::eof) {
+                result.error = SocketFactory::systemError(readError);
+            }
+            break;
+        }
+        response = parse(std::string_view(buffer.data(), used));
+        if (response.bodyComplete) break;
+    }
+    result.totalMs = elapsedMs(connectStart);
+
+    if (used == 0) {
+        // 没有收到任何响应就被关闭
+        if (result.error == 0) result.error = ECONNRESET;
+        co_return result;
+    }
+    response = parse(std::string_view(buffer.data(), used));
+    result.status = response.status;
+    std::size_t coloLength = std::min(response.colo.size(), result.colo.size() - 1);
+    std::memcpy(result.colo.data(), response.colo.data(), coloLength);
+    co_return result;
+}
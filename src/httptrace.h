@@ -0,0 +1,49 @@
+#ifndef HTTPTRACE_H
+#define HTTPTRACE_H
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// /cdn-cgi/trace响应的解析结果，视图直接指向接收缓冲区，不做任何拷贝
+struct HttpTraceResponse {
+    int status = 0;             // HTTP状态码，状态行不完整时为0
+    bool headersComplete = false;
+    bool bodyComplete = false;  // 已按Content-Length或chunked结束标记收齐
+    std::size_t headerSize = 0; // 状态行与头部（含空行）的字节数
+    long long contentLength = -1; // Content-Length，未给出时为-1
+    std::string_view colo;      // colo=字段的值
+};
+
+// 一次HTTP trace交换的结果
+struct HttpTraceResult {
+    int error = 0;                   // 系统错误码，0表示收到完整或以EOF结束的响应
+    int status = 0;                  // HTTP状态码
+    double ttfbMs = 0.0;             // 从连接开始到收到第一个字节
+    double totalMs = 0.0;            // 从连接开始到响应结束
+    std::array<char, 8> colo{};      // 以0结尾的机房代码
+};
+
+// HTTP trace探测：发送最小的GET /cdn-cgi/trace请求，用固定大小的缓冲区接收并零拷贝解析
+class HttpTrace
+{
+public:
+    static constexpr std::size_t BUFFER_SIZE = 4096; // 接收缓冲区大小，trace响应通常不足1KB
+
+    // 构造请求报文，每个任务只构造一次
+    static std::string buildRequest(std::string_view host);
+
+    // 解析已收到的数据，可对不完整的响应重复调用
+    static HttpTraceResponse parse(std::string_view data);
+
+    // 在已连接的套接字上完成一次请求/响应，时间均相对于connectStart
+    static boost::asio::awaitable<HttpTraceResult> exchange(boost::asio::ip::tcp::socket& socket,
+                                                            const std::string& request,
+                                                            std::chrono::steady_clock::time_point connectStart);
+};
+
+#endif // HTTPTRACE_H
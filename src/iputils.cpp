@@ -1,6 +1,7 @@
 ﻿#include "iputils.h"
 #include <QtCore/QRegularExpression>
 #include <QtNetwork/QHostAddress>
+#include <algorithm>
 #include <cmath>
 #include <chrono>
 
@@ -55,6 +56,56 @@ QString IPUtils::ipToString(const IPAddress& ip)
     }
 }
 
+// 逐段写十进制，不经过QString::arg
+int IPv4Family::format(Value value, char* buffer)
+{
+    char* out = buffer;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        const unsigned octet = (value >> shift) & 0xFF;
+        if (octet >= 100) *out++ = static_cast<char>('0' + octet / 100);
+        if (octet >= 10) *out++ = static_cast<char>('0' + octet / 10 % 10);
+        *out++ = static_cast<char>('0' + octet % 10);
+        if (shift > 0) *out++ = '.';
+    }
+    return static_cast<int>(out - buffer);
+}
+
+QString IPv4Family::toString(Value value)
+{
+    char buffer[MAX_TEXT];
+    return QString::fromLatin1(buffer, format(value, buffer));
+}
+
+IPv6Family::Value IPv6Family::fromBytes(const std::array<uint8_t, 16>& bytes)
+{
+    uint64_t high = 0;
+    uint64_t low = 0;
+    for (int i = 0; i < 8; ++i) {
+        high = (high << 8) | bytes[i];
+        low = (low << 8) | bytes[i + 8];
+    }
+    return makeUInt128(high, low);
+}
+
+std::array<uint8_t, 16> IPv6Family::toBytes(Value value)
+{
+    uint64_t high = highWord(value);
+    uint64_t low = lowWord(value);
+    std::array<uint8_t, 16> bytes;
+    for (int i = 7; i >= 0; --i) {
+        bytes[i] = static_cast<uint8_t>(high);
+        bytes[i + 8] = static_cast<uint8_t>(low);
+        high >>= 8;
+        low >>= 8;
+    }
+    return bytes;
+}
+
+QString IPv6Family::toString(Value value)
+{
+    return IPUtils::bytesToIPv6(toBytes(value));
+}
+
 // IPv6字符串转为字节数组
 std::array<uint8_t, 16> IPUtils::ipv6ToBytes(const QString& ipv6)
 {
@@ -79,32 +130,26 @@ QString IPUtils::bytesToIPv6(const std::array<uint8_t, 16>& bytes)
 // IP地址递增
 IPAddress IPUtils::incrementIP(const IPAddress& ip)
 {
-    if (ip.type == IPAddress::IPv4) {
-        return IPAddress(ip.ipv4 + 1);
-    } else {
-        std::array<uint8_t, 16> result = ip.ipv6;
-        for (int i = 15; i >= 0; --i) {
-            if (result[i] < 255) {
-                result[i]++;
-                break;
-            } else {
-                result[i] = 0;
-            }
-        }
-        return IPAddress(result);
-    }
+    return advanceIP(ip, 1);
+}
+
+IPAddress IPUtils::advanceIP(const IPAddress& ip, uint64_t n)
+{
+    return visitFamily(ip.type, [&](auto family) {
+        using Family = decltype(family);
+        return Family::toAddress(Family::advance(Family::fromAddress(ip), n));
+    });
 }
 
 // 比较IP地址
 bool IPUtils::compareIP(const IPAddress& ip1, const IPAddress& ip2)
 {
     if (ip1.type != ip2.type) return false;
-    
-    if (ip1.type == IPAddress::IPv4) {
-        return ip1.ipv4 <= ip2.ipv4;
-    } else {
-        return memcmp(ip1.ipv6.data(), ip2.ipv6.data(), 16) <= 0;
-    }
+
+    return visitFamily(ip1.type, [&](auto family) {
+        using Family = decltype(family);
+        return Family::fromAddress(ip1) <= Family::fromAddress(ip2);
+    });
 }
 
 // 将CIDR转换为起始和结束IP
@@ -115,39 +160,15 @@ std::pair<IPAddress, IPAddress> IPUtils::cidrToRange(const QString& cidr)
     
     int prefix = parts[1].toInt();
     IPAddress baseIP = stringToIP(parts[0]);
-    
-    if (baseIP.type == IPAddress::IPv4) {
-        if (prefix < 0 || prefix > 32) return {IPAddress(), IPAddress()};
-        
-        uint32_t mask = (prefix == 0) ? 0 : (~0U << (32 - prefix));
-        uint32_t start = baseIP.ipv4 & mask;
-        uint32_t end = start | (~mask);
-        
-        return {IPAddress(start), IPAddress(end)};
-    } else {
-        if (prefix < 0 || prefix > 128) return {IPAddress(), IPAddress()};
-        
-        std::array<uint8_t, 16> start = baseIP.ipv6;
-        std::array<uint8_t, 16> end = baseIP.ipv6;
-        
-        // 应用前缀掩码
-        int bytes = prefix / 8;
-        int bits = prefix % 8;
-        
-        // 清除网络部分之后的位
-        for (int i = bytes; i < 16; ++i) {
-            if (i == bytes && bits > 0) {
-                uint8_t mask = 0xFF << (8 - bits);
-                start[i] &= mask;
-                end[i] |= ~mask;
-            } else if (i > bytes) {
-                start[i] = 0;
-                end[i] = 0xFF;
-            }
-        }
-        
-        return {IPAddress(start), IPAddress(end)};
-    }
+
+    return visitFamily(baseIP.type, [&](auto family) -> std::pair<IPAddress, IPAddress> {
+        using Family = decltype(family);
+        if (prefix < 0 || prefix > Family::BITS) return {IPAddress(), IPAddress()};
+
+        const auto mask = Family::NETWORK_MASKS[prefix];
+        const auto start = Family::fromAddress(baseIP) & mask;
+        return {Family::toAddress(start), Family::toAddress(start | ~mask)};
+    });
 }
 
 // 获取CIDR范围内的IP数量
@@ -193,11 +214,7 @@ uint32_t IPUtils::ipToUint32(const QString& ip)
 // 32位无符号整数转为IP字符串
 QString IPUtils::uint32ToIP(uint32_t ip)
 {
-    return QString("%1.%2.%3.%4")
-        .arg((ip >> 24) & 0xFF)
-        .arg((ip >> 16) & 0xFF)
-        .arg((ip >> 8) & 0xFF)
-        .arg(ip & 0xFF);
+    return IPv4Family::toString(ip);
 }
 
 // 展开CIDR为IP列表，最多maxIPs个
@@ -218,6 +235,23 @@ QStringList IPUtils::expandCIDR(const QString& cidr, int maxIPs)
     return result;
 }
 
+// 解析端口列表
+std::vector<uint16_t> IPUtils::parsePortList(const QString& text)
+{
+    std::vector<uint16_t> ports;
+    const QStringList parts = text.split(QRegularExpression("[,，\\s]+"));
+    for (const QString& part : parts) {
+        if (part.isEmpty()) continue;
+        bool ok = false;
+        int port = part.toInt(&ok);
+        if (!ok || port < 1 || port > 65535) return {};
+        if (std::find(ports.begin(), ports.end(), static_cast<uint16_t>(port)) == ports.end()) {
+            ports.push_back(static_cast<uint16_t>(port));
+        }
+    }
+    return ports;
+}
+
 // 计算延迟（毫秒）
 double IPUtils::calculateLatency(const std::chrono::steady_clock::time_point& start,
                                const std::chrono::steady_clock::time_point& end)
@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <chrono>
 #include <array>
+#include <compare>
+#include <vector>
 
 // IP地址结构体，支持IPv4和IPv6
 struct IPAddress {
@@ -21,6 +23,158 @@ struct IPAddress {
     IPAddress(const std::array<uint8_t, 16>& ip) : type(IPv6), ipv6(ip) {}
 };
 
+// 128位无符号整数，IPv6地址按数值运算；编译器支持时为原生类型，否则为两个64位字
+#if defined(__SIZEOF_INT128__)
+using UInt128 = unsigned __int128;
+#else
+struct UInt128 {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    constexpr UInt128() = default;
+    constexpr UInt128(uint64_t value) : low(value) {}
+    constexpr UInt128(uint64_t h, uint64_t l) : high(h), low(l) {}
+    // 成员按高位在前声明，逐成员比较即数值比较
+    friend constexpr bool operator==(const UInt128&, const UInt128&) = default;
+    friend constexpr std::strong_ordering operator<=>(const UInt128&, const UInt128&) = default;
+    // 低位溢出时的进位由比较得到，不经分支
+    constexpr UInt128 operator+(uint64_t n) const { return UInt128(high + (low + n < low), low + n); }
+    constexpr UInt128 operator+(const UInt128& other) const
+    {
+        return UInt128(high + other.high + (low + other.low < low), low + other.low);
+    }
+    constexpr UInt128 operator-(const UInt128& other) const
+    {
+        return UInt128(high - other.high - (low < other.low), low - other.low);
+    }
+    constexpr UInt128 operator&(const UInt128& other) const { return UInt128(high & other.high, low & other.low); }
+    constexpr UInt128 operator|(const UInt128& other) const { return UInt128(high | other.high, low | other.low); }
+    constexpr UInt128 operator~() const { return UInt128(~high, ~low); }
+};
+#endif
+
+// 由高、低两个64位字组成128位整数
+constexpr UInt128 makeUInt128(uint64_t high, uint64_t low)
+{
+#if defined(__SIZEOF_INT128__)
+    return (static_cast<UInt128>(high) << 64) | low;
+#else
+    return UInt128(high, low);
+#endif
+}
+
+constexpr uint64_t highWord(UInt128 value)
+{
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>(value >> 64);
+#else
+    return value.high;
+#endif
+}
+
+constexpr uint64_t lowWord(UInt128 value)
+{
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>(value);
+#else
+    return value.low;
+#endif
+}
+
+// IPv4地址族：地址为32位无符号整数
+struct IPv4Family {
+    using Value = uint32_t;
+    static constexpr IPAddress::Type TYPE = IPAddress::IPv4;
+    static constexpr int BITS = 32;
+    static constexpr int MAX_TEXT = 15; // 文本形式的最大长度
+
+    // NETWORK_MASKS[p]为前缀长度p的网络掩码
+    static constexpr std::array<Value, BITS + 1> NETWORK_MASKS = [] {
+        std::array<Value, BITS + 1> masks{};
+        for (int p = 1; p <= BITS; ++p) masks[p] = ~0U << (BITS - p);
+        return masks;
+    }();
+
+    static Value fromAddress(const IPAddress& ip) { return ip.ipv4; }
+    static IPAddress toAddress(Value value) { return IPAddress(value); }
+    // 按模2^32回绕
+    static constexpr Value advance(Value value, uint64_t n) { return static_cast<Value>(value + n); }
+    // 点分十进制写入buffer（至少MAX_TEXT字节，不含结尾的0），返回长度
+    static int format(Value value, char* buffer);
+    static QString toString(Value value);
+};
+
+// IPv6地址族：地址为128位大端整数
+struct IPv6Family {
+    using Value = UInt128;
+    static constexpr IPAddress::Type TYPE = IPAddress::IPv6;
+    static constexpr int BITS = 128;
+
+    static constexpr std::array<Value, BITS + 1> NETWORK_MASKS = [] {
+        std::array<Value, BITS + 1> masks{};
+        for (int p = 1; p <= BITS; ++p) {
+            const uint64_t high = p >= 64 ? ~0ULL : ~0ULL << (64 - p);
+            const uint64_t low = p <= 64 ? 0 : ~0ULL << (128 - p);
+            masks[p] = makeUInt128(high, low);
+        }
+        return masks;
+    }();
+
+    static Value fromBytes(const std::array<uint8_t, 16>& bytes);
+    static std::array<uint8_t, 16> toBytes(Value value);
+    static Value fromAddress(const IPAddress& ip) { return fromBytes(ip.ipv6); }
+    static IPAddress toAddress(Value value) { return IPAddress(toBytes(value)); }
+    // 按模2^128回绕
+    static constexpr Value advance(Value value, uint64_t n) { return value + n; }
+    // 与QHostAddress的文本形式一致
+    static QString toString(Value value);
+};
+
+// 按地址族分派一次：以IPv4Family或IPv6Family的实例调用visit，
+// 调用方在visit内用该地址族的数值类型循环，循环中不再判断类型
+template <typename Visitor>
+decltype(auto) visitFamily(IPAddress::Type type, Visitor&& visit)
+{
+    if (type == IPAddress::IPv4) {
+        return visit(IPv4Family{});
+    }
+    return visit(IPv6Family{});
+}
+
+// 同一地址族中等间隔的一段地址：first、first + stride……共count个
+template <typename Family>
+struct AddressRange {
+    using Value = typename Family::Value;
+
+    class iterator {
+    public:
+        iterator(Value value, uint64_t index, uint64_t stride) : m_value(value), m_index(index), m_stride(stride) {}
+        Value operator*() const { return m_value; }
+        iterator& operator++()
+        {
+            m_value = Family::advance(m_value, m_stride);
+            ++m_index;
+            return *this;
+        }
+        // 只比较序号，越过末尾的地址回绕也不影响结束判断
+        bool operator==(const iterator& other) const { return m_index == other.m_index; }
+
+    private:
+        Value m_value;
+        uint64_t m_index;
+        uint64_t m_stride;
+    };
+
+    Value first{};
+    uint64_t count = 0;
+    uint64_t stride = 1;
+
+    iterator begin() const { return iterator(first, 0, stride); }
+    iterator end() const { return iterator(first, count, stride); }
+    // 第index个地址
+    Value at(uint64_t index) const { return Family::advance(first, index * stride); }
+};
+
 // IP工具类，提供IP和CIDR相关的静态方法
 class IPUtils
 {
@@ -39,6 +193,8 @@ public:
     static uint64_t getCIDRIPCount(const QString& cidr);
     // 展开CIDR为IP列表
     static QStringList expandCIDR(const QString& cidr, int maxIPs = -1);
+    // 解析端口列表（逗号或空白分隔，去重并保持顺序），含非法项或为空时返回空列表
+    static std::vector<uint16_t> parsePortList(const QString& text);
     // 计算延迟（毫秒）
     static double calculateLatency(const std::chrono::steady_clock::time_point& start,
                                  const std::chrono::steady_clock::time_point& end);
@@ -52,6 +208,8 @@ public:
     static std::array<uint8_t, 16> ipv6ToBytes(const QString& ipv6);
     static QString bytesToIPv6(const std::array<uint8_t, 16>& bytes);
     static IPAddress incrementIP(const IPAddress& ip);
+    // 地址加n（IPv6按128位大端整数进位）
+    static IPAddress advanceIP(const IPAddress& ip, uint64_t n);
     static bool compareIP(const IPAddress& ip1, const IPAddress& ip2);
 };
 
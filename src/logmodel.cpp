@@ -3,6 +3,7 @@
 
 LogModel::LogModel(QObject *parent)
     : QAbstractTableModel(parent)
+    , m_logs(MAX_LOG_COUNT)
     , m_updateTimer(new QTimer(this))
 {
     // 确保定时器在主线程中创建和运行
@@ -16,7 +17,7 @@ LogModel::LogModel(QObject *parent)
 int LogModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_logs.size();
+    return m_logs.count();
 }
 
 int LogModel::columnCount(const QModelIndex &parent) const
@@ -27,10 +28,10 @@ int LogModel::columnCount(const QModelIndex &parent) const
 
 QVariant LogModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || index.row() >= m_logs.size())
+    if (!index.isValid() || index.row() >= m_logs.count())
         return QVariant();
     
-    const LogEntry& entry = m_logs[index.row()];
+    const LogEntry& entry = m_logs.at(m_logs.firstIndex() + index.row());
     
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
@@ -71,6 +72,23 @@ void LogModel::addLogMessage(const QString& message)
     }
 }
 
+void LogModel::addLogEntries(const QVector<LogEntry>& entries)
+{
+    if (entries.isEmpty()) return;
+
+    QMutexLocker locker(&m_pendingMutex);
+    m_pendingLogs.append(entries);
+
+    // 只保留最新的MAX_LOG_COUNT条，避免后台批量转发时堆积
+    if (m_pendingLogs.size() > MAX_LOG_COUNT) {
+        m_pendingLogs.remove(0, m_pendingLogs.size() - MAX_LOG_COUNT);
+    }
+
+    if (!m_updateTimer->isActive()) {
+        QMetaObject::invokeMethod(m_updateTimer, "start", Qt::QueuedConnection);
+    }
+}
+
 void LogModel::clear()
 {
     beginResetModel();
@@ -102,28 +120,38 @@ void LogModel::processPendingUpdates()
         m_pendingLogs.clear();
     }
     
-    // 批量添加日志
-    int oldSize = m_logs.size();
-    m_logs.append(newLogs);
-    
-    // 限制日志数量，保留最新的日志
-    if (m_logs.size() > MAX_LOG_COUNT) {
-        int removeCount = m_logs.size() - MAX_LOG_COUNT;
-        m_logs.remove(0, removeCount);
-        
-        // 数据结构发生重大变化，重置模型
+    // 新日志超过容量时直接重建，避免逐行通知
+    if (newLogs.size() >= MAX_LOG_COUNT) {
         beginResetModel();
+        m_logs.clear();
+        for (int i = newLogs.size() - MAX_LOG_COUNT; i < newLogs.size(); ++i) {
+            m_logs.append(newLogs[i]);
+        }
+        m_logs.normalizeIndexes();
         endResetModel();
-    } else {
-        // 简单添加，通知视图
-        if (m_logs.size() > oldSize) {
-            beginInsertRows(QModelIndex(), oldSize, m_logs.size() - 1);
-            endInsertRows();
-            
-            // 自动滚动到最新日志
-            QTimer::singleShot(0, this, [this]() {
-                emit dataChanged(createIndex(m_logs.size() - 1, 0), createIndex(m_logs.size() - 1, 1));
-            });
+        return;
+    }
+
+    // 先移除会被挤出的最旧日志（环形缓存O(1)删除）
+    int overflow = m_logs.count() + newLogs.size() - MAX_LOG_COUNT;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        for (int i = 0; i < overflow; ++i) {
+            m_logs.removeFirst();
         }
+        endRemoveRows();
+    }
+
+    // 追加新日志，通知视图
+    int oldSize = m_logs.count();
+    beginInsertRows(QModelIndex(), oldSize, oldSize + newLogs.size() - 1);
+    for (const LogEntry& entry : newLogs) {
+        m_logs.append(entry);
+    }
+    endInsertRows();
+
+    // 索引单调增长，接近上限时归一化
+    if (!m_logs.areIndexesValid()) {
+        m_logs.normalizeIndexes();
     }
 }
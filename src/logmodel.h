@@ -3,6 +3,7 @@
 
 #include <QAbstractTableModel>
 #include <QVector>
+#include <QContiguousCache>
 #include <QString>
 #include <QTimer>
 #include <QDateTime>
@@ -15,6 +16,8 @@ struct LogEntry {
     
     LogEntry(const QString& msg = "")
         : timestamp(QDateTime::currentDateTime()), message(msg) {}
+    LogEntry(const QDateTime& time, const QString& msg)
+        : timestamp(time), message(msg) {}
 };
 
 class LogModel : public QAbstractTableModel
@@ -31,13 +34,14 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     
     void addLogMessage(const QString& message);
+    void addLogEntries(const QVector<LogEntry>& entries); // 批量添加（带原始时间戳）
     void clear();
     
 private slots:
     void processPendingUpdates();
     
 private:
-    QVector<LogEntry> m_logs;
+    QContiguousCache<LogEntry> m_logs; // 环形缓存，超出容量时O(1)丢弃最旧日志
     QVector<LogEntry> m_pendingLogs;
     mutable QMutex m_pendingMutex;
     QTimer* m_updateTimer;
@@ -1,5 +1,7 @@
-#include <QtWidgets/QApplication>
 #include "mainwindow.h"
+#include <QtWidgets/QApplication>
+#include <QtWidgets/QMessageBox>
+#include <QtCore/QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
@@ -9,7 +11,38 @@ int main(int argc, char *argv[])
     app.setApplicationVersion("1.0");
     app.setOrganizationName("CFPing");
     
+    // 多机分片扫描：各机以相同的输入和不同的 --shard i/N 启动
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption shardOption("shard", "只扫描第i片（共N片，i从1开始）", "i/N");
+    QCommandLineOption shardModeOption("shard-mode", "分片方式：interleave（默认）或block", "mode", "interleave");
+    QCommandLineOption cpusOption("cpus", "扫描线程的CPU绑定：auto、node:N或CPU列表（如 0-7,16）", "placement");
+    parser.addOption(shardOption);
+    parser.addOption(shardModeOption);
+    parser.addOption(cpusOption);
+    parser.process(app);
+
+    ScanShard shard;
+    if (parser.isSet(shardOption)) {
+        if (!ScanShard::parse(parser.value(shardOption), shard)
+            || !ScanShard::parseMode(parser.value(shardModeOption), shard.mode)) {
+            QMessageBox::critical(nullptr, "CFPing", "分片参数无效，应为 --shard i/N [--shard-mode interleave|block]");
+            return 1;
+        }
+    }
+    if (parser.isSet(cpusOption)) {
+        ThreadPlacement placement;
+        QString error;
+        if (!ThreadPlacement::parse(parser.value(cpusOption), placement, &error)) {
+            QMessageBox::critical(nullptr, "CFPing", error);
+            return 1;
+        }
+    }
+    
     MainWindow window;
+    window.setShard(shard);
+    window.setPlacement(parser.value(cpusOption));
     window.show();
     
     return app.exec();
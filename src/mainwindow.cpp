@@ -2,36 +2,145 @@
 #include "pingworker.h"
 #include "pingresultmodel.h"
 #include "logmodel.h"
+#include "eventlog.h"
+#include "metricsserver.h"
+#include "socketfactory.h"
+#include "iputils.h"
+#include "cidrfile.h"
+#include "historystore.h"
+#include "monitor.h"
+#include "scanoutcome.h"
+#include "scanplan.h"
+#include "threadplacement.h"
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMessageBox>
+#include <QtWidgets/QDialog>
+#include <QtCore/QPointer>
+#include <QtGui/QStandardItemModel>
 #include <QClipboard>
 #include <QtCore/QTextStream>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
 #include <algorithm>
+#include <limits>
+
+namespace {
+
+// 时长格式化为 时:分:秒，超过一天时带天数
+QString formatDuration(double ms)
+{
+    qint64 seconds = static_cast<qint64>(ms / 1000.0 + 0.5);
+    const qint64 days = seconds / 86400;
+    seconds %= 86400;
+    QString text = QString("%1:%2:%3")
+                       .arg(seconds / 3600, 2, 10, QChar('0'))
+                       .arg(seconds % 3600 / 60, 2, 10, QChar('0'))
+                       .arg(seconds % 60, 2, 10, QChar('0'));
+    return days > 0 ? QString("%1天 %2").arg(days).arg(text) : text;
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), m_centralWidget(nullptr), m_pingWorker(nullptr), m_workerThread(nullptr), m_updateTimer(new QTimer(this)), m_isRunning(false), m_totalIPs(0), m_completedIPs(0)
+    : QMainWindow(parent), m_centralWidget(nullptr), m_pingWorker(nullptr), m_updateTimer(new QTimer(this)), m_metricsServer(std::make_unique<MetricsServer>()), m_isRunning(false), m_history(std::make_unique<HistoryStore>())
 {
     setupUI();
     setupConnections();
     m_updateTimer->setInterval(1000);
     connect(m_updateTimer, &QTimer::timeout, this, &MainWindow::updateResultsDisplay);
     enableControls(true);
+
+    // 后台日志线程格式化后分批转发到日志模型（模型内部线程安全）
+    LogModel *logModel = m_logModel;
+    EventLog::instance().setLineSink([logModel](std::vector<EventLog::Line> &&lines)
+                                     {
+        QVector<LogEntry> entries;
+        entries.reserve(static_cast<int>(lines.size()));
+        for (const auto &line : lines) {
+            entries.append(LogEntry(QDateTime::fromMSecsSinceEpoch(line.timestampMs),
+                                    QString::fromStdString(line.text)));
+        }
+        logModel->addLogEntries(entries); });
+    EventLog::instance().start();
+
     addLogMessage("应用程序已启动。请加载CIDR地址段开始测试。");
+
+    QString historyError;
+    if (!m_history->open(&historyError))
+    {
+        addLogMessage(QString("历史库不可用: %1").arg(historyError));
+        m_historyCheckBox->setChecked(false);
+    }
 }
 
 MainWindow::~MainWindow()
 {
-    if (m_isRunning)
+    // 先断开界面转发，再停止后台日志线程
+    EventLog::instance().setLineSink(nullptr);
+    EventLog::instance().stop();
+
+    stopFileSummary();
+    stopEstimate();
+    stopHistoryQuery();
+    stopOutcomeSave();
+
+    // 任务对象析构时取消并等待任务结束，引擎析构时回收工作线程
+    m_speedTestWorker.reset();
+    m_pingWorker.reset();
+    m_monitor.reset();
+    m_scanEngine.reset();
+    m_historyWriter.reset(); // 等待最后一次扫描封存完成
+
+    m_metricsServer->stop();
+}
+
+ScanEngine &MainWindow::ensureScanEngine()
+{
+    int threadCount = m_threadCountSpinBox->value();
+    ThreadPlacement placement;
+    QString placementError;
+    if (!ThreadPlacement::parse(m_placementEdit->text(), placement, &placementError))
     {
-        stopPing();
+        addLogMessage(placementError + "，不绑定CPU。");
     }
-
-    if (m_workerThread && m_workerThread->isRunning())
+    bool changed = m_scanEngine && (m_scanEngine->threadCount() != threadCount ||
+                                    m_scanEngine->placement().toString() != placement.toString());
+    bool busy = (m_pingWorker && m_isRunning) || (m_monitor && m_monitor->isRunning());
+    if (!m_scanEngine || (changed && !busy))
+    {
+        // 监控与扫描任务都引用引擎，重建前先释放
+        m_pingWorker.reset();
+        m_monitor.reset();
+        m_scanEngine.reset();
+        m_scanEngine = std::make_unique<ScanEngine>(threadCount, placement);
+
+        // 界面线程与日志线程让出工作线程的CPU；不绑定时恢复为全部CPU
+        ThreadPlacement::bindCurrentThread(m_scanEngine->otherCpus());
+        EventLog::instance().setThreadCpus(m_scanEngine->otherCpus());
+        for (const QString &line : m_scanEngine->placementReport().split('\n'))
+        {
+            addLogMessage(line);
+        }
+    }
+    else if (changed)
     {
-        m_workerThread->quit();
-        m_workerThread->wait(3000);
+        addLogMessage(QString("引擎正在使用，继续使用 %1 个线程（CPU绑定 %2）。")
+                          .arg(m_scanEngine->threadCount())
+                          .arg(m_scanEngine->placement().toString()));
     }
+    return *m_scanEngine;
+}
+
+void MainWindow::setPlacement(const QString &placement)
+{
+    m_placementEdit->setText(placement);
+}
+
+void MainWindow::setShard(const ScanShard &shard)
+{
+    m_shardEdit->setText(shard.isActive() ? shard.toString() : QString());
+    m_shardModeComboBox->setCurrentIndex(m_shardModeComboBox->findData(static_cast<int>(shard.mode)));
 }
 
 void MainWindow::setupUI()
@@ -56,6 +165,10 @@ void MainWindow::setupUI()
     QHBoxLayout *fileLayout = new QHBoxLayout();
     m_openFileButton = new QPushButton("打开文件");
     fileLayout->addWidget(m_openFileButton);
+    m_clearFileButton = new QPushButton("手动输入");
+    m_clearFileButton->setToolTip("放弃已映射的文件，恢复在输入框中编辑CIDR");
+    m_clearFileButton->setEnabled(false);
+    fileLayout->addWidget(m_clearFileButton);
     fileLayout->addStretch();
     leftLayout->addLayout(fileLayout);
 
@@ -81,25 +194,156 @@ void MainWindow::setupUI()
     settingsLayout->addWidget(m_concurrentTasksSpinBox, 2, 1);
 
     settingsLayout->addWidget(new QLabel("端口号:"), 3, 0);
-    m_portSpinBox = new QSpinBox();
-    m_portSpinBox->setRange(1, 65535);
-    m_portSpinBox->setValue(80);
-    settingsLayout->addWidget(m_portSpinBox, 3, 1);
+    m_portsEdit = new QLineEdit("80");
+    m_portsEdit->setToolTip("多个端口用逗号分隔，例如 80,443,2053,8443\n"
+                            "每个地址的各端口在同一轮扫描中交错探测，共享并发上限，结果按地址合并");
+    settingsLayout->addWidget(m_portsEdit, 3, 1);
+
+    settingsLayout->addWidget(new QLabel("探测方式:"), 4, 0);
+    m_probeTypeComboBox = new QComboBox();
+    m_probeTypeComboBox->addItem("TCP连接", static_cast<int>(ProbeType::Tcp));
+    m_probeTypeComboBox->addItem("HTTP trace", static_cast<int>(ProbeType::Http));
+    m_probeTypeComboBox->addItem("TLS握手", static_cast<int>(ProbeType::Tls));
+    m_probeTypeComboBox->setToolTip("HTTP trace: 握手后请求 /cdn-cgi/trace，按首字节时间排序并显示应答机房\n"
+                                    "TLS握手: 完成TLS 1.3握手，按握手完成时间排序");
+    settingsLayout->addWidget(m_probeTypeComboBox, 4, 1);
+
+    settingsLayout->addWidget(new QLabel("主机名:"), 5, 0);
+    m_hostNameEdit = new QLineEdit("cloudflare.com");
+    m_hostNameEdit->setToolTip("HTTP trace的Host头 / TLS握手的SNI");
+    m_hostNameEdit->setEnabled(false);
+    settingsLayout->addWidget(m_hostNameEdit, 5, 1);
 
     m_enableLoggingCheckBox = new QCheckBox("启用详细日志");
-    settingsLayout->addWidget(m_enableLoggingCheckBox, 4, 0, 1, 2);
+    settingsLayout->addWidget(m_enableLoggingCheckBox, 6, 0, 1, 2);
+
+    m_logFileEdit = new QLineEdit();
+    m_logFileEdit->setPlaceholderText("日志文件路径 (可选)");
+    settingsLayout->addWidget(m_logFileEdit, 7, 0, 1, 2);
+
+    settingsLayout->addWidget(new QLabel("指标端口 (127.0.0.1):"), 8, 0);
+    m_metricsPortSpinBox = new QSpinBox();
+    m_metricsPortSpinBox->setRange(0, 65535);
+    m_metricsPortSpinBox->setValue(0);
+    m_metricsPortSpinBox->setSpecialValueText("关闭");
+    m_metricsPortSpinBox->setToolTip("在本机开放 /metrics (Prometheus文本格式)，0为关闭");
+    settingsLayout->addWidget(m_metricsPortSpinBox, 8, 1);
+
+    settingsLayout->addWidget(new QLabel("测速地址:"), 9, 0);
+    m_speedTestUrlEdit = new QLineEdit("25000000");
+    m_speedTestUrlEdit->setToolTip(QString("下载地址 (http/https)，只填数字时为字节数，使用 %1<字节数>")
+                                       .arg(SpeedTest::DEFAULT_URL));
+    settingsLayout->addWidget(m_speedTestUrlEdit, 9, 1);
+
+    settingsLayout->addWidget(new QLabel("测速数量 / 并发:"), 10, 0);
+    QHBoxLayout *speedTestLayout = new QHBoxLayout();
+    m_speedTestCountSpinBox = new QSpinBox();
+    m_speedTestCountSpinBox->setRange(1, 100);
+    m_speedTestCountSpinBox->setValue(10);
+    m_speedTestCountSpinBox->setToolTip("对延迟最低的前K个IP测速");
+    m_speedTestParallelSpinBox = new QSpinBox();
+    m_speedTestParallelSpinBox->setRange(1, 8);
+    m_speedTestParallelSpinBox->setValue(2);
+    m_speedTestParallelSpinBox->setToolTip("同时测速的IP数，过多会互相争抢带宽");
+    speedTestLayout->addWidget(m_speedTestCountSpinBox);
+    speedTestLayout->addWidget(m_speedTestParallelSpinBox);
+    settingsLayout->addLayout(speedTestLayout, 10, 1);
+
+    m_abortiveCloseCheckBox = new QCheckBox("RST关闭连接");
+    m_abortiveCloseCheckBox->setToolTip("探测成功后以RST (SO_LINGER 0) 关闭连接，本机不留TIME_WAIT；\n"
+                                        "长时间高并发扫描时避免临时端口耗尽");
+    m_kernelRttCheckBox = new QCheckBox("内核RTT");
+    m_kernelRttCheckBox->setToolTip("连接成功后从TCP_INFO读取内核测得的握手RTT，TCP探测按它排序；\n"
+                                    "用户态计时包含调度排队，并发越高越偏大，两者都会保存（Linux/macOS）");
+    QHBoxLayout *socketOptionsLayout = new QHBoxLayout();
+    socketOptionsLayout->addWidget(m_abortiveCloseCheckBox);
+    socketOptionsLayout->addWidget(m_kernelRttCheckBox);
+    settingsLayout->addLayout(socketOptionsLayout, 11, 0, 1, 2);
+
+    settingsLayout->addWidget(new QLabel("分片 (i/N):"), 12, 0);
+    QHBoxLayout *shardLayout = new QHBoxLayout();
+    m_shardEdit = new QLineEdit();
+    m_shardEdit->setPlaceholderText("不分片");
+    m_shardEdit->setToolTip("多台机器分担同一批地址：第i台填 i/N（i从1开始），N台合起来恰好覆盖全部地址一次\n"
+                            "各机保存的CSV结果可用 cfping-merge 合并为一个排名");
+    m_shardModeComboBox = new QComboBox();
+    m_shardModeComboBox->addItem("交错", static_cast<int>(ScanShard::Mode::Interleave));
+    m_shardModeComboBox->addItem("连续块", static_cast<int>(ScanShard::Mode::Block));
+    m_shardModeComboBox->setToolTip("交错: 按序号对N取模分配，每片均匀分布在各网段中\n"
+                                    "连续块: 按序号切成N段，文件输入需要先统计地址总数");
+    shardLayout->addWidget(m_shardEdit);
+    shardLayout->addWidget(m_shardModeComboBox);
+    settingsLayout->addLayout(shardLayout, 12, 1);
+
+    m_historyCheckBox = new QCheckBox("记录历史");
+    m_historyCheckBox->setChecked(true);
+    m_historyCheckBox->setToolTip(QString("把每次扫描的结果写入本地历史库，用于跨多次扫描的稳定性排名\n"
+                                          "每个地址（含失败）一条40字节的记录：/16约2.6MB，/8约670MB；\n"
+                                          "超过%1个地址的扫描开始前询问，默认不记录\n%2")
+                                      .arg(HISTORY_CONFIRM_ADDRESSES)
+                                      .arg(QDir::toNativeSeparators(m_history->directory())));
+    settingsLayout->addWidget(m_historyCheckBox, 13, 0, 1, 2);
+
+    settingsLayout->addWidget(new QLabel("先验文件:"), 14, 0);
+    QHBoxLayout *priorLayout = new QHBoxLayout();
+    m_priorEdit = new QLineEdit();
+    m_priorEdit->setPlaceholderText("不使用（按输入顺序扫描）");
+    m_priorEdit->setToolTip("热启动：以前保存的CSV结果、cfping-history best --subnet 的输出或IP列表\n"
+                            "历史上成功过的网段按评分先扫描，没有记录的其次，从未成功的最后");
+    m_priorButton = new QPushButton("选择...");
+    priorLayout->addWidget(m_priorEdit);
+    priorLayout->addWidget(m_priorButton);
+    settingsLayout->addLayout(priorLayout, 14, 1);
+
+    settingsLayout->addWidget(new QLabel("提前停止:"), 15, 0);
+    QHBoxLayout *earlyStopLayout = new QHBoxLayout();
+    m_stopAfterSpinBox = new QSpinBox();
+    m_stopAfterSpinBox->setRange(0, 1000000);
+    m_stopAfterSpinBox->setValue(0);
+    m_stopAfterSpinBox->setSpecialValueText("不启用");
+    m_stopAfterSpinBox->setSuffix(" 个结果");
+    m_stopAfterSpinBox->setToolTip("得到这么多个合格的成功结果后结束扫描，配合先验文件可在几秒内得到可用的IP");
+    m_stopLatencySpinBox = new QSpinBox();
+    m_stopLatencySpinBox->setRange(0, 10000);
+    m_stopLatencySpinBox->setValue(0);
+    m_stopLatencySpinBox->setSpecialValueText("不限延迟");
+    m_stopLatencySpinBox->setSuffix(" 毫秒");
+    m_stopLatencySpinBox->setToolTip("只有延迟不超过此值的成功结果计入提前停止，0为不限");
+    earlyStopLayout->addWidget(m_stopAfterSpinBox);
+    earlyStopLayout->addWidget(m_stopLatencySpinBox);
+    settingsLayout->addLayout(earlyStopLayout, 15, 1);
+
+    settingsLayout->addWidget(new QLabel("CPU绑定:"), 16, 0);
+    m_placementEdit = new QLineEdit();
+    m_placementEdit->setPlaceholderText("不绑定");
+    m_placementEdit->setToolTip(QString("把扫描线程固定在指定CPU上，减少跨核心/跨NUMA节点迁移带来的速率波动：\n"
+                                        "auto: 在CPU最多的节点上每个线程独占一个物理核心\n"
+                                        "node:N: 只在NUMA节点N上运行\n"
+                                        "0-7,16: 依次绑定到列出的CPU\n"
+                                        "界面与日志线程会让出这些CPU\n%1")
+                                    .arg(CpuTopology::system().summary()));
+    settingsLayout->addWidget(m_placementEdit, 16, 1);
 
     leftLayout->addLayout(settingsLayout);
 
     // 控制按钮
     QHBoxLayout *controlLayout = new QHBoxLayout();
     m_startButton = new QPushButton("开始测试");
+    m_estimateButton = new QPushButton("预估");
+    m_estimateButton->setToolTip("列出扫描计划（各范围与总地址数、重叠部分）并估计耗时，不发起连接");
     m_stopButton = new QPushButton("停止");
     m_saveButton = new QPushButton("保存结果");
+    m_speedTestButton = new QPushButton("测速");
+    m_historyButton = new QPushButton("历史");
+    m_monitorButton = new QPushButton("监控");
 
     controlLayout->addWidget(m_startButton);
+    controlLayout->addWidget(m_estimateButton);
     controlLayout->addWidget(m_stopButton);
     controlLayout->addWidget(m_saveButton);
+    controlLayout->addWidget(m_speedTestButton);
+    controlLayout->addWidget(m_historyButton);
+    controlLayout->addWidget(m_monitorButton);
 
     leftLayout->addLayout(controlLayout);
 
@@ -187,6 +431,10 @@ void MainWindow::setupUI()
     QVBoxLayout *mainLayout = new QVBoxLayout(m_centralWidget);
     mainLayout->addWidget(m_mainSplitter);
 
+    // 状态栏 - 引擎实时指标
+    m_metricsStatusLabel = new QLabel();
+    statusBar()->addPermanentWidget(m_metricsStatusLabel, 1);
+
     setWindowTitle("CloudFlare CDN IP TCP连接测试工具");
     setMinimumSize(1000, 700);
     resize(1200, 800);
@@ -195,10 +443,24 @@ void MainWindow::setupUI()
 void MainWindow::setupConnections()
 {
     connect(m_openFileButton, &QPushButton::clicked, this, &MainWindow::openFile);
+    connect(m_clearFileButton, &QPushButton::clicked, this, &MainWindow::clearCidrFile);
     connect(m_startButton, &QPushButton::clicked, this, &MainWindow::startPing);
+    connect(m_estimateButton, &QPushButton::clicked, this, &MainWindow::estimateScan);
     connect(m_stopButton, &QPushButton::clicked, this, &MainWindow::stopPing);
     connect(m_saveButton, &QPushButton::clicked, this, &MainWindow::saveResults);
+    connect(m_speedTestButton, &QPushButton::clicked, this, &MainWindow::startSpeedTest);
+    connect(m_historyButton, &QPushButton::clicked, this, &MainWindow::showHistory);
+    connect(m_monitorButton, &QPushButton::clicked, this, &MainWindow::showMonitor);
+    connect(m_priorButton, &QPushButton::clicked, this, [this]()
+            {
+        QString fileName = QFileDialog::getOpenFileName(this, "选择先验文件", QString(),
+                                                        "结果或评分文件 (*.csv *.txt);;所有文件 (*)");
+        if (!fileName.isEmpty()) {
+            m_priorEdit->setText(fileName);
+        } });
     connect(m_copyButton, &QPushButton::clicked, this, &MainWindow::copySelectedIPs);
+    connect(m_metricsPortSpinBox, &QSpinBox::editingFinished, this, &MainWindow::updateMetricsServer);
+    connect(m_probeTypeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onProbeTypeChanged);
 }
 
 void MainWindow::openFile()
@@ -206,20 +468,150 @@ void MainWindow::openFile()
     QString fileName = QFileDialog::getOpenFileName(this,
                                                     "打开CIDR文件", "", "文本文件 (*.txt);;所有文件 (*)");
 
-    if (!fileName.isEmpty())
+    if (fileName.isEmpty())
+        return;
+
+    // 大文件不载入输入框，扫描时直接从映射中按需读取
+    if (QFileInfo(fileName).size() > INLINE_FILE_BYTES)
     {
-        QFile file(fileName);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+        loadCidrFile(fileName);
+        return;
+    }
+
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        clearCidrFile();
+        QTextStream in(&file);
+        m_cidrTextEdit->setPlainText(in.readAll());
+        addLogMessage(QString("已加载CIDR文件: %1").arg(fileName));
+    }
+    else
+    {
+        QMessageBox::warning(this, "错误", "无法打开文件。");
+    }
+}
+
+void MainWindow::loadCidrFile(const QString &fileName)
+{
+    auto source = std::make_shared<CidrFileSource>();
+    QString error;
+    if (!source->open(fileName, &error))
+    {
+        QMessageBox::warning(this, "错误", QString("无法映射文件: %1").arg(error));
+        return;
+    }
+
+    stopFileSummary();
+    m_cidrFile = source;
+    m_cidrTextEdit->setReadOnly(true);
+    m_cidrTextEdit->setPlainText(QString("文件: %1\n大小: %2 MB\n正在统计行数与地址数，可以直接开始扫描...")
+                                     .arg(QDir::toNativeSeparators(fileName))
+                                     .arg(source->size() / 1048576.0, 0, 'f', 1));
+    m_clearFileButton->setEnabled(!m_isRunning);
+    addLogMessage(QString("已映射CIDR文件: %1").arg(fileName));
+
+    // 统计在后台完成，扫描不必等待；结果只在文件仍是当前输入时显示
+    m_fileSummaryCancel = false;
+    m_fileSummaryThread = std::thread([this, source]() {
+        CidrFileSummary summary = source->summarize(&m_fileSummaryCancel);
+        if (summary.cancelled)
+            return;
+        QMetaObject::invokeMethod(this, [this, source, summary]() {
+            if (source != m_cidrFile)
+                return;
+            showFileSummary(summary);
+            if (m_startAfterSummary)
+            {
+                m_startAfterSummary = false;
+                enableControls(true);
+                startPing();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::showFileSummary(const CidrFileSummary &summary)
+{
+    QString text = QString("文件: %1\n大小: %2 MB\n行数: %3\n有效条目: %4\n地址数: %5\n解析错误: %6")
+                       .arg(QDir::toNativeSeparators(m_cidrFile->path()))
+                       .arg(m_cidrFile->size() / 1048576.0, 0, 'f', 1)
+                       .arg(summary.lineCount)
+                       .arg(summary.entryCount)
+                       .arg(summary.addressCount)
+                       .arg(summary.errorCount);
+    for (const CidrParseError &error : summary.errors)
+    {
+        text += QString("\n  第%1行: %2").arg(error.line).arg(error.text);
+    }
+    if (summary.errorCount > summary.errors.size())
+    {
+        text += QString("\n  ... 另有 %1 行错误未列出").arg(summary.errorCount - summary.errors.size());
+    }
+    m_cidrTextEdit->setPlainText(text);
+}
+
+void MainWindow::clearCidrFile()
+{
+    if (!m_cidrFile)
+        return;
+    stopFileSummary();
+    m_cidrFile.reset();
+    m_cidrTextEdit->setReadOnly(false);
+    m_cidrTextEdit->clear();
+    m_clearFileButton->setEnabled(false);
+}
+
+void MainWindow::stopFileSummary()
+{
+    if (m_fileSummaryThread.joinable())
+    {
+        m_fileSummaryCancel = true;
+        m_fileSummaryThread.join();
+    }
+}
+
+bool MainWindow::collectScanInput(QStringList &cidrRanges, std::vector<uint16_t> &ports, ScanShard &shard)
+{
+    // 文件输入时输入框只是摘要，地址段由扫描引擎从映射中读取
+    cidrRanges.clear();
+    if (!m_cidrFile)
+    {
+        QString cidrText = m_cidrTextEdit->toPlainText();
+        for (const QString &line : cidrText.split('\n'))
         {
-            QTextStream in(&file);
-            m_cidrTextEdit->setPlainText(in.readAll());
-            addLogMessage(QString("已加载CIDR文件: %1").arg(fileName));
+            QString trimmed = line.trimmed();
+            if (!trimmed.isEmpty() && !trimmed.startsWith('#'))
+            {
+                cidrRanges.append(trimmed);
+            }
         }
-        else
+    }
+
+    if (cidrRanges.isEmpty() && !m_cidrFile)
+    {
+        QMessageBox::warning(this, "警告", "请至少输入一个CIDR地址段。");
+        return false;
+    }
+
+    ports = IPUtils::parsePortList(m_portsEdit->text());
+    if (ports.empty())
+    {
+        QMessageBox::warning(this, "警告", "端口号无效，请输入1-65535之间的端口，多个端口用逗号分隔。");
+        return false;
+    }
+
+    shard = ScanShard();
+    if (!m_shardEdit->text().trimmed().isEmpty())
+    {
+        if (!ScanShard::parse(m_shardEdit->text(), shard))
         {
-            QMessageBox::warning(this, "错误", "无法打开文件。");
+            QMessageBox::warning(this, "警告", "分片格式无效，请填写 i/N，其中 1 ≤ i ≤ N。");
+            return false;
         }
+        shard.mode = static_cast<ScanShard::Mode>(m_shardModeComboBox->currentData().toInt());
     }
+    return true;
 }
 
 void MainWindow::startPing()
@@ -227,31 +619,72 @@ void MainWindow::startPing()
     if (m_isRunning)
         return;
 
-    QString cidrText = m_cidrTextEdit->toPlainText();
     QStringList cidrRanges;
+    std::vector<uint16_t> ports;
+    ScanShard shard;
+    if (!collectScanInput(cidrRanges, ports, shard))
+        return;
+    // 预估与扫描争用CPU与文件读取，开始扫描时不再等它的结果
+    stopEstimate();
 
-    for (const QString &line : cidrText.split('\n'))
+    // 连续块分片要按文件的地址总数划分，后台统计未完成时等它完成再提交，不在界面线程上同步统计
+    uint64_t fileTotal = 0;
+    if (m_cidrFile && shard.isActive() && shard.mode == ScanShard::Mode::Block && !m_cidrFile->addressCount(fileTotal))
     {
-        QString trimmed = line.trimmed();
-        if (!trimmed.isEmpty() && !trimmed.startsWith('#'))
-        {
-            cidrRanges.append(trimmed);
-        }
+        m_startAfterSummary = true;
+        enableControls(false);
+        m_statusLabel->setText("等待文件统计完成...");
+        addLogMessage("连续块分片需要文件的地址总数，统计完成后自动开始扫描");
+        return;
     }
 
-    if (cidrRanges.isEmpty())
+    // 先验文件每次开始时重新读取，文件可能已被上一次扫描的结果覆盖
+    std::shared_ptr<ScanPrior> prior;
+    QString priorFile = m_priorEdit->text().trimmed();
+    if (!priorFile.isEmpty())
     {
-        QMessageBox::warning(this, "警告", "请至少输入一个CIDR地址段。");
-        return;
+        prior = std::make_shared<ScanPrior>();
+        QString error;
+        if (!prior->load(priorFile, &error))
+        {
+            QMessageBox::warning(this, "警告", QString("无法读取先验文件: %1").arg(error));
+            return;
+        }
     }
 
+    const bool recordHistory = m_historyCheckBox->isChecked() && confirmHistoryCost(cidrRanges, shard);
+
     m_isRunning = true;
-    m_completedIPs = 0;
-    m_totalIPs = 0;
+    m_scanStats = ScanJobStats();
     m_startTime = QDateTime::currentDateTime(); // 记录开始时间
 
     // 清空结果模型
     m_resultsModel->clear();
+    m_resultsModel->setPorts(ports);
+
+    // 失败的地址不进入结果模型，另记入位图，可导出不可达/未探测的网段并与以后的扫描比较
+    m_outcome = std::make_unique<ScanOutcome>();
+    for (const QString &range : cidrRanges)
+    {
+        m_outcome->addScope(CidrExpander::toCidr(range));
+    }
+    m_outcomeFile = m_cidrFile;
+
+    // 上一次扫描的封存若未完成，在此等待；新的写入器只在勾选时创建
+    m_historyWriter.reset();
+    if (recordHistory)
+    {
+        QString label = QString("%1 %2").arg(m_probeTypeComboBox->currentText(), m_portsEdit->text().trimmed());
+        if (shard.isActive())
+        {
+            label += QString(" shard %1").arg(shard.toString());
+        }
+        m_historyWriter = m_history->beginRun(label);
+        if (!m_historyWriter)
+        {
+            addLogMessage("无法创建历史记录文件，本次扫描不记录历史。");
+        }
+    }
 
     // 清空日志
     m_logModel->clear();
@@ -259,27 +692,25 @@ void MainWindow::startPing()
     // 创建工作线程
     try
     {
-        m_pingWorker = std::make_unique<PingWorker>();
-        m_workerThread = new QThread(this);
-        m_pingWorker->moveToThread(m_workerThread);
+        m_pingWorker.reset();
+        m_pingWorker = std::make_unique<PingWorker>(ensureScanEngine());
 
-        // 使用临时变量存储设置，避免lambda捕获this
-        int threadCount = m_threadCountSpinBox->value();
+        // 使用临时变量存储设置
         int timeout = m_timeoutSpinBox->value();
         int maxConcurrentTasks = m_concurrentTasksSpinBox->value();
-        int port = m_portSpinBox->value(); // 获取端口号
-        bool enableLogging = m_enableLoggingCheckBox->isChecked();
+        ProbeType probeType = currentProbeType();
         QStringList ranges = cidrRanges;
 
-        // 连接信号
-        connect(m_workerThread, &QThread::started, [this, threadCount, timeout, enableLogging, maxConcurrentTasks, port, ranges]()
-                {
-            if (m_pingWorker) {
-                m_pingWorker->setSettings(threadCount, timeout, enableLogging, maxConcurrentTasks, port);
-                m_pingWorker->startPing(ranges);
-            } });
+        // 日志级别在格式化之前检查，未开启详细日志时探测不产生日志开销
+        EventLog::setLevel(m_enableLoggingCheckBox->isChecked() ? LogLevel::Debug : LogLevel::Info);
+        QString logFile = m_logFileEdit->text().trimmed();
+#ifdef Q_OS_WIN
+        EventLog::instance().setLogFile(std::filesystem::path(logFile.toStdWString()));
+#else
+        EventLog::instance().setLogFile(std::filesystem::path(QFile::encodeName(logFile).toStdString()));
+#endif
 
-        // 使用Qt::QueuedConnection确保信号在主线程中处理
+        // 使用Qt::QueuedConnection确保信号在主线程中处理（结果从引擎的工作线程发出）
         connect(m_pingWorker.get(), &PingWorker::pingResult, this, &MainWindow::onPingResult, Qt::QueuedConnection);
         connect(m_pingWorker.get(), &PingWorker::progress, this, &MainWindow::onPingProgress, Qt::QueuedConnection);
         connect(m_pingWorker.get(), &PingWorker::logMessage, this, &MainWindow::onPingLog, Qt::QueuedConnection);
@@ -287,12 +718,29 @@ void MainWindow::startPing()
 
         // 更新UI状态
         enableControls(false);
+        m_lastMetrics = MetricsRegistry::instance().snapshot();
         m_updateTimer->start();
 
-        // 启动线程
-        m_workerThread->start();
-
-        addLogMessage(QString("开始TCP连接测试 (端口%1)...").arg(port));
+        // 提交任务
+        m_pingWorker->setSettings(timeout, maxConcurrentTasks, ports);
+        m_pingWorker->setProbeType(probeType, m_hostNameEdit->text());
+        m_pingWorker->setAbortiveClose(m_abortiveCloseCheckBox->isChecked());
+        m_pingWorker->setKernelRtt(m_kernelRttCheckBox->isChecked());
+        m_pingWorker->setInputFile(m_cidrFile);
+        m_pingWorker->setShard(shard);
+        m_pingWorker->setPrior(prior);
+        m_pingWorker->setEarlyStop(static_cast<uint64_t>(m_stopAfterSpinBox->value()), m_stopLatencySpinBox->value());
+        m_pingWorker->startPing(ranges);
+
+        QStringList portNames;
+        for (uint16_t port : ports)
+        {
+            portNames.append(QString::number(port));
+        }
+        const QString probeName = probeType == ProbeType::Http  ? QString("HTTP trace")
+                                  : probeType == ProbeType::Tls ? QString("TLS握手")
+                                                                : QString("TCP连接");
+        addLogMessage(QString("开始%1测试 (端口%2)...").arg(probeName, portNames.join(',')));
     }
     catch (const std::exception &e)
     {
@@ -302,8 +750,169 @@ void MainWindow::startPing()
     }
 }
 
+// 只解析范围端点做算术，不展开地址。文件输入要读一遍全部条目，与文件统计一样在后台线程完成，
+// 计划整理成日志行后交回界面线程输出；再次点击时取消上一次
+void MainWindow::estimateScan()
+{
+    if (m_isRunning)
+        return;
+
+    QStringList cidrRanges;
+    std::vector<uint16_t> ports;
+    ScanShard shard;
+    if (!collectScanInput(cidrRanges, ports, shard))
+        return;
+
+    stopEstimate();
+    addLogMessage("正在计算扫描计划...");
+    const int concurrency = m_concurrentTasksSpinBox->value();
+    const int timeoutMs = m_timeoutSpinBox->value();
+    m_estimateCancel = false;
+    m_estimateThread = std::thread([this, source = m_cidrFile, cidrRanges, portCount = ports.size(), shard,
+                                    concurrency, timeoutMs]() {
+        QElapsedTimer timer;
+        timer.start();
+        ScanPlan plan;
+        if (source)
+        {
+            plan.addFile(*source, &m_estimateCancel);
+        }
+        for (const QString &range : cidrRanges)
+        {
+            plan.add(range);
+        }
+        if (m_estimateCancel)
+            return;
+        const AddressCount unique = plan.uniqueCount();
+
+        // 最近一次有记录的扫描的实测速率（每个地址一条历史记录）。崩溃后恢复的扫描以最后一条记录的时间为结束，
+        // 提前停止的扫描只计已完成的部分，两者同样是记录数除以实际时长
+        double measuredRate = 0.0;
+        const QVector<HistoryRun> runs = m_history->runs();
+        for (auto it = runs.crbegin(); it != runs.crend(); ++it)
+        {
+            if (it->recordCount > 0 && it->finishedMs > it->startedMs)
+            {
+                measuredRate = it->recordCount * 1000.0 / (it->finishedMs - it->startedMs);
+                break;
+            }
+        }
+        const ScanEstimate estimate = plan.estimate(shard, portCount, concurrency, timeoutMs, measuredRate);
+
+        QStringList lines;
+        lines.append(QString("扫描计划：%1 个范围，共 %2 个地址，%3%4")
+                         .arg(plan.rangeCount())
+                         .arg(plan.addressCount().toString())
+                         .arg(plan.hasUniqueCount() ? QString("去重后 %1 个").arg(unique.toString())
+                                                    : QString("互不相连的区间过多，未去重"))
+                         .arg(plan.invalidCount() > 0 ? QString("（%1 条无效输入已跳过）").arg(plan.invalidCount()) : QString()));
+        for (const ScanPlanRange &range : plan.ranges())
+        {
+            lines.append(range.addresses.toDouble() > static_cast<double>(range.scanned)
+                             ? QString("  %1: %2 个地址，只扫描前 %3 个").arg(range.cidr, range.addresses.toString()).arg(range.scanned)
+                             : QString("  %1: %2 个地址").arg(range.cidr, range.addresses.toString()));
+        }
+        if (plan.rangeCount() > plan.ranges().size())
+        {
+            lines.append(QString("  ……其余 %1 个范围未列出").arg(plan.rangeCount() - plan.ranges().size()));
+        }
+        const AddressCount overlap = plan.addressCount().minus(unique);
+        if (plan.hasUniqueCount() && !overlap.isZero())
+        {
+            lines.append(QString("范围之间有 %1 个地址重叠，扫描时会重复探测").arg(overlap.toString()));
+        }
+        lines.append(QString("将扫描 %1 个地址%2 × %3 个端口 = %4 次探测")
+                         .arg(estimate.addresses)
+                         .arg(shard.isActive() ? QString("（分片 %1）").arg(shard.toString()) : QString())
+                         .arg(portCount)
+                         .arg(estimate.probes));
+        lines.append(QString("预计耗时：全部超时时最长 %1（并发 %2，超时 %3 毫秒）")
+                         .arg(formatDuration(estimate.timeoutBoundMs))
+                         .arg(concurrency)
+                         .arg(std::min(timeoutMs, ScanEngine::MAX_PROBE_TIMEOUT_MS)));
+        lines.append(estimate.measuredMs >= 0.0
+                         ? QString("按最近一次扫描的实测速率 %1 个地址/秒：约 %2")
+                               .arg(estimate.measuredRate, 0, 'f', 0)
+                               .arg(formatDuration(estimate.measuredMs))
+                         : QString("没有历史扫描记录，无法按实测速率估计"));
+        lines.append(QString("计划计算用时 %1 毫秒").arg(timer.elapsed()));
+
+        QMetaObject::invokeMethod(this, [this, lines]() {
+            for (const QString &line : lines)
+            {
+                addLogMessage(line);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::stopEstimate()
+{
+    if (m_estimateThread.joinable())
+    {
+        m_estimateCancel = true;
+        m_estimateThread.join();
+    }
+}
+
+void MainWindow::stopHistoryQuery()
+{
+    if (m_historyQueryThread.joinable())
+    {
+        m_historyQueryCancel = true;
+        m_historyQueryThread.join();
+    }
+}
+
+// 历史每个地址（含失败）一条40字节的记录，封存时还要映射整个段排序；/8约670MB，整个IPv4空间约172GB。
+// 文本输入的地址数只按范围端点计算，文件输入用后台统计的结果，尚未统计完时按超过上限处理
+bool MainWindow::confirmHistoryCost(const QStringList &cidrRanges, const ScanShard &shard)
+{
+    ScanPlan plan;
+    for (const QString &range : cidrRanges)
+    {
+        plan.add(range);
+    }
+    uint64_t fileAddresses = 0;
+    const bool known = !m_cidrFile || m_cidrFile->addressCount(fileAddresses);
+    const uint64_t addresses = shard.share(plan.scannedCount() + fileAddresses);
+    if (known && addresses <= HISTORY_CONFIRM_ADDRESSES)
+        return true;
+
+    const QString size = known ? QString("%1 个地址，历史记录约需 %2 MB 磁盘空间")
+                                     .arg(addresses)
+                                     .arg(addresses * sizeof(HistoryRecord) / (1024.0 * 1024.0), 0, 'f', 0)
+                               : QString("文件的地址数尚未统计完成，历史记录每个地址需 %1 字节磁盘空间").arg(sizeof(HistoryRecord));
+    const bool confirmed = QMessageBox::question(this, "记录历史",
+                                                 QString("本次扫描 %1。\n超过 %2 个地址的扫描默认不记录历史，是否仍然记录？")
+                                                     .arg(size)
+                                                     .arg(HISTORY_CONFIRM_ADDRESSES),
+                                                 QMessageBox::Yes | QMessageBox::No, QMessageBox::No) == QMessageBox::Yes;
+    if (!confirmed)
+    {
+        addLogMessage("本次扫描地址过多，不记录历史");
+    }
+    return confirmed;
+}
+
 void MainWindow::stopPing()
 {
+    // 测速进行中时停止测速，已完成的结果保留
+    if (m_speedTestWorker)
+    {
+        m_stopButton->setEnabled(false);
+        m_speedTestWorker->stop();
+        return;
+    }
+
+    if (m_startAfterSummary)
+    {
+        m_startAfterSummary = false;
+        enableControls(true);
+        addLogMessage("已取消等待，扫描未开始");
+        return;
+    }
+
     if (!m_isRunning)
         return;
 
@@ -315,49 +924,36 @@ void MainWindow::stopPing()
     // 立即停止UI更新定时器
     m_updateTimer->stop();
 
-    // 通知工作线程停止
+    // 取消任务，全部进行中的探测结束后发出finished
     if (m_pingWorker)
     {
-        QMetaObject::invokeMethod(m_pingWorker.get(), "stopPing", Qt::QueuedConnection);
+        m_pingWorker->stopPing();
     }
-
-    // 设置更长的超时时间，给协程足够时间清理
-    QTimer::singleShot(3000, this, [this]()
-                       {
-        if (m_isRunning) {
-            addLogMessage("强制停止测试...");
-            
-            if (m_workerThread && m_workerThread->isRunning()) {
-                // 断开信号连接防止崩溃
-                if (m_pingWorker) {
-                    m_pingWorker->disconnect();
-                }
-                
-                // 强制终止线程
-                m_workerThread->terminate();
-                m_workerThread->wait(1000);
-            }
-            
-            // 强制恢复UI状态
-            onPingFinished();
-        } });
-
-    // 立即处理挂起的事件，确保UI响应
-    QCoreApplication::processEvents();
 }
 
 void MainWindow::saveResults()
 {
     QStringList allIPs = m_resultsModel->getAllIPs();
 
-    if (allIPs.isEmpty())
+    bool hasOutcome = m_outcome && !m_outcome->tested().isEmpty();
+    if (allIPs.isEmpty() && !hasOutcome)
     {
         QMessageBox::information(this, "信息", "没有结果可保存。");
         return;
     }
 
     QString fileName = QFileDialog::getSaveFileName(this,
-                                                    "保存结果", "tcp_test_results.txt", "文本文件 (*.txt)");
+                                                    "保存结果", "tcp_test_results.txt",
+                                                    "文本文件 (*.txt);;CSV文件 (*.csv);;扫描结果位图 (*.cfmap)");
+
+    if (fileName.endsWith(".cfmap", Qt::CaseInsensitive))
+    {
+        if (hasOutcome)
+            saveOutcome(fileName);
+        else
+            QMessageBox::information(this, "信息", "没有探测结果可保存。");
+        return;
+    }
 
     if (!fileName.isEmpty())
     {
@@ -365,6 +961,24 @@ void MainWindow::saveResults()
         if (file.open(QIODevice::WriteOnly | QIODevice::Text))
         {
             QTextStream out(&file);
+            // CSV带延迟、端口与机房，按延迟升序，可用cfping-merge合并多台机器的分片结果；
+            // 同时保存用户态连接时间与内核RTT（未启用时为-1），用于比较不同并发下的测量偏差
+            if (fileName.endsWith(".csv", Qt::CaseInsensitive))
+            {
+                const QVector<PingResult> results = m_resultsModel->topResults(std::numeric_limits<int>::max());
+                out << "# CloudFlare CDN IP测试结果，按延迟升序\n";
+                out << "ip,latency_ms,port,colo,connect_ms,kernel_rtt_ms\n";
+                for (const PingResult &result : results)
+                {
+                    out << result.ip << ',' << QString::number(result.latency, 'f', 3) << ','
+                        << result.port << ',' << result.colo << ','
+                        << QString::number(result.connectMs, 'f', 3) << ','
+                        << QString::number(result.kernelRttMs, 'f', 3) << "\n";
+                }
+                addLogMessage(QString("结果已保存到: %1 (%2个IP)").arg(fileName).arg(results.size()));
+                return;
+            }
+
             out << "# CloudFlare CDN IP TCP连接测试结果\n";
             out << "# 按延迟排序的成功连接IP地址\n";
 
@@ -382,47 +996,94 @@ void MainWindow::saveResults()
     }
 }
 
-void MainWindow::onPingResult(const QString &ip, double latency, bool success)
+// 位图记录全部已探测地址（含失败），可用 cfping-outcome 导出可达/不可达/未探测的网段或与其他扫描比较
+// 文件输入的范围要读一遍整个文件，与写文件一起在后台线程完成，结果交回界面线程输出；
+// 界面线程只复制位图（扫描仍在进行时保存点击时的快照），范围每次保存时重新读取，不写回m_outcome
+void MainWindow::saveOutcome(const QString &fileName)
 {
-    // 直接添加到模型，模型会处理批量更新
-    m_resultsModel->addResult(PingResult(ip, latency, success));
-    m_completedIPs++;
+    if (m_outcomeSaving)
+    {
+        QMessageBox::information(this, "信息", "上一次保存结果位图尚未完成，请稍后再试。");
+        return;
+    }
+    stopOutcomeSave();
+
+    m_outcomeSaving = true;
+    m_outcomeSaveCancel = false;
+    addLogMessage(QString("正在保存结果位图: %1").arg(fileName));
+    m_outcomeSaveThread = std::thread([this, fileName, source = m_outcomeFile,
+                                       outcome = std::make_shared<ScanOutcome>(*m_outcome)]() {
+        if (source)
+        {
+            qint64 offset = 0;
+            std::string_view entry;
+            while (!m_outcomeSaveCancel && source->nextEntry(offset, entry))
+            {
+                outcome->addScope(CidrExpander::toCidr(QString::fromLatin1(entry.data(), static_cast<int>(entry.size()))));
+            }
+            if (m_outcomeSaveCancel)
+                return;
+        }
+
+        QString error;
+        const bool saved = outcome->save(fileName, &error);
+        const uint64_t tested = outcome->tested().cardinality();
+        const uint64_t reachable = outcome->reachable().cardinality();
+        QMetaObject::invokeMethod(this, [this, fileName, saved, error, tested, reachable]() {
+            m_outcomeSaving = false;
+            if (!saved)
+            {
+                QMessageBox::warning(this, "错误", QString("无法保存文件: %1").arg(error));
+                return;
+            }
+            addLogMessage(QString("结果位图已保存到: %1 (已探测 %2，可达 %3，只记录IPv4)")
+                              .arg(fileName)
+                              .arg(tested)
+                              .arg(reachable));
+        }, Qt::QueuedConnection);
+    });
 }
 
-void MainWindow::onPingProgress(int current, int total)
+void MainWindow::stopOutcomeSave()
 {
-    // 简化进度更新，减少UI阻塞
-    m_completedIPs = current;
-    m_totalIPs = total;
-
-    // 确保进度值不超过100%
-    if (m_completedIPs > m_totalIPs)
+    if (m_outcomeSaveThread.joinable())
     {
-        m_completedIPs = m_totalIPs;
+        m_outcomeSaveCancel = true;
+        m_outcomeSaveThread.join();
     }
+}
 
-    // 更新UI显示
-    updateResultsDisplay();
-
-    // 每1000个IP更新一次UI，减少更新频率
-    if (current % 1000 == 0)
+void MainWindow::onPingResult(const ProbeResult &result)
+{
+    // 直接添加到模型，模型会处理批量更新
+    PingResult row(result.ip, result.latencyMs, result.success, result.colo);
+    row.connectMs = result.connectMs;
+    row.kernelRttMs = result.kernelRttMs;
+    row.totalMs = result.totalMs;
+    row.tlsMs = result.tlsMs;
+    row.port = result.port;
+    row.portLatencies = result.portLatencyMs;
+    m_resultsModel->addResult(row);
+    if (m_outcome)
     {
-        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents, 10);
+        m_outcome->record(result.ip, result.success);
     }
-
-    // 如果已完成所有IP，检查是否需要停止任务
-    if (m_isRunning && m_completedIPs >= m_totalIPs)
+    if (m_historyWriter)
     {
-        // 添加计时器检查，避免过早停止
-        QTimer::singleShot(2000, this, [this]()
-                           {
-            if (m_isRunning && m_completedIPs >= m_totalIPs) {
-                // 如果仍在运行且已全部完成，则停止任务
-                stopPing();
-            } });
+        m_historyWriter->append(result.ip, result.latencyMs, result.success,
+                                static_cast<uint16_t>(result.port), result.colo);
     }
 }
 
+void MainWindow::onPingProgress(const ScanJobStats &stats)
+{
+    // 快照由引擎限频发出；任务结束后到达的周期快照可能晚于最终快照，忽略
+    if (!m_isRunning)
+        return;
+    m_scanStats = stats;
+    updateResultsDisplay();
+}
+
 void MainWindow::onPingLog(const QString &message)
 {
     addLogMessage(message);
@@ -436,36 +1097,44 @@ void MainWindow::onPingFinished()
     // 立即恢复控件状态
     enableControls(true);
     updateResultsDisplay();
+    if (m_scanStats.stoppedEarly)
+    {
+        addLogMessage(QString("已得到 %1 个合格结果，提前结束（已测试 %2 / %3）。")
+                          .arg(m_stopAfterSpinBox->value())
+                          .arg(m_scanStats.completed)
+                          .arg(std::max(m_scanStats.total, m_scanStats.dispatched)));
+    }
     addLogMessage("测试已完成。");
 
     m_statusLabel->setText("已完成");
 
-    // 异步清理线程资源，给更多时间
-    QTimer::singleShot(1000, this, [this]()
-                       {
-        if (m_workerThread) {
-            if (m_workerThread->isRunning()) {
-                m_workerThread->quit();
-                if (!m_workerThread->wait(2000)) {
-                    m_workerThread->terminate();
-                    m_workerThread->wait(1000);
-                }
-            }
-            m_workerThread->deleteLater();
-            m_workerThread = nullptr;
-        }
-        m_pingWorker.reset(); });
+    // 任务已结束，释放任务对象；引擎及其工作线程保留给下一次扫描
+    m_pingWorker.reset();
+
+    // 历史段在后台排序封存，不阻塞界面
+    if (m_historyWriter)
+    {
+        m_historyWriter->finish();
+    }
 }
 
 void MainWindow::updateResultsDisplay()
 {
-    // 更新进度信息
-    if (m_totalIPs > 0)
+    updateMetricsStatus();
+
+    // 更新进度信息：完成数按探测结束计，剩余时间按引擎的EWMA速率估计
+    const ScanJobStats &stats = m_scanStats;
+    uint64_t total = std::max(stats.total, stats.dispatched);
+    if (total > 0)
     {
         // 确保百分比不超过100%
-        int percentage = std::min(100, (m_completedIPs * 100) / m_totalIPs);
+        int percentage = static_cast<int>(std::min<uint64_t>(100, stats.completed * 100 / total));
         m_progressBar->setValue(percentage);
-        m_testCountLabel->setText(QString("IP地址: %1 / %2").arg(m_completedIPs).arg(m_totalIPs));
+        m_testCountLabel->setText(QString("IP地址: %1 / %2  进行中: %3  速率: %4 次/秒")
+                                      .arg(stats.completed)
+                                      .arg(total)
+                                      .arg(stats.inFlight)
+                                      .arg(stats.probesPerSecond, 0, 'f', 0));
 
         // 计算时间信息
         if (m_isRunning && m_startTime.isValid())
@@ -484,18 +1153,15 @@ void MainWindow::updateResultsDisplay()
                                             .arg(seconds, 2, 10, QChar('0')));
 
             // 计算剩余时间和预计完成时间
-            if (m_completedIPs > 0 && m_completedIPs < m_totalIPs)
+            if (stats.completed < total && stats.etaSeconds >= 0.0)
             {
-                // 计算平均每个IP的处理时间
-                double avgTimePerIP = static_cast<double>(elapsedMs) / m_completedIPs;
-                int remainingIPs = m_totalIPs - m_completedIPs;
-                qint64 estimatedRemainingMs = static_cast<qint64>(avgTimePerIP * remainingIPs);
+                qint64 estimatedRemainingMs = static_cast<qint64>(stats.etaSeconds * 1000.0);
 
                 // 格式化剩余时间
-                int remainingSeconds = estimatedRemainingMs / 1000;
-                int remHours = remainingSeconds / 3600;
-                int remMinutes = (remainingSeconds % 3600) / 60;
-                int remSecs = remainingSeconds % 60;
+                qint64 remainingSeconds = estimatedRemainingMs / 1000;
+                qint64 remHours = remainingSeconds / 3600;
+                int remMinutes = static_cast<int>((remainingSeconds % 3600) / 60);
+                int remSecs = static_cast<int>(remainingSeconds % 60);
                 m_remainingTimeLabel->setText(QString("剩余时间: %1:%2:%3")
                                                   .arg(remHours, 2, 10, QChar('0'))
                                                   .arg(remMinutes, 2, 10, QChar('0'))
@@ -506,7 +1172,7 @@ void MainWindow::updateResultsDisplay()
                 m_estimatedFinishLabel->setText(QString("预计完成: %1")
                                                     .arg(estimatedFinish.toString("hh:mm:ss")));
             }
-            else if (m_completedIPs >= m_totalIPs)
+            else if (stats.completed >= total)
             {
                 m_remainingTimeLabel->setText("剩余时间: 00:00:00");
                 m_estimatedFinishLabel->setText("预计完成: 已完成");
@@ -521,6 +1187,285 @@ void MainWindow::updateResultsDisplay()
     }
 }
 
+// 历史稳定性排名：按最近N次扫描统计成功率、中位延迟与抖动，可按网段汇总
+void MainWindow::showHistory()
+{
+    QDialog *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("历史稳定性");
+    dialog->resize(820, 520);
+
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    QHBoxLayout *queryLayout = new QHBoxLayout();
+    QLineEdit *cidrEdit = new QLineEdit();
+    cidrEdit->setPlaceholderText("地址范围 (CIDR，留空为全部)");
+    QSpinBox *runsSpinBox = new QSpinBox();
+    runsSpinBox->setRange(1, 1000);
+    runsSpinBox->setValue(10);
+    runsSpinBox->setPrefix("最近 ");
+    runsSpinBox->setSuffix(" 次扫描");
+    QCheckBox *subnetCheckBox = new QCheckBox("按网段汇总 (/24, /48)");
+    QPushButton *queryButton = new QPushButton("查询");
+    QPushButton *copyButton = new QPushButton("复制地址");
+    queryLayout->addWidget(cidrEdit);
+    queryLayout->addWidget(runsSpinBox);
+    queryLayout->addWidget(subnetCheckBox);
+    queryLayout->addWidget(queryButton);
+    queryLayout->addWidget(copyButton);
+    layout->addLayout(queryLayout);
+
+    QLabel *summaryLabel = new QLabel();
+    layout->addWidget(summaryLabel);
+
+    QStandardItemModel *model = new QStandardItemModel(dialog);
+    model->setHorizontalHeaderLabels({"地址", "扫描次数", "样本", "成功率", "中位延迟 (毫秒)",
+                                      "抖动 (毫秒)", "最近延迟 (毫秒)", "评分"});
+    QTableView *table = new QTableView();
+    table->setModel(model);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->horizontalHeader()->setStretchLastSection(true);
+    table->verticalHeader()->setVisible(false);
+    layout->addWidget(table);
+
+    auto runQuery = [this, dialog, cidrEdit, runsSpinBox, subnetCheckBox, queryButton, summaryLabel, model]()
+    {
+        HistoryBestQuery query;
+        query.cidr = cidrEdit->text().trimmed();
+        query.lastRuns = runsSpinBox->value();
+        query.minSamples = std::min(2, query.lastRuns);
+        if (subnetCheckBox->isChecked())
+        {
+            query.ipv4Prefix = 24;
+            query.ipv6Prefix = 48;
+        }
+
+        // 查询要归并窗口内的全部段，与扫描预估一样在后台线程完成，结果交回界面线程
+        stopHistoryQuery();
+        m_historyQueryCancel = false;
+        queryButton->setEnabled(false);
+        summaryLabel->setText("正在查询...");
+        QPointer<QDialog> target(dialog);
+        m_historyQueryThread = std::thread([this, query, target, queryButton, summaryLabel, model]() {
+            QVector<HistoryRun> runs = m_history->runs();
+            QVector<HistoryStability> best = m_history->best(query, &m_historyQueryCancel);
+            if (m_historyQueryCancel)
+                return;
+
+            QMetaObject::invokeMethod(this, [target, query, queryButton, summaryLabel, model, runs, best]() {
+                // 查询期间窗口可能已关闭，表格与标签随窗口一起删除
+                if (!target)
+                    return;
+                queryButton->setEnabled(true);
+                model->removeRows(0, model->rowCount());
+                for (const HistoryStability &stats : best)
+                {
+                    QList<QStandardItem *> row;
+                    row << new QStandardItem(stats.key)
+                        << new QStandardItem(QString::number(stats.runs))
+                        << new QStandardItem(QString::number(stats.samples))
+                        << new QStandardItem(QString("%1%").arg(stats.successRate * 100.0, 0, 'f', 0))
+                        << new QStandardItem(QString::number(stats.medianMs, 'f', 1))
+                        << new QStandardItem(QString::number(stats.jitterMs, 'f', 1))
+                        << new QStandardItem(stats.lastLatencyMs >= 0 ? QString::number(stats.lastLatencyMs, 'f', 1) : QString("失败"))
+                        << new QStandardItem(QString::number(stats.score, 'f', 1));
+                    model->appendRow(row);
+                }
+
+                int window = std::min(query.lastRuns, runs.size());
+                QString text = QString("历史库共 %1 次扫描，统计最近 %2 次").arg(runs.size()).arg(window);
+                if (window > 0)
+                {
+                    text += QString("（%1 至 %2）")
+                                .arg(QDateTime::fromMSecsSinceEpoch(runs[runs.size() - window].startedMs).toString("yyyy-MM-dd hh:mm"))
+                                .arg(QDateTime::fromMSecsSinceEpoch(runs.last().startedMs).toString("yyyy-MM-dd hh:mm"));
+                }
+                summaryLabel->setText(text);
+            }, Qt::QueuedConnection);
+        });
+    };
+    connect(queryButton, &QPushButton::clicked, dialog, runQuery);
+    connect(copyButton, &QPushButton::clicked, dialog, [model]()
+            {
+        QStringList keys;
+        for (int row = 0; row < model->rowCount(); ++row) {
+            keys.append(model->item(row, 0)->text());
+        }
+        QApplication::clipboard()->setText(keys.join('\n')); });
+
+    runQuery();
+    dialog->show();
+}
+
+// 持续监控：对选定的IP按间隔反复探测，表格每秒刷新窗口统计，告警写入日志；关闭窗口不停止监控
+void MainWindow::showMonitor()
+{
+    QDialog *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("持续监控");
+    dialog->resize(820, 560);
+
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    QGridLayout *settingsLayout = new QGridLayout();
+    QPlainTextEdit *targetsEdit = new QPlainTextEdit();
+    targetsEdit->setPlaceholderText("监控的IP，每行一个");
+    QSpinBox *intervalSpinBox = new QSpinBox();
+    intervalSpinBox->setRange(1, 3600);
+    intervalSpinBox->setValue(10);
+    intervalSpinBox->setSuffix(" 秒");
+    intervalSpinBox->setToolTip("每个IP的平均探测间隔，各IP的实际间隔随机错开");
+    QSpinBox *lossSpinBox = new QSpinBox();
+    lossSpinBox->setRange(1, 100);
+    lossSpinBox->setValue(20);
+    lossSpinBox->setSuffix(" %");
+    QSpinBox *p95SpinBox = new QSpinBox();
+    p95SpinBox->setRange(10, 10000);
+    p95SpinBox->setValue(300);
+    p95SpinBox->setSuffix(" 毫秒");
+    settingsLayout->addWidget(targetsEdit, 0, 0, 4, 1);
+    settingsLayout->addWidget(new QLabel("探测间隔:"), 0, 1);
+    settingsLayout->addWidget(intervalSpinBox, 0, 2);
+    settingsLayout->addWidget(new QLabel("丢包率告警:"), 1, 1);
+    settingsLayout->addWidget(lossSpinBox, 1, 2);
+    settingsLayout->addWidget(new QLabel("p95延迟告警:"), 2, 1);
+    settingsLayout->addWidget(p95SpinBox, 2, 2);
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *startButton = new QPushButton("开始监控");
+    QPushButton *stopButton = new QPushButton("停止监控");
+    buttonLayout->addWidget(startButton);
+    buttonLayout->addWidget(stopButton);
+    settingsLayout->addLayout(buttonLayout, 3, 1, 1, 2);
+    layout->addLayout(settingsLayout);
+
+    QLabel *summaryLabel = new QLabel();
+    layout->addWidget(summaryLabel);
+
+    QStandardItemModel *model = new QStandardItemModel(dialog);
+    model->setHorizontalHeaderLabels({"IP地址", "样本", "丢包率", "p50 (毫秒)", "p95 (毫秒)", "最近延迟 (毫秒)", "状态"});
+    QTableView *table = new QTableView();
+    table->setModel(model);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->horizontalHeader()->setStretchLastSection(true);
+    table->verticalHeader()->setVisible(false);
+    layout->addWidget(table);
+
+    // 运行中的监控显示其目标，否则预填选中的IP或延迟最低的结果
+    QStringList targets;
+    if (m_monitor && m_monitor->targetCount() > 0)
+    {
+        for (const MonitorTargetStats &stats : m_monitor->snapshot())
+        {
+            targets.append(stats.ip);
+        }
+    }
+    else
+    {
+        targets = m_resultsModel->getSelectedIPs(m_resultsTable->selectionModel()->selectedRows());
+        if (targets.isEmpty())
+        {
+            for (const PingResult &result : m_resultsModel->topResults(MONITOR_DEFAULT_TARGETS))
+            {
+                targets.append(result.ip);
+            }
+        }
+    }
+    targetsEdit->setPlainText(targets.join('\n'));
+
+    // 行数不变时只更新文字，数千个目标每秒刷新也不重建表格
+    auto refresh = [this, model, summaryLabel, startButton, stopButton]()
+    {
+        bool running = m_monitor && m_monitor->isRunning();
+        startButton->setEnabled(!running);
+        stopButton->setEnabled(running);
+        const QVector<MonitorTargetStats> snapshot = m_monitor ? m_monitor->snapshot() : QVector<MonitorTargetStats>();
+        if (model->rowCount() != snapshot.size())
+        {
+            model->removeRows(0, model->rowCount());
+            for (int row = 0; row < snapshot.size(); ++row)
+            {
+                QList<QStandardItem *> items;
+                for (int column = 0; column < 7; ++column)
+                {
+                    items << new QStandardItem();
+                }
+                model->appendRow(items);
+            }
+        }
+        int degraded = 0;
+        auto latencyText = [](double ms)
+        { return ms >= 0 ? QString::number(ms, 'f', 1) : QString("-"); };
+        for (int row = 0; row < snapshot.size(); ++row)
+        {
+            const MonitorTargetStats &stats = snapshot[row];
+            degraded += stats.degraded ? 1 : 0;
+            model->item(row, 0)->setText(stats.ip);
+            model->item(row, 1)->setText(QString::number(stats.samples));
+            model->item(row, 2)->setText(stats.samples > 0 ? QString("%1%").arg(stats.lossRate * 100.0, 0, 'f', 0) : QString("-"));
+            model->item(row, 3)->setText(latencyText(stats.p50Ms));
+            model->item(row, 4)->setText(latencyText(stats.p95Ms));
+            model->item(row, 5)->setText(stats.probes > 0 ? latencyText(stats.lastLatencyMs) : QString("-"));
+            model->item(row, 6)->setText(stats.degraded ? "告警" : stats.samples > 0 ? "正常" : "等待");
+        }
+        summaryLabel->setText(QString("%1，%2 个IP，%3 个告警")
+                                  .arg(running ? "监控中" : "未运行")
+                                  .arg(snapshot.size())
+                                  .arg(degraded));
+    };
+
+    connect(startButton, &QPushButton::clicked, dialog, [this, targetsEdit, intervalSpinBox, lossSpinBox, p95SpinBox, refresh]()
+            {
+        std::vector<uint16_t> ports = IPUtils::parsePortList(m_portsEdit->text());
+        if (ports.empty()) {
+            QMessageBox::warning(this, "警告", "端口号无效，请输入1-65535之间的端口，多个端口用逗号分隔。");
+            return;
+        }
+        MonitorSpec spec;
+        spec.targets = targetsEdit->toPlainText().split('\n');
+        spec.intervalMs = intervalSpinBox->value() * 1000;
+        spec.timeoutMs = m_timeoutSpinBox->value();
+        spec.maxConcurrentTasks = m_concurrentTasksSpinBox->value();
+        spec.ports = ports;
+        spec.probeType = currentProbeType();
+        if (!m_hostNameEdit->text().trimmed().isEmpty()) {
+            spec.hostName = m_hostNameEdit->text().trimmed();
+        }
+        spec.thresholds.maxLossRate = lossSpinBox->value() / 100.0;
+        spec.thresholds.maxP95Ms = p95SpinBox->value();
+
+        ScanEngine &engine = ensureScanEngine();
+        if (!m_monitor) {
+            m_monitor = std::make_unique<MonitorWorker>(engine);
+            connect(m_monitor.get(), &MonitorWorker::alert, this, &MainWindow::onMonitorAlert, Qt::QueuedConnection);
+            connect(m_monitor.get(), &MonitorWorker::logMessage, this, &MainWindow::onPingLog, Qt::QueuedConnection);
+        }
+        m_monitor->start(spec);
+        refresh(); });
+    connect(stopButton, &QPushButton::clicked, dialog, [this, refresh]()
+            {
+        if (m_monitor) {
+            m_monitor->stop();
+        }
+        refresh(); });
+
+    QTimer *refreshTimer = new QTimer(dialog);
+    refreshTimer->setInterval(1000);
+    connect(refreshTimer, &QTimer::timeout, dialog, refresh);
+    refreshTimer->start();
+
+    refresh();
+    dialog->show();
+}
+
+void MainWindow::onMonitorAlert(const MonitorAlert &alert)
+{
+    QString message = alert.degraded
+                          ? QString("监控告警: %1 %2").arg(alert.stats.ip, alert.reason)
+                          : QString("监控恢复: %1 %2").arg(alert.stats.ip, alert.reason);
+    addLogMessage(message);
+    statusBar()->showMessage(message, 10000);
+}
+
 void MainWindow::copySelectedIPs()
 {
     QModelIndexList selectedIndexes = m_resultsTable->selectionModel()->selectedRows();
@@ -539,16 +1484,113 @@ void MainWindow::copySelectedIPs()
     }
 }
 
+// 对延迟最低的前K个结果测速，测速期间禁用扫描控件，停止按钮用于停止测速
+void MainWindow::startSpeedTest()
+{
+    if (m_isRunning || m_speedTestWorker)
+        return;
+
+    QVector<PingResult> top = m_resultsModel->topResults(m_speedTestCountSpinBox->value());
+    if (top.isEmpty())
+    {
+        QMessageBox::information(this, "信息", "没有可测速的结果，请先完成扫描。");
+        return;
+    }
+
+    SpeedTestSpec spec;
+    spec.url = m_speedTestUrlEdit->text();
+    spec.parallelism = m_speedTestParallelSpinBox->value();
+    for (const PingResult &result : top)
+    {
+        spec.targets.append(SpeedTestTarget{result.ip, result.latency});
+    }
+
+    m_speedTestWorker = std::make_unique<SpeedTestWorker>();
+    connect(m_speedTestWorker.get(), &SpeedTestWorker::speedResult, this, &MainWindow::onSpeedTestResult, Qt::QueuedConnection);
+    connect(m_speedTestWorker.get(), &SpeedTestWorker::progress, this, [this](int completed, int total)
+            { m_statusLabel->setText(QString("正在测速... %1 / %2").arg(completed).arg(total)); }, Qt::QueuedConnection);
+    connect(m_speedTestWorker.get(), &SpeedTestWorker::logMessage, this, &MainWindow::onPingLog, Qt::QueuedConnection);
+    connect(m_speedTestWorker.get(), &SpeedTestWorker::finished, this, &MainWindow::onSpeedTestFinished, Qt::QueuedConnection);
+
+    enableControls(false);
+    m_statusLabel->setText("正在测速...");
+    m_speedTestWorker->start(spec);
+}
+
+void MainWindow::onSpeedTestResult(const SpeedTestResult &result)
+{
+    m_resultsModel->setSpeedResult(result.ip, result.success, result.mbps, result.score);
+    if (result.success)
+    {
+        addLogMessage(QString("测速 %1: %2 Mbps (%3 MB / %4 s)，综合评分 %5")
+                          .arg(result.ip)
+                          .arg(result.mbps, 0, 'f', 1)
+                          .arg(result.bytes / 1e6, 0, 'f', 1)
+                          .arg(result.seconds, 0, 'f', 1)
+                          .arg(result.score, 0, 'f', 2));
+    }
+    else
+    {
+        addLogMessage(QString("测速 %1 失败 (HTTP %2)").arg(result.ip).arg(result.httpStatus));
+    }
+}
+
+void MainWindow::onSpeedTestFinished()
+{
+    // 测速线程已发出finished，析构时join立即返回
+    m_speedTestWorker.reset();
+    enableControls(true);
+    m_statusLabel->setText("测速已完成");
+    addLogMessage("测速已完成，结果已按延迟与带宽的综合评分重新排序。");
+}
+
+// 切换探测方式：主机名只对HTTP/TLS有效，端口仍为另一方式的默认值时随之切换
+void MainWindow::onProbeTypeChanged()
+{
+    ProbeType type = currentProbeType();
+    m_hostNameEdit->setEnabled(!m_isRunning && type != ProbeType::Tcp);
+    QString ports = m_portsEdit->text().trimmed();
+    if (type == ProbeType::Tls && ports == "80") {
+        m_portsEdit->setText("443");
+    } else if (type != ProbeType::Tls && ports == "443") {
+        m_portsEdit->setText("80");
+    }
+}
+
+ProbeType MainWindow::currentProbeType() const
+{
+    return static_cast<ProbeType>(m_probeTypeComboBox->currentData().toInt());
+}
+
 void MainWindow::enableControls(bool enabled)
 {
     m_startButton->setEnabled(enabled);
+    m_estimateButton->setEnabled(enabled);
     m_stopButton->setEnabled(!enabled);
     m_openFileButton->setEnabled(enabled);
+    m_clearFileButton->setEnabled(enabled && m_cidrFile);
     m_threadCountSpinBox->setEnabled(enabled);
     m_timeoutSpinBox->setEnabled(enabled);
     m_concurrentTasksSpinBox->setEnabled(enabled);
-    m_portSpinBox->setEnabled(enabled); // 添加端口号控件的启用/禁用
+    m_portsEdit->setEnabled(enabled); // 添加端口号控件的启用/禁用
+    m_probeTypeComboBox->setEnabled(enabled);
+    m_hostNameEdit->setEnabled(enabled && currentProbeType() != ProbeType::Tcp);
     m_enableLoggingCheckBox->setEnabled(enabled);
+    m_abortiveCloseCheckBox->setEnabled(enabled);
+    m_kernelRttCheckBox->setEnabled(enabled);
+    m_shardEdit->setEnabled(enabled);
+    m_shardModeComboBox->setEnabled(enabled);
+    m_historyCheckBox->setEnabled(enabled);
+    m_priorEdit->setEnabled(enabled);
+    m_priorButton->setEnabled(enabled);
+    m_stopAfterSpinBox->setEnabled(enabled);
+    m_stopLatencySpinBox->setEnabled(enabled);
+    m_placementEdit->setEnabled(enabled);
+    m_logFileEdit->setEnabled(enabled);
+    m_speedTestButton->setEnabled(enabled);
+    m_speedTestUrlEdit->setEnabled(enabled);
+    m_speedTestCountSpinBox->setEnabled(enabled);
+    m_speedTestParallelSpinBox->setEnabled(enabled);
 
     if (enabled)
     {
@@ -565,6 +1607,79 @@ void MainWindow::enableControls(bool enabled)
     }
 }
 
+void MainWindow::updateMetricsServer()
+{
+    int port = m_metricsPortSpinBox->value();
+    if (m_metricsServer->isRunning() && m_metricsServer->port() == port)
+        return;
+
+    m_metricsServer->stop();
+    if (port <= 0)
+    {
+        addLogMessage("指标服务已关闭");
+        return;
+    }
+
+    std::string error;
+    if (m_metricsServer->start(static_cast<uint16_t>(port), &error))
+    {
+        addLogMessage(QString("指标服务已启动: http://127.0.0.1:%1/metrics").arg(port));
+    }
+    else
+    {
+        addLogMessage(QString("指标服务启动失败: %1").arg(QString::fromStdString(error)));
+    }
+}
+
+void MainWindow::updateMetricsStatus()
+{
+    MetricsSnapshot current = MetricsRegistry::instance().snapshot();
+    double seconds = std::chrono::duration<double>(current.takenAt - m_lastMetrics.takenAt).count();
+    if (seconds <= 0.0)
+        return;
+
+    // 与上次快照的差值得到速率、线程利用率和平均调度延迟
+    double attemptsPerSecond = (current.counter(Metric::ConnectAttempts) - m_lastMetrics.counter(Metric::ConnectAttempts)) / seconds;
+
+    // 按全部工作线程（含已退出的）的合计求差，重建引擎前后线程不同也不会出现负值
+    auto totalCpu = [](const MetricsSnapshot &snapshot) {
+        double total = snapshot.retiredWorkerCpuSeconds;
+        for (double seconds : snapshot.workerCpuSeconds)
+            total += seconds;
+        return total;
+    };
+    double cpuSeconds = std::max(0.0, totalCpu(current) - totalCpu(m_lastMetrics));
+    int workers = m_scanEngine ? m_scanEngine->threadCount() : 1;
+    double utilization = std::min(100.0, cpuSeconds / (seconds * workers) * 100.0);
+
+    uint64_t handlerCount = current.handlerLatencyCount - m_lastMetrics.handlerLatencyCount;
+    double handlerMs = handlerCount > 0
+                           ? (current.handlerLatencySumSeconds - m_lastMetrics.handlerLatencySumSeconds) * 1000.0 / handlerCount
+                           : 0.0;
+
+    QString status = QString("连接/秒: %1 | 进行中: %2 | 超时: %3 | 拒绝: %4 | 队列: %5 | 线程利用率: %6% | 调度延迟: %7ms")
+                         .arg(attemptsPerSecond, 0, 'f', 0)
+                         .arg(current.inFlight)
+                         .arg(current.counter(Metric::Timeouts))
+                         .arg(current.counter(Metric::Refused))
+                         .arg(current.queueDepth)
+                         .arg(utilization, 0, 'f', 0)
+                         .arg(handlerMs, 0, 'f', 2);
+
+    // 文件描述符与TIME_WAIT余量，平台不支持的项不显示
+    SocketHeadroom headroom = SocketFactory::headroom();
+    if (headroom.openFds >= 0 && headroom.fdLimit >= 0)
+    {
+        status += QString(" | 描述符: %1/%2").arg(headroom.openFds).arg(headroom.fdLimit);
+    }
+    if (headroom.timeWait >= 0 && headroom.ephemeralPorts >= 0)
+    {
+        status += QString(" | TIME_WAIT: %1/%2").arg(headroom.timeWait).arg(headroom.ephemeralPorts);
+    }
+    m_metricsStatusLabel->setText(status);
+    m_lastMetrics = std::move(current);
+}
+
 void MainWindow::addLogMessage(const QString &message)
 {
     if (m_logModel)
@@ -1,6 +1,9 @@
 ﻿#ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+// scanengine.h/speedtest.h带入boost，必须先于Qt包含（Qt的emit宏与cancellation_signal::emit冲突）
+#include "scanengine.h"
+#include "speedtest.h"
 #include <QtWidgets/QMainWindow>
 #include <QtWidgets/QVBoxLayout>
 #include <QtWidgets/QHBoxLayout>
@@ -17,17 +20,30 @@
 #include <QtWidgets/QHeaderView>
 #include <QtWidgets/QSpinBox>
 #include <QtWidgets/QCheckBox>
+#include <QtWidgets/QLineEdit>
+#include <QtWidgets/QComboBox>
+#include <QtWidgets/QStatusBar>
 #include <QtWidgets/QApplication>
 #include <QClipboard>
-#include <QThread>
 #include <QTimer>
 #include <QDateTime>
 #include <QCoreApplication>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include "metrics.h"
 
 class PingWorker;
 class PingResultModel;
 class LogModel;
+class MetricsServer;
+class CidrFileSource;
+struct CidrFileSummary;
+class HistoryStore;
+class ScanOutcome;
+class HistoryRunWriter;
+class MonitorWorker;
+struct MonitorAlert;
 struct PingResult;
 
 class MainWindow : public QMainWindow
@@ -38,23 +54,59 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 预填分片设置（命令行 --shard/--shard-mode）
+    void setShard(const ScanShard& shard);
+    // 预填CPU绑定（命令行 --cpus）
+    void setPlacement(const QString& placement);
+
 private slots:
     void openFile();
     void startPing();
+    // 预演：按当前输入与设置列出扫描计划并估计耗时，不发起任何连接
+    void estimateScan();
     void stopPing();
     void saveResults();
-    void onPingResult(const QString& ip, double latency, bool success);
-    void onPingProgress(int current, int total);
+    void onPingResult(const ProbeResult& result);
+    void onPingProgress(const ScanJobStats& stats);
     void onPingLog(const QString& message);
     void onPingFinished();
     void updateResultsDisplay();
     void copySelectedIPs();
+    void onProbeTypeChanged();
+    void startSpeedTest();
+    void onSpeedTestResult(const SpeedTestResult& result);
+    void onSpeedTestFinished();
+    void showHistory();
+    void showMonitor();
+    void onMonitorAlert(const MonitorAlert& alert);
 
 private:
     void setupUI();
     void setupConnections();
     void enableControls(bool enabled);
+    ProbeType currentProbeType() const;
+    // 读取输入框中的范围（文件输入时为空）、端口与分片设置，无效时提示并返回false
+    bool collectScanInput(QStringList& cidrRanges, std::vector<uint16_t>& ports, ScanShard& shard);
+    // 保存本次扫描的结果位图（.cfmap），文件输入的范围在此时补全
+    void saveOutcome(const QString& fileName);
+    // 常驻引擎，只有线程数或CPU绑定改变且没有扫描或监控在运行时才重建
+    ScanEngine& ensureScanEngine();
     void addLogMessage(const QString& message);
+    void updateMetricsServer();
+    void updateMetricsStatus();
+    // 大文件作为映射的文件输入，输入框只显示摘要
+    void loadCidrFile(const QString& fileName);
+    void clearCidrFile();
+    void stopFileSummary();
+    // 取消并等待进行中的扫描预估
+    void stopEstimate();
+    // 取消并等待进行中的历史排名查询
+    void stopHistoryQuery();
+    // 取消并等待进行中的结果位图保存
+    void stopOutcomeSave();
+    // 大扫描记录历史前询问：历史每个地址一条记录，超过上限时默认不记录
+    bool confirmHistoryCost(const QStringList& cidrRanges, const ScanShard& shard);
+    void showFileSummary(const CidrFileSummary& summary);
     
     // UI组件
     QWidget* m_centralWidget;
@@ -64,16 +116,38 @@ private:
     // 左侧面板 - CIDR输入
     QTextEdit* m_cidrTextEdit;
     QPushButton* m_openFileButton;
+    QPushButton* m_clearFileButton;  // 放弃文件输入，恢复手动输入
     QPushButton* m_startButton;
+    QPushButton* m_estimateButton;
     QPushButton* m_stopButton;
     QPushButton* m_saveButton;
+    QPushButton* m_speedTestButton;  // 对前K个结果测速
+    QPushButton* m_historyButton;  // 查看历史稳定性排名
+    QPushButton* m_monitorButton;  // 持续监控选定的IP
     
     // 设置区域
     QSpinBox* m_threadCountSpinBox;
     QSpinBox* m_timeoutSpinBox;
     QSpinBox* m_concurrentTasksSpinBox;  //最大并发任务控制
-    QSpinBox* m_portSpinBox;  // 端口号配置
+    QLineEdit* m_portsEdit;  // 端口列表，逗号分隔
+    QComboBox* m_probeTypeComboBox;  // 探测方式（TCP连接/HTTP trace）
+    QLineEdit* m_hostNameEdit;  // HTTP探测的Host头与TLS探测的SNI
     QCheckBox* m_enableLoggingCheckBox;
+    QCheckBox* m_abortiveCloseCheckBox;  // 成功后以RST关闭连接
+    QCheckBox* m_kernelRttCheckBox;  // 以内核RTT排序
+    QLineEdit* m_shardEdit;  // 分片“i/N”，留空不分片
+    QComboBox* m_shardModeComboBox;  // 分片方式（交错/连续块）
+    QCheckBox* m_historyCheckBox;  // 把本次扫描结果写入历史库
+    QLineEdit* m_priorEdit;  // 热启动先验文件（以前的结果或网段评分），留空按输入顺序
+    QPushButton* m_priorButton;
+    QSpinBox* m_stopAfterSpinBox;  // 提前停止：合格结果数，0为不启用
+    QSpinBox* m_stopLatencySpinBox;  // 合格结果的延迟上限，0为不限
+    QLineEdit* m_placementEdit;  // 工作线程的CPU绑定（auto、node:N或CPU列表），留空不绑定
+    QLineEdit* m_logFileEdit;  // 日志文件路径（可选）
+    QSpinBox* m_metricsPortSpinBox;  // 指标HTTP端口（0为关闭）
+    QLineEdit* m_speedTestUrlEdit;   // 测速下载地址或字节数
+    QSpinBox* m_speedTestCountSpinBox;     // 测速IP数（前K个）
+    QSpinBox* m_speedTestParallelSpinBox;  // 同时测速的IP数
     
     // 右侧面板 - 结果和日志
     QTableView* m_resultsTable;
@@ -89,16 +163,45 @@ private:
     QLabel* m_elapsedTimeLabel;      // 已耗时显示
     QLabel* m_remainingTimeLabel;    // 剩余时间显示
     QLabel* m_estimatedFinishLabel;  // 预计完成时间显示
+    QLabel* m_metricsStatusLabel;    // 状态栏引擎指标
     
-    // 工作线程与数据
-    std::unique_ptr<PingWorker> m_pingWorker;
-    QThread* m_workerThread;
+    // 扫描引擎与数据
+    std::unique_ptr<ScanEngine> m_scanEngine;  // 常驻引擎，线程与io_context在多次扫描间复用
+    std::unique_ptr<PingWorker> m_pingWorker;  // 当前扫描任务
+    std::unique_ptr<SpeedTestWorker> m_speedTestWorker;  // 当前测速任务
+    std::unique_ptr<MonitorWorker> m_monitor;  // 持续监控，与扫描共用引擎，可与扫描同时运行
     QTimer* m_updateTimer;
+    std::unique_ptr<MetricsServer> m_metricsServer;  // 本地Prometheus指标服务
+    MetricsSnapshot m_lastMetrics;                   // 上次状态栏刷新时的指标
     
     bool m_isRunning;
-    int m_totalIPs;
-    int m_completedIPs;
+    ScanJobStats m_scanStats;  // 引擎最近一次发布的进度快照
     QDateTime m_startTime;  // 开始时间记录
+
+    // 文件输入：统计线程只读映射并在完成后把摘要投递回界面线程
+    std::shared_ptr<CidrFileSource> m_cidrFile;
+    std::thread m_fileSummaryThread;
+    std::atomic<bool> m_fileSummaryCancel{false};
+    bool m_startAfterSummary = false; // 连续块分片在等待文件统计完成，完成后自动开始扫描
+    std::thread m_estimateThread;     // 扫描预估，文件输入时要读一遍整个文件
+    std::atomic<bool> m_estimateCancel{false};
+    std::thread m_historyQueryThread; // 历史排名查询，要归并最近N次扫描的全部段
+    std::atomic<bool> m_historyQueryCancel{false};
+
+    // 历史结果库：写入器在扫描结束后继续在后台封存，直到下一次扫描开始或程序退出
+    std::unique_ptr<HistoryStore> m_history;
+    std::unique_ptr<HistoryRunWriter> m_historyWriter;
+
+    // 本次扫描每个地址的结果（含失败）的压缩位图；文件输入的范围在保存时才从m_outcomeFile读取
+    std::unique_ptr<ScanOutcome> m_outcome;
+    std::shared_ptr<CidrFileSource> m_outcomeFile;
+    std::thread m_outcomeSaveThread;  // 保存位图：读取文件输入的范围并写文件，保存的是点击时的快照
+    std::atomic<bool> m_outcomeSaveCancel{false};
+    bool m_outcomeSaving = false;     // 后台保存尚未把结果交回界面线程
+
+    static constexpr int MONITOR_DEFAULT_TARGETS = 20;      // 未选中IP时预填的监控目标数
+    static constexpr qint64 INLINE_FILE_BYTES = 256 * 1024; // 不超过此大小的文件仍载入输入框
+    static constexpr uint64_t HISTORY_CONFIRM_ADDRESSES = 1 << 22; // 超过此地址数（历史约160MB）的扫描记录历史前询问
 };
 
 #endif // MAINWINDOW_H
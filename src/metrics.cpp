@@ -0,0 +1,369 @@
+#include "metrics.h"
+#include "socketfactory.h"
+#include <boost/system/error_code.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+
+// 当前线程的CPU时间（纳秒）
+uint64_t threadCpuTimeNs()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+    auto toNs = [](const FILETIME& t) {
+        return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 100;
+    };
+    return toNs(kernel) + toNs(user);
+#else
+    timespec ts{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+// Prometheus标签值转义
+std::string escapeLabel(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            result += '\\';
+            result += c;
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+// 获取全局指标注册表
+MetricsRegistry& MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::ShardLease::ShardLease()
+    : shard(instance().registerShard())
+{
+}
+
+MetricsRegistry::ShardLease::~ShardLease()
+{
+    instance().retireShard(shard);
+}
+
+// 当前线程的分片，首次使用时注册
+MetricsRegistry::Shard& MetricsRegistry::local()
+{
+    thread_local ShardLease lease;
+    return *lease.shard;
+}
+
+MetricsRegistry::Shard* MetricsRegistry::registerShard()
+{
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    m_shards.push_back(std::make_unique<Shard>());
+    return m_shards.back().get();
+}
+
+// 线程已退出，分片不再有写者；m_retired只在锁内访问，同样视为单写者
+void MetricsRegistry::retireShard(Shard* shard)
+{
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    for (int i = 0; i < static_cast<int>(Metric::Count); ++i) {
+        bump(m_retired.counters[i], shard->counters[i].load(std::memory_order_relaxed));
+    }
+    m_retired.inFlight.store(m_retired.inFlight.load(std::memory_order_relaxed) +
+                             shard->inFlight.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    for (int i = 0; i < ERROR_SLOTS; ++i) {
+        int32_t key = shard->errorCodes[i].load(std::memory_order_acquire);
+        if (key == 0) break;
+        addError(m_retired, key, shard->errorCounts[i].load(std::memory_order_relaxed));
+    }
+    for (std::size_t i = 0; i < m_retired.otherErrors.size(); ++i) {
+        bump(m_retired.otherErrors[i], shard->otherErrors[i].load(std::memory_order_relaxed));
+    }
+    for (std::size_t i = 0; i < m_retired.latencyBuckets.size(); ++i) {
+        bump(m_retired.latencyBuckets[i], shard->latencyBuckets[i].load(std::memory_order_relaxed));
+        bump(m_retired.biasBuckets[i], shard->biasBuckets[i].load(std::memory_order_relaxed));
+    }
+    bump(m_retired.latencySumNs, shard->latencySumNs.load(std::memory_order_relaxed));
+    bump(m_retired.biasSumNs, shard->biasSumNs.load(std::memory_order_relaxed));
+    if (shard->worker.load(std::memory_order_relaxed)) {
+        m_retiredCpuNs += shard->cpuNs.load(std::memory_order_relaxed);
+    }
+    m_shards.erase(std::find_if(m_shards.begin(), m_shards.end(),
+                                [shard](const std::unique_ptr<Shard>& entry) { return entry.get() == shard; }));
+}
+
+void MetricsRegistry::increment(Metric metric, uint64_t n)
+{
+    bump(local().counters[static_cast<int>(metric)], n);
+}
+
+void MetricsRegistry::addInFlight(int64_t delta)
+{
+    auto& value = local().inFlight;
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::recordError(int code, ErrorStage stage)
+{
+    if (code == 0) return;
+    addError(local(), errorKey(stage, code), 1);
+}
+
+// 按阶段与错误码计数，分片内线性探测
+void MetricsRegistry::addError(Shard& shard, int32_t key, uint64_t n)
+{
+    for (int i = 0; i < ERROR_SLOTS; ++i) {
+        int32_t slotKey = shard.errorCodes[i].load(std::memory_order_relaxed);
+        if (slotKey == key) {
+            bump(shard.errorCounts[i], n);
+            return;
+        }
+        if (slotKey == 0) {
+            // 先写计数再发布错误码，抓取线程看到错误码时计数已有效
+            bump(shard.errorCounts[i], n);
+            shard.errorCodes[i].store(key, std::memory_order_release);
+            return;
+        }
+    }
+    bump(shard.otherErrors[key >> 24], n);
+}
+
+void MetricsRegistry::recordDuration(std::array<std::atomic<uint64_t>, LATENCY_BUCKETS_US.size() + 1>& buckets,
+                                     std::atomic<uint64_t>& sumNs, std::chrono::steady_clock::duration duration)
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    if (ns < 0) ns = 0;
+    uint64_t us = static_cast<uint64_t>(ns) / 1000;
+
+    std::size_t bucket = 0;
+    while (bucket < LATENCY_BUCKETS_US.size() && us > LATENCY_BUCKETS_US[bucket]) {
+        ++bucket;
+    }
+    bump(buckets[bucket], 1);
+    bump(sumNs, static_cast<uint64_t>(ns));
+}
+
+void MetricsRegistry::recordHandlerLatency(std::chrono::steady_clock::duration latency)
+{
+    Shard& shard = local();
+    recordDuration(shard.latencyBuckets, shard.latencySumNs, latency);
+}
+
+void MetricsRegistry::recordConnectBias(std::chrono::steady_clock::duration bias)
+{
+    Shard& shard = local();
+    recordDuration(shard.biasBuckets, shard.biasSumNs, bias);
+}
+
+void MetricsRegistry::updateWorkerCpuTime()
+{
+    Shard& shard = local();
+    shard.worker.store(true, std::memory_order_relaxed);
+    shard.cpuNs.store(threadCpuTimeNs(), std::memory_order_relaxed);
+}
+
+// 汇总所有分片与已退出线程的合计
+MetricsSnapshot MetricsRegistry::snapshot() const
+{
+    MetricsSnapshot result;
+    result.takenAt = std::chrono::steady_clock::now();
+    result.queueDepth = m_queueDepth.load(std::memory_order_relaxed);
+    result.handlerLatencyBuckets.assign(LATENCY_BUCKETS_US.size() + 1, 0);
+    result.connectBiasBuckets.assign(LATENCY_BUCKETS_US.size() + 1, 0);
+
+    std::array<uint64_t, static_cast<int>(ErrorStage::Count)> otherErrors{};
+    uint64_t latencySumNs = 0;
+    uint64_t biasSumNs = 0;
+
+    auto accumulate = [&](const Shard& shard) {
+        for (int i = 0; i < static_cast<int>(Metric::Count); ++i) {
+            result.counters[i] += shard.counters[i].load(std::memory_order_relaxed);
+        }
+        result.inFlight += shard.inFlight.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < ERROR_SLOTS; ++i) {
+            int32_t key = shard.errorCodes[i].load(std::memory_order_acquire);
+            if (key == 0) break;
+            const auto stage = static_cast<ErrorStage>(key >> 24);
+            const int code = key & 0xFFFFFF;
+            uint64_t count = shard.errorCounts[i].load(std::memory_order_relaxed);
+            auto it = std::find_if(result.errors.begin(), result.errors.end(), [stage, code](const MetricsError& entry) {
+                return entry.stage == stage && entry.code == code;
+            });
+            if (it != result.errors.end()) {
+                it->count += count;
+            } else {
+                result.errors.push_back(MetricsError{stage, code, count});
+            }
+        }
+        for (std::size_t i = 0; i < otherErrors.size(); ++i) {
+            otherErrors[i] += shard.otherErrors[i].load(std::memory_order_relaxed);
+        }
+
+        for (std::size_t i = 0; i < result.handlerLatencyBuckets.size(); ++i) {
+            uint64_t count = shard.latencyBuckets[i].load(std::memory_order_relaxed);
+            result.handlerLatencyBuckets[i] += count;
+            result.handlerLatencyCount += count;
+        }
+        latencySumNs += shard.latencySumNs.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < result.connectBiasBuckets.size(); ++i) {
+            uint64_t count = shard.biasBuckets[i].load(std::memory_order_relaxed);
+            result.connectBiasBuckets[i] += count;
+            result.connectBiasCount += count;
+        }
+        biasSumNs += shard.biasSumNs.load(std::memory_order_relaxed);
+
+        if (shard.worker.load(std::memory_order_relaxed)) {
+            result.workerCpuSeconds.push_back(shard.cpuNs.load(std::memory_order_relaxed) / 1e9);
+        }
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(m_shardsMutex);
+        for (const auto& shard : m_shards) {
+            accumulate(*shard);
+        }
+        accumulate(m_retired);
+        result.retiredWorkerCpuSeconds = m_retiredCpuNs / 1e9;
+    }
+
+    for (std::size_t i = 0; i < otherErrors.size(); ++i) {
+        if (otherErrors[i] > 0) {
+            result.errors.push_back(MetricsError{static_cast<ErrorStage>(i), -1, otherErrors[i]});
+        }
+    }
+    std::sort(result.errors.begin(), result.errors.end(), [](const MetricsError& a, const MetricsError& b) {
+        return a.stage != b.stage ? a.stage < b.stage : a.code < b.code;
+    });
+    result.handlerLatencySumSeconds = latencySumNs / 1e9;
+    result.connectBiasSumSeconds = biasSumNs / 1e9;
+    return result;
+}
+
+// Prometheus文本格式（version 0.0.4）
+std::string MetricsRegistry::prometheusText() const
+{
+    MetricsSnapshot snap = snapshot();
+    std::string out;
+    out.reserve(4096);
+    char line[512];
+
+    auto counter = [&](const char* name, const char* help, Metric metric) {
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                      name, help, name, name,
+                      static_cast<unsigned long long>(snap.counter(metric)));
+        out += line;
+    };
+    counter("cfping_connect_attempts_total", "TCP connect attempts started.", Metric::ConnectAttempts);
+    counter("cfping_probes_completed_total", "Probes that finished with any outcome.", Metric::Completed);
+    counter("cfping_connect_success_total", "Successful TCP handshakes.", Metric::Connected);
+    counter("cfping_connect_timeouts_total", "Probes that hit the connect timeout.", Metric::Timeouts);
+    counter("cfping_connect_refused_total", "Probes answered with a reset (port closed).", Metric::Refused);
+    counter("cfping_connect_failures_total", "Probes that failed with another error.", Metric::Failed);
+    counter("cfping_http_success_total", "HTTP trace probes answered with 2xx/3xx.", Metric::HttpOk);
+    counter("cfping_http_failures_total", "HTTP trace probes that timed out, failed or got another status.", Metric::HttpFailed);
+    counter("cfping_tls_handshakes_total", "TLS probes that completed a TLS 1.3 handshake.", Metric::TlsOk);
+    counter("cfping_tls_failures_total", "TLS probes whose handshake timed out or failed.", Metric::TlsFailed);
+    counter("cfping_chunks_stolen_total", "Address chunks a worker took from another worker's queue.", Metric::ChunksStolen);
+
+    std::snprintf(line, sizeof(line), "# HELP cfping_in_flight Probes currently in flight.\n"
+                                      "# TYPE cfping_in_flight gauge\ncfping_in_flight %lld\n",
+                  static_cast<long long>(snap.inFlight));
+    out += line;
+    std::snprintf(line, sizeof(line), "# HELP cfping_queue_depth Addresses waiting to be dispatched.\n"
+                                      "# TYPE cfping_queue_depth gauge\ncfping_queue_depth %llu\n",
+                  static_cast<unsigned long long>(snap.queueDepth));
+    out += line;
+
+    // 套接字资源余量，读取失败的项不输出
+    SocketHeadroom headroom = SocketFactory::headroom();
+    auto gauge = [&](const char* name, const char* help, int64_t value) {
+        if (value < 0) return;
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+                      name, help, name, name, static_cast<long long>(value));
+        out += line;
+    };
+    gauge("cfping_open_fds", "File descriptors open in this process.", headroom.openFds);
+    gauge("cfping_fd_limit", "Soft RLIMIT_NOFILE of this process.", headroom.fdLimit);
+    gauge("cfping_ephemeral_ports", "Size of the local ephemeral port range.", headroom.ephemeralPorts);
+    gauge("cfping_tcp_time_wait", "TCP connections in TIME_WAIT on this host.", headroom.timeWait);
+
+    // 每个阶段一个指标族，错误码都是系统错误码
+    struct ErrorFamily {
+        ErrorStage stage;
+        const char* name;
+        const char* help;
+    };
+    const ErrorFamily errorFamilies[] = {
+        {ErrorStage::Connect, "cfping_connect_errors_total", "Failed TCP connects by system error code."},
+        {ErrorStage::Http, "cfping_http_errors_total", "HTTP trace exchanges that failed after connecting, by system error code."},
+        {ErrorStage::Tls, "cfping_tls_errors_total", "TLS handshakes that failed with a socket error, by system error code."},
+    };
+    for (const ErrorFamily& family : errorFamilies) {
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n", family.name, family.help, family.name);
+        out += line;
+        for (const MetricsError& error : snap.errors) {
+            if (error.stage != family.stage) continue;
+            std::string name = error.code < 0 ? std::string("other")
+                                              : boost::system::system_category().message(error.code);
+            std::snprintf(line, sizeof(line), "%s{errno=\"%d\",message=\"%s\"} %llu\n", family.name,
+                          error.code, escapeLabel(name).c_str(), static_cast<unsigned long long>(error.count));
+            out += line;
+        }
+    }
+
+    out += "# HELP cfping_worker_cpu_seconds_total CPU time consumed by each running worker thread; "
+           "worker=\"retired\" sums workers that have exited.\n"
+           "# TYPE cfping_worker_cpu_seconds_total counter\n";
+    for (std::size_t i = 0; i < snap.workerCpuSeconds.size(); ++i) {
+        std::snprintf(line, sizeof(line), "cfping_worker_cpu_seconds_total{worker=\"%zu\"} %.6f\n",
+                      i, snap.workerCpuSeconds[i]);
+        out += line;
+    }
+    if (snap.retiredWorkerCpuSeconds > 0.0) {
+        std::snprintf(line, sizeof(line), "cfping_worker_cpu_seconds_total{worker=\"retired\"} %.6f\n",
+                      snap.retiredWorkerCpuSeconds);
+        out += line;
+    }
+
+    auto histogram = [&](const char* name, const char* help, const std::vector<uint64_t>& buckets,
+                         uint64_t count, double sumSeconds) {
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+        out += line;
+        uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < LATENCY_BUCKETS_US.size(); ++i) {
+            cumulative += buckets[i];
+            std::snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n",
+                          name, LATENCY_BUCKETS_US[i] / 1e6, static_cast<unsigned long long>(cumulative));
+            out += line;
+        }
+        std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.6f\n%s_count %llu\n",
+                      name, static_cast<unsigned long long>(count), name, sumSeconds,
+                      name, static_cast<unsigned long long>(count));
+        out += line;
+    };
+    histogram("cfping_handler_latency_seconds", "Delay between dispatching a probe and its coroutine starting.",
+              snap.handlerLatencyBuckets, snap.handlerLatencyCount, snap.handlerLatencySumSeconds);
+    histogram("cfping_connect_bias_seconds", "User-space connect time minus the kernel TCP_INFO RTT of the same handshake.",
+              snap.connectBiasBuckets, snap.connectBiasCount, snap.connectBiasSumSeconds);
+    return out;
+}
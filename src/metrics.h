@@ -0,0 +1,144 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 引擎计数器
+enum class Metric : int {
+    ConnectAttempts = 0, // 发起的连接数
+    Completed,           // 完成的探测数
+    Connected,           // 连接成功
+    Timeouts,            // 连接超时
+    Refused,             // 连接被拒绝
+    Failed,              // 其他失败
+    HttpOk,              // HTTP探测收到2xx/3xx响应
+    HttpFailed,          // HTTP探测超时、出错或状态码异常
+    TlsOk,               // TLS握手完成
+    TlsFailed,           // TLS握手超时或失败
+    ChunksStolen,        // 工作线程从其他线程的队列窃取的地址段
+    Count
+};
+
+// 错误码的来源阶段，每个阶段导出为单独的指标族
+enum class ErrorStage : int {
+    Connect = 0, // TCP连接
+    Http,        // 连接后的HTTP trace请求
+    Tls,         // 连接后的TLS握手
+    Count
+};
+
+// 一个阶段的一个系统错误码的次数，code为-1表示分片槽位用尽后合并的其他错误
+struct MetricsError {
+    ErrorStage stage = ErrorStage::Connect;
+    int code = 0;
+    uint64_t count = 0;
+};
+
+// 指标快照，抓取时由各线程分片求和得到
+struct MetricsSnapshot {
+    std::array<uint64_t, static_cast<int>(Metric::Count)> counters{};
+    int64_t inFlight = 0;                                  // 进行中的探测数
+    uint64_t queueDepth = 0;                               // 待调度地址数
+    std::vector<MetricsError> errors;                      // 按阶段与错误码统计
+    std::vector<uint64_t> handlerLatencyBuckets;           // 调度延迟直方图（非累积）
+    uint64_t handlerLatencyCount = 0;
+    double handlerLatencySumSeconds = 0.0;
+    std::vector<uint64_t> connectBiasBuckets;              // 用户态连接耗时减内核RTT的直方图（非累积）
+    uint64_t connectBiasCount = 0;
+    double connectBiasSumSeconds = 0.0;
+    std::vector<double> workerCpuSeconds;                  // 每个运行中的工作线程的CPU时间
+    double retiredWorkerCpuSeconds = 0.0;                  // 已退出的工作线程（如重建引擎前）的CPU时间之和
+    std::chrono::steady_clock::time_point takenAt;
+
+    uint64_t counter(Metric metric) const { return counters[static_cast<int>(metric)]; }
+};
+
+// 指标注册表：每个线程写自己的缓存行对齐分片（单写者，无原子读改写），
+// 抓取时对所有分片求和，避免热路径上的跨核缓存行争用。线程退出时分片并入已退出线程的合计后注销，
+// 计数器保持单调，重建引擎或临时线程不会留下失效的分片
+class MetricsRegistry
+{
+public:
+    // 调度延迟直方图上界（微秒），最后一个桶为+Inf
+    static constexpr std::array<uint64_t, 9> LATENCY_BUCKETS_US = {
+        10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000
+    };
+
+    static MetricsRegistry& instance();
+
+    // 热路径接口，只写当前线程的分片
+    static void increment(Metric metric, uint64_t n = 1);
+    static void addInFlight(int64_t delta);
+    static void recordError(int code, ErrorStage stage = ErrorStage::Connect);
+    static void recordHandlerLatency(std::chrono::steady_clock::duration latency);
+    // 用户态测得的连接耗时比内核RTT多出的部分（调度与事件循环排队），随并发增长
+    static void recordConnectBias(std::chrono::steady_clock::duration bias);
+    // 工作线程定期调用，记录自身CPU时间用于计算利用率
+    static void updateWorkerCpuTime();
+
+    // 待调度队列深度（由调度线程设置）
+    void setQueueDepth(uint64_t depth) { m_queueDepth.store(depth, std::memory_order_relaxed); }
+
+    // 汇总当前所有分片
+    MetricsSnapshot snapshot() const;
+    // 以Prometheus文本格式导出
+    std::string prometheusText() const;
+
+private:
+    static constexpr int ERROR_SLOTS = 32; // 每个分片记录的不同错误码数量
+
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, static_cast<int>(Metric::Count)> counters{};
+        std::atomic<int64_t> inFlight{0};
+        std::array<std::atomic<int32_t>, ERROR_SLOTS> errorCodes{};   // errorKey(阶段, 错误码)
+        std::array<std::atomic<uint64_t>, ERROR_SLOTS> errorCounts{};
+        std::array<std::atomic<uint64_t>, static_cast<int>(ErrorStage::Count)> otherErrors{};
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKETS_US.size() + 1> latencyBuckets{};
+        std::atomic<uint64_t> latencySumNs{0};
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKETS_US.size() + 1> biasBuckets{};
+        std::atomic<uint64_t> biasSumNs{0};
+        std::atomic<uint64_t> cpuNs{0};
+        std::atomic<bool> worker{false};
+    };
+
+    // 线程的分片：首次使用时注册，线程退出时注销
+    struct ShardLease {
+        Shard* shard;
+        ShardLease();
+        ~ShardLease();
+    };
+
+    MetricsRegistry() = default;
+    static Shard& local();
+    // 阶段放在高8位，系统错误码不会超过24位
+    static int32_t errorKey(ErrorStage stage, int code) { return (static_cast<int32_t>(stage) << 24) | code; }
+    // 计入分片的错误槽位，槽位用尽后计入该阶段的other；只能由分片的写者调用
+    static void addError(Shard& shard, int32_t key, uint64_t n);
+    // 按LATENCY_BUCKETS_US计入一个时长样本
+    static void recordDuration(std::array<std::atomic<uint64_t>, LATENCY_BUCKETS_US.size() + 1>& buckets,
+                               std::atomic<uint64_t>& sumNs, std::chrono::steady_clock::duration duration);
+    Shard* registerShard();
+    // 把分片的计数并入m_retired后删除，工作线程的CPU时间计入m_retiredCpuNs
+    void retireShard(Shard* shard);
+
+    // 单写者自增：普通读写代替lock前缀指令
+    static void bump(std::atomic<uint64_t>& value, uint64_t n)
+    {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    mutable std::mutex m_shardsMutex; // 仅保护分片注册与抓取
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    Shard m_retired;                  // 已退出线程的合计，只在m_shardsMutex内读写
+    uint64_t m_retiredCpuNs = 0;
+    std::atomic<uint64_t> m_queueDepth{0};
+};
+
+#endif // METRICS_H
@@ -0,0 +1,122 @@
+#include "metricsserver.h"
+#include "metrics.h"
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <chrono>
+
+MetricsServer::MetricsServer()
+    : m_running(false)
+    , m_port(0)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+// 启动监听线程
+bool MetricsServer::start(uint16_t port, std::string* error)
+{
+    if (m_running.load()) return true;
+
+    try {
+        m_ioContext = std::make_unique<boost::asio::io_context>(1);
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+        m_acceptor = std::make_unique<boost::asio::ip::tcp::acceptor>(*m_ioContext, endpoint);
+    } catch (const boost::system::system_error& e) {
+        if (error) {
+            *error = e.what();
+        }
+        m_acceptor.reset();
+        m_ioContext.reset();
+        return false;
+    }
+
+    m_port = port;
+    m_running = true;
+    boost::asio::co_spawn(*m_ioContext, acceptLoop(*m_acceptor), boost::asio::detached);
+    m_thread = std::thread([this]() {
+        try {
+            m_ioContext->run();
+        } catch (...) {
+            // 指标服务异常不影响测试本身
+        }
+    });
+    return true;
+}
+
+// 停止服务
+void MetricsServer::stop()
+{
+    if (!m_running.exchange(false)) return;
+
+    m_ioContext->stop();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_acceptor.reset();
+    m_ioContext.reset();
+}
+
+// 接受连接循环
+boost::asio::awaitable<void> MetricsServer::acceptLoop(boost::asio::ip::tcp::acceptor& acceptor)
+{
+    auto executor = co_await boost::asio::this_coro::executor;
+    while (m_running.load()) {
+        auto [ec, socket] = co_await acceptor.async_accept(boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (ec) {
+            if (ec == boost::asio::error::operation_aborted) break;
+            continue;
+        }
+        boost::asio::co_spawn(executor, serve(std::move(socket)), boost::asio::detached);
+    }
+}
+
+// 处理单个HTTP请求，响应后关闭连接
+boost::asio::awaitable<void> MetricsServer::serve(boost::asio::ip::tcp::socket socket)
+{
+    using namespace boost::asio::experimental::awaitable_operators;
+
+    auto executor = co_await boost::asio::this_coro::executor;
+    boost::asio::steady_timer timer(executor);
+    timer.expires_after(std::chrono::milliseconds(REQUEST_TIMEOUT_MS));
+
+    std::string request;
+    auto result = co_await (
+        boost::asio::async_read_until(socket, boost::asio::dynamic_buffer(request, MAX_REQUEST_SIZE), "\r\n\r\n",
+                                      boost::asio::as_tuple(boost::asio::use_awaitable)) ||
+        timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable))
+    );
+    if (result.index() != 0 || std::get<0>(std::get<0>(result))) {
+        co_return;
+    }
+
+    std::string status;
+    std::string contentType = "text/plain; charset=utf-8";
+    std::string body;
+    if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0) {
+        status = "200 OK";
+        contentType = "text/plain; version=0.0.4; charset=utf-8";
+        body = MetricsRegistry::instance().prometheusText();
+    } else if (request.rfind("GET ", 0) == 0) {
+        status = "404 Not Found";
+        body = "not found\n";
+    } else {
+        status = "405 Method Not Allowed";
+        body = "method not allowed\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: " + contentType + "\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    co_await boost::asio::async_write(socket, boost::asio::buffer(response),
+                                      boost::asio::as_tuple(boost::asio::use_awaitable));
+
+    boost::system::error_code ec;
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    socket.close(ec);
+}
@@ -0,0 +1,44 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// 本地指标HTTP服务，仅监听127.0.0.1，以Prometheus文本格式输出 GET /metrics
+class MetricsServer
+{
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // 在指定端口启动，失败时返回false并写入错误信息
+    bool start(uint16_t port, std::string* error = nullptr);
+    // 停止服务并等待线程退出
+    void stop();
+
+    bool isRunning() const { return m_running.load(); }
+    uint16_t port() const { return m_port; }
+
+private:
+    boost::asio::awaitable<void> acceptLoop(boost::asio::ip::tcp::acceptor& acceptor);
+    boost::asio::awaitable<void> serve(boost::asio::ip::tcp::socket socket);
+
+    std::unique_ptr<boost::asio::io_context> m_ioContext;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    uint16_t m_port;
+
+    static constexpr std::size_t MAX_REQUEST_SIZE = 8192; // 请求头上限
+    static constexpr int REQUEST_TIMEOUT_MS = 5000;       // 单个请求超时
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,237 @@
+#include "monitor.h"
+#include "iputils.h"
+#include <QDateTime>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 最近秩百分位，sorted非空且已升序
+double percentile(const float* sorted, int count, double q)
+{
+    int rank = static_cast<int>(std::ceil(q * count));
+    return sorted[std::clamp(rank, 1, count) - 1];
+}
+
+} // namespace
+
+void LatencyWindow::summarize(double& lossRate, double& p50Ms, double& p95Ms) const
+{
+    std::array<float, WINDOW_SIZE> successes;
+    int successCount = 0;
+    for (int i = 0; i < m_count; ++i) {
+        if (m_samples[i] >= 0.0f) successes[successCount++] = m_samples[i];
+    }
+    lossRate = m_count > 0 ? 1.0 - static_cast<double>(successCount) / m_count : 0.0;
+    if (successCount == 0) {
+        p50Ms = -1.0;
+        p95Ms = -1.0;
+        return;
+    }
+    std::sort(successes.begin(), successes.begin() + successCount);
+    p50Ms = percentile(successes.data(), successCount, 0.50);
+    p95Ms = percentile(successes.data(), successCount, 0.95);
+}
+
+MonitorWorker::MonitorWorker(ScanEngine& engine, QObject* parent)
+    : QObject(parent)
+    , m_engine(engine)
+    , m_random(static_cast<std::minstd_rand::result_type>(QDateTime::currentMSecsSinceEpoch()))
+{
+    qRegisterMetaType<MonitorTargetStats>("MonitorTargetStats");
+    qRegisterMetaType<MonitorAlert>("MonitorAlert");
+    m_timer.setInterval(TICK_MS);
+    connect(&m_timer, &QTimer::timeout, this, &MonitorWorker::tick);
+}
+
+// 回调引用了this，必须等全部任务结束后才能释放
+MonitorWorker::~MonitorWorker()
+{
+    stop();
+}
+
+// 开始监控：目标去重并规范化，首次探测在一个间隔内均匀错开，避免全部目标同时到期
+void MonitorWorker::start(const MonitorSpec& spec)
+{
+    stop();
+
+    m_spec = spec;
+    m_spec.intervalMs = std::max(m_spec.intervalMs, MIN_INTERVAL_MS);
+    m_targets.clear();
+    m_index.clear();
+    for (const QString& entry : spec.targets) {
+        QString trimmed = entry.trimmed();
+        if (!IPUtils::isValidIP(trimmed)) continue;
+        QString ip = IPUtils::ipToString(IPUtils::stringToIP(trimmed));
+        if (m_index.contains(ip)) continue;
+        m_index.insert(ip, static_cast<int>(m_targets.size()));
+        Target target;
+        target.ip = ip;
+        m_targets.push_back(std::move(target));
+    }
+    if (m_targets.empty()) {
+        emit logMessage("监控列表中没有有效的IP地址");
+        return;
+    }
+
+    m_schedule = decltype(m_schedule)();
+    const int64_t now = QDateTime::currentMSecsSinceEpoch();
+    std::uniform_int_distribution<int64_t> offset(0, m_spec.intervalMs - 1);
+    for (int i = 0; i < static_cast<int>(m_targets.size()); ++i) {
+        m_schedule.push(Due(now + offset(m_random), i));
+    }
+
+    m_running = true;
+    m_timer.start();
+    emit logMessage(QString("开始监控 %1 个IP，平均间隔 %2 秒")
+                        .arg(m_targets.size()).arg(m_spec.intervalMs / 1000.0));
+}
+
+// 停止监控：取消进行中的探测并等待任务结束，保留各目标的窗口统计供查看
+void MonitorWorker::stop()
+{
+    m_timer.stop();
+    for (const auto& job : m_jobs) {
+        m_engine.cancel(job);
+    }
+    for (const auto& job : m_jobs) {
+        job->wait();
+    }
+    m_jobs.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Target& target : m_targets) {
+            target.pending = false;
+        }
+    }
+    if (m_running) {
+        m_running = false;
+        emit logMessage("监控已停止");
+    }
+}
+
+QVector<MonitorTargetStats> MonitorWorker::snapshot() const
+{
+    QVector<MonitorTargetStats> result;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result.reserve(static_cast<int>(m_targets.size()));
+    for (const Target& target : m_targets) {
+        result.append(statsOf(target));
+    }
+    return result;
+}
+
+int64_t MonitorWorker::nextInterval()
+{
+    std::uniform_real_distribution<double> jitter(1.0 - JITTER, 1.0 + JITTER);
+    return static_cast<int64_t>(m_spec.intervalMs * jitter(m_random));
+}
+
+// 到期的目标合并为一个任务提交；上一次探测还未返回的目标跳过本轮，不会同时有两个探测
+void MonitorWorker::tick()
+{
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(),
+                                [](const std::shared_ptr<ScanJob>& job) { return job->isFinished(); }),
+                 m_jobs.end());
+
+    const int64_t now = QDateTime::currentMSecsSinceEpoch();
+    QStringList due;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_schedule.empty() && m_schedule.top().first <= now) {
+            int index = m_schedule.top().second;
+            m_schedule.pop();
+            Target& target = m_targets[index];
+            if (!target.pending) {
+                target.pending = true;
+                due.append(target.ip);
+            }
+            m_schedule.push(Due(now + nextInterval(), index));
+        }
+    }
+    if (due.isEmpty()) return;
+
+    ScanJobSpec spec;
+    spec.cidrRanges = due;
+    spec.timeoutMs = m_spec.timeoutMs;
+    spec.maxConcurrentTasks = m_spec.maxConcurrentTasks;
+    spec.ports = m_spec.ports;
+    spec.probeType = m_spec.probeType;
+    spec.hostName = m_spec.hostName;
+
+    ScanJobSinks sinks;
+    sinks.onResult = [this](const ProbeResult& result) {
+        onResult(result);
+    };
+    m_jobs.push_back(m_engine.submit(std::move(spec), std::move(sinks)));
+}
+
+// 在引擎工作线程上调用：写入窗口并判断告警，锁外发出信号
+void MonitorWorker::onResult(const ProbeResult& result)
+{
+    auto it = m_index.constFind(result.ip);
+    if (it == m_index.constEnd()) return;
+
+    MonitorAlert change;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Target& target = m_targets[it.value()];
+        target.pending = false;
+        target.lastLatencyMs = result.success ? static_cast<float>(result.latencyMs) : -1.0f;
+        target.lastProbeMs = QDateTime::currentMSecsSinceEpoch();
+        target.window.add(target.lastLatencyMs);
+        ++target.probes;
+        changed = evaluate(target, change);
+    }
+    if (changed) {
+        emit alert(change);
+    }
+}
+
+MonitorTargetStats MonitorWorker::statsOf(const Target& target) const
+{
+    MonitorTargetStats stats;
+    stats.ip = target.ip;
+    stats.samples = target.window.count();
+    target.window.summarize(stats.lossRate, stats.p50Ms, stats.p95Ms);
+    stats.lastLatencyMs = target.lastLatencyMs;
+    stats.lastProbeMs = target.lastProbeMs;
+    stats.probes = target.probes;
+    stats.degraded = target.degraded;
+    return stats;
+}
+
+bool MonitorWorker::evaluate(Target& target, MonitorAlert& alert) const
+{
+    const MonitorThresholds& limits = m_spec.thresholds;
+    if (target.window.count() < limits.minSamples) return false;
+
+    double lossRate = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    target.window.summarize(lossRate, p50Ms, p95Ms);
+
+    if (!target.degraded) {
+        QString reason;
+        if (lossRate > limits.maxLossRate) {
+            reason = QString("丢包率 %1%").arg(lossRate * 100.0, 0, 'f', 0);
+        } else if (p95Ms > limits.maxP95Ms) {
+            reason = QString("p95延迟 %1 毫秒").arg(p95Ms, 0, 'f', 1);
+        } else {
+            return false;
+        }
+        target.degraded = true;
+        alert.reason = reason;
+    } else {
+        bool recovered = lossRate <= limits.maxLossRate * RECOVERY_FACTOR &&
+                         p95Ms >= 0.0 && p95Ms <= limits.maxP95Ms * RECOVERY_FACTOR;
+        if (!recovered) return false;
+        target.degraded = false;
+        alert.reason = QString("丢包率 %1%，p95延迟 %2 毫秒")
+                           .arg(lossRate * 100.0, 0, 'f', 0).arg(p95Ms, 0, 'f', 1);
+    }
+    alert.degraded = target.degraded;
+    alert.stats = statsOf(target);
+    return true;
+}
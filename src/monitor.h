@@ -0,0 +1,148 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include "scanengine.h"
+#include <QHash>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <vector>
+
+// 一个监控目标最近WINDOW_SIZE次探测的延迟，定长环形缓冲区，写满后覆盖最旧的样本
+class LatencyWindow
+{
+public:
+    static constexpr int WINDOW_SIZE = 64;
+
+    void add(float latencyMs) // 失败记为负数
+    {
+        m_samples[m_head] = latencyMs;
+        m_head = (m_head + 1) % WINDOW_SIZE;
+        if (m_count < WINDOW_SIZE) ++m_count;
+    }
+    void clear() { m_head = 0; m_count = 0; }
+    int count() const { return m_count; }
+
+    // 窗口内的丢包率与成功样本的p50/p95（最近秩），没有成功样本时延迟为-1
+    void summarize(double& lossRate, double& p50Ms, double& p95Ms) const;
+
+private:
+    std::array<float, WINDOW_SIZE> m_samples{};
+    int m_head = 0;
+    int m_count = 0;
+};
+
+// 告警阈值：窗口内至少minSamples个样本后才判断；恢复需低于阈值乘以RECOVERY_FACTOR，避免在阈值附近反复告警
+struct MonitorThresholds {
+    double maxLossRate = 0.2;   // 丢包率上限
+    double maxP95Ms = 300.0;    // p95延迟上限（毫秒）
+    int minSamples = 5;
+};
+
+// 监控参数
+struct MonitorSpec {
+    QStringList targets;              // 监控的IP列表
+    int intervalMs = 10000;           // 每个目标的平均探测间隔，实际间隔在±JITTER内随机
+    int timeoutMs = 1000;
+    int maxConcurrentTasks = 200;
+    std::vector<uint16_t> ports{80};
+    ProbeType probeType = ProbeType::Tcp;
+    QString hostName = "cloudflare.com";
+    MonitorThresholds thresholds;
+};
+
+// 一个目标在滚动窗口内的表现
+struct MonitorTargetStats {
+    QString ip;
+    int samples = 0;            // 窗口内的样本数
+    double lossRate = 0.0;
+    double p50Ms = -1.0;
+    double p95Ms = -1.0;
+    double lastLatencyMs = -1.0; // 最近一次探测，失败为-1
+    int64_t lastProbeMs = 0;     // 最近一次结果的时间（Unix毫秒），尚未探测为0
+    uint64_t probes = 0;         // 开始监控以来的探测次数
+    bool degraded = false;       // 处于告警状态
+};
+Q_DECLARE_METATYPE(MonitorTargetStats)
+
+// 告警：目标进入或离开告警状态时各发出一次
+struct MonitorAlert {
+    bool degraded = false;       // true为劣化，false为恢复
+    QString reason;
+    MonitorTargetStats stats;
+};
+Q_DECLARE_METATYPE(MonitorAlert)
+
+// 持续监控：按各目标自己的带抖动的间隔反复探测，复用常驻的ScanEngine。
+// 调度在所属线程的定时器上进行，每个节拍把到期的目标作为一个小任务提交；
+// 结果在引擎工作线程上直接写入目标的环形缓冲区，只有告警状态变化时才发出信号
+class MonitorWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MonitorWorker(ScanEngine& engine, QObject* parent = nullptr);
+    ~MonitorWorker(); // 取消并等待未结束的任务
+
+    bool isRunning() const { return m_running; }
+    int targetCount() const { return static_cast<int>(m_targets.size()); }
+    // 当前全部目标的窗口统计，按加入顺序
+    QVector<MonitorTargetStats> snapshot() const;
+
+public slots:
+    void start(const MonitorSpec& spec);
+    void stop();
+
+signals:
+    void alert(const MonitorAlert& alert);
+    void logMessage(const QString& message);
+
+private:
+    struct Target {
+        QString ip;
+        LatencyWindow window;
+        float lastLatencyMs = -1.0f;
+        int64_t lastProbeMs = 0;
+        uint64_t probes = 0;
+        bool pending = false;   // 已提交、结果未到，到期时跳过本轮
+        bool degraded = false;
+    };
+    using Due = std::pair<int64_t, int>; // (到期时间, 目标序号)
+
+    // 节拍：提交到期目标并重新安排下一次
+    void tick();
+    int64_t nextInterval();
+    void onResult(const ProbeResult& result);
+    MonitorTargetStats statsOf(const Target& target) const; // 调用方持有m_mutex
+    // 按阈值判断状态变化，有变化时填写告警并返回true；调用方持有m_mutex
+    bool evaluate(Target& target, MonitorAlert& alert) const;
+
+    ScanEngine& m_engine;
+    MonitorSpec m_spec;
+    QTimer m_timer;
+    bool m_running = false;
+
+    mutable std::mutex m_mutex;                 // 保护m_targets中的可变状态
+    std::vector<Target> m_targets;              // 启动后大小不变
+    QHash<QString, int> m_index;                // IP到目标序号，启动后只读
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> m_schedule; // 只在所属线程访问
+    std::vector<std::shared_ptr<ScanJob>> m_jobs; // 未结束的任务
+    std::minstd_rand m_random;
+
+    static constexpr int TICK_MS = 250;          // 调度节拍
+    static constexpr double JITTER = 0.2;        // 间隔在平均值的±20%内随机，错开各目标
+    static constexpr double RECOVERY_FACTOR = 0.8;
+    static constexpr int MIN_INTERVAL_MS = 1000;
+};
+
+#endif // MONITOR_H
@@ -19,7 +19,7 @@ int PingResultModel::rowCount(const QModelIndex &parent) const
 int PingResultModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return 3; // IP, 延迟, 状态
+    return BASE_COLUMN_COUNT + static_cast<int>(m_ports.size());
 }
 
 QVariant PingResultModel::data(const QModelIndex &index, int role) const
@@ -34,10 +34,20 @@ QVariant PingResultModel::data(const QModelIndex &index, int role) const
         case 0: return result.ip;
         case 1: return QString::number(result.latency, 'f', 2);
         case 2: return result.success ? "已连接" : "失败";
+        case 3: return result.colo;
+        case 4:
+            if (!result.speedTested) return QVariant();
+            return result.throughputMbps > 0.0 ? QString::number(result.throughputMbps, 'f', 1) : QString("失败");
+        default: {
+            int portColumn = index.column() - BASE_COLUMN_COUNT;
+            if (portColumn < 0 || portColumn >= result.portLatencies.size()) return QVariant();
+            double latency = result.portLatencies[portColumn];
+            return latency >= 0.0 ? QString::number(latency, 'f', 2) : QString("-");
+        }
         }
     }
     else if (role == Qt::TextAlignmentRole) {
-        if (index.column() == 1) { // 延迟列右对齐
+        if (index.column() == 1 || index.column() >= 4) { // 数值列右对齐
             return Qt::AlignRight + Qt::AlignVCenter;
         }
         return Qt::AlignLeft + Qt::AlignVCenter;
@@ -53,6 +63,30 @@ QVariant PingResultModel::data(const QModelIndex &index, int role) const
         QString protocol = result.ip.contains(':') ? "IPv6" : "IPv4";
         return QString("%1 (%2)").arg(result.ip).arg(protocol);
     }
+    else if (role == Qt::ToolTipRole && index.column() == 1 && result.totalMs > 0.0) {
+        // HTTP探测的分段耗时
+        return QString("连接 %1 ms / 首字节 %2 ms / 完整响应 %3 ms")
+            .arg(result.connectMs, 0, 'f', 2)
+            .arg(result.latency, 0, 'f', 2)
+            .arg(result.totalMs, 0, 'f', 2);
+    }
+    else if (role == Qt::ToolTipRole && index.column() == 4 && result.throughputMbps > 0.0) {
+        return QString("综合评分 %1").arg(result.score, 0, 'f', 2);
+    }
+    else if (role == Qt::ToolTipRole && index.column() == 1 && result.tlsMs > 0.0) {
+        // TLS探测的分段耗时，握手时间从连接开始计
+        return QString("连接 %1 ms / TLS握手 %2 ms")
+            .arg(result.connectMs, 0, 'f', 2)
+            .arg(result.tlsMs - result.connectMs, 0, 'f', 2);
+    }
+    else if (role == Qt::ToolTipRole && index.column() == 1 && result.kernelRttMs >= 0.0) {
+        // 内核RTT与用户态计时的对比，差值为调度排队造成的偏差
+        return QString("内核RTT %1 ms / 用户态连接 %2 ms").arg(result.kernelRttMs, 0, 'f', 2).arg(result.connectMs, 0, 'f', 2);
+    }
+    else if (role == Qt::ToolTipRole && index.column() == 1 && !m_ports.empty()) {
+        // 多端口时延迟列为最快端口的延迟
+        return QString("最快端口 %1").arg(result.port);
+    }
     
     return QVariant();
 }
@@ -64,6 +98,12 @@ QVariant PingResultModel::headerData(int section, Qt::Orientation orientation, i
         case 0: return "IP地址 (IPv4/IPv6)";
         case 1: return "延迟 (毫秒)";
         case 2: return "状态";
+        case 3: return "机房";
+        case 4: return "速度 (Mbps)";
+        default:
+            if (section >= BASE_COLUMN_COUNT && section < columnCount()) {
+                return QString("端口 %1 (毫秒)").arg(m_ports[section - BASE_COLUMN_COUNT]);
+            }
         }
     }
     return QVariant();
@@ -88,6 +128,7 @@ void PingResultModel::clear()
     m_results.clear();
     m_pendingResults.clear();
     m_updateTimer->stop();
+    m_rankByScore = false;
     endResetModel();
 }
 
@@ -135,6 +176,55 @@ void PingResultModel::sortResults()
                  if (!a.success) return false;
                  return a.latency < b.latency;
              });
+    if (m_rankByScore) {
+        // 已测速的排在前面按评分降序，其余保持延迟顺序
+        std::stable_sort(m_results.begin(), m_results.end(),
+                         [](const PingResult& a, const PingResult& b) {
+                             if (a.speedTested != b.speedTested) return a.speedTested > b.speedTested;
+                             return a.speedTested && a.score > b.score;
+                         });
+    }
+}
+
+QVector<PingResult> PingResultModel::topResults(int count)
+{
+    if (!m_pendingResults.isEmpty()) {
+        processPendingUpdates();
+    }
+    QVector<PingResult> top;
+    for (const PingResult& result : m_results) {
+        if (result.success) top.append(result);
+    }
+    std::sort(top.begin(), top.end(), [](const PingResult& a, const PingResult& b) {
+        return a.latency < b.latency;
+    });
+    if (top.size() > count) {
+        top.resize(count);
+    }
+    return top;
+}
+
+void PingResultModel::setSpeedResult(const QString& ip, bool success, double mbps, double score)
+{
+    for (PingResult& result : m_results) {
+        if (result.ip != ip) continue;
+        result.speedTested = true;
+        result.throughputMbps = success ? mbps : 0.0;
+        result.score = success ? score : 0.0;
+        m_rankByScore = true;
+
+        beginResetModel();
+        sortResults();
+        endResetModel();
+        return;
+    }
+}
+
+void PingResultModel::setPorts(const std::vector<uint16_t>& ports)
+{
+    beginResetModel();
+    m_ports = ports.size() > 1 ? ports : std::vector<uint16_t>();
+    endResetModel();
 }
 
 QStringList PingResultModel::getAllIPs() const
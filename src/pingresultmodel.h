@@ -6,14 +6,26 @@
 #include <QString>
 #include <QTimer>
 #include <QColor>
+#include <cstdint>
+#include <vector>
 
 struct PingResult {
     QString ip;
     double latency;
     bool success;
+    QString colo;            // 应答机房（HTTP探测）
+    double connectMs = 0.0;  // TCP连接时间（HTTP/TLS探测时latency为首字节/握手完成时间）
+    double kernelRttMs = -1.0; // 内核测得的握手RTT，未启用时为-1
+    double totalMs = 0.0;    // 完整响应时间（HTTP探测）
+    double tlsMs = 0.0;      // 握手完成时间（TLS探测）
+    bool speedTested = false;     // 是否已测速
+    double throughputMbps = 0.0;  // 测速得到的持续吞吐，失败为0
+    double score = 0.0;           // 延迟与带宽的综合评分
+    int port = 0;                 // 延迟对应的端口
+    QVector<double> portLatencies; // 多端口扫描时各端口的延迟，失败为-1
     
-    PingResult(const QString& ip = "", double latency = 0.0, bool success = false)
-        : ip(ip), latency(latency), success(success) {}
+    PingResult(const QString& ip = "", double latency = 0.0, bool success = false, const QString& colo = QString())
+        : ip(ip), latency(latency), success(success), colo(colo) {}
 };
 
 class PingResultModel : public QAbstractTableModel
@@ -33,6 +45,12 @@ public:
     void clear();
     QStringList getAllIPs() const;
     QStringList getSelectedIPs(const QModelIndexList& selection) const;
+    // 按延迟取前count个成功结果（先合并尚未刷新的结果），用于测速
+    QVector<PingResult> topResults(int count);
+    // 写入一个IP的测速结果，之后已测速的结果按综合评分排在前面
+    void setSpeedResult(const QString& ip, bool success, double mbps, double score);
+    // 设置扫描的端口列表，多于一个端口时为每个端口增加一列延迟
+    void setPorts(const std::vector<uint16_t>& ports);
     
 private slots:
     void processPendingUpdates();
@@ -43,7 +61,10 @@ private:
     QVector<PingResult> m_results;
     QVector<PingResult> m_pendingResults;
     QTimer* m_updateTimer;
+    bool m_rankByScore = false; // 有测速结果时按综合评分排序
+    std::vector<uint16_t> m_ports; // 多端口扫描时的端口列，单端口时为空
     
+    static constexpr int BASE_COLUMN_COUNT = 5; // IP, 延迟, 状态, 机房, 速度；之后为各端口列
     static constexpr int MAX_DISPLAY_COUNT = 100;
     static constexpr int UPDATE_INTERVAL_MS = 500; 
 };
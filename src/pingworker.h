@@ -1,88 +1,67 @@
 ﻿#ifndef PINGWORKER_H
 #define PINGWORKER_H
 
+#include "scanengine.h"
 #include <QObject>
 #include <QString>
-#include <QTimer>
-#include <QThread>
-#include <boost/asio.hpp>
-#include <boost/asio/co_spawn.hpp>
-#include <boost/asio/detached.hpp>
-#include <boost/asio/use_awaitable.hpp>
-#include <boost/asio/cancellation_signal.hpp>
+#include <QStringList>
 #include <memory>
-#include <atomic>
 #include <vector>
-#include <queue>
-#include <mutex>
-#include <thread>
 
-class CidrExpander;
-
-// PingWorker类，负责批量异步TCP连接测试
+// PingWorker类：把一次扫描任务提交到常驻的ScanEngine，并将任务回调转换为Qt信号
+// 信号可能从引擎的工作线程发出，接收方应使用队列连接（跨线程时Qt默认如此）
 class PingWorker : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit PingWorker(QObject *parent = nullptr); // 构造函数
-    ~PingWorker(); // 析构函数
+    explicit PingWorker(ScanEngine& engine, QObject *parent = nullptr); // 构造函数
+    ~PingWorker(); // 析构函数，取消未完成的任务并等待其结束
 
-    // 设置线程数、超时时间、日志开关、最大并发任务数、端口号
-    void setSettings(int threadCount, int timeoutMs, bool enableLogging, int maxConcurrentTasks, int port);
+    // 设置超时时间、最大并发任务数、端口列表（线程数由引擎决定，日志级别由EventLog统一控制）
+    void setSettings(int timeoutMs, int maxConcurrentTasks, const std::vector<uint16_t>& ports);
+    // 设置探测方式，HTTP探测使用给定的Host头
+    void setProbeType(ProbeType type, const QString& hostName = QString());
+    // 探测成功后是否以RST关闭连接（不留TIME_WAIT）
+    void setAbortiveClose(bool enabled) { m_abortiveClose = enabled; }
+    // 是否读取内核RTT（TCP探测以它排序）
+    void setKernelRtt(bool enabled) { m_kernelRtt = enabled; }
+    // 设置文件输入，非空时startPing忽略传入的CIDR列表
+    void setInputFile(std::shared_ptr<CidrFileSource> file) { m_inputFile = std::move(file); }
+    // 设置分片，只扫描全部地址中属于本片的部分
+    void setShard(const ScanShard& shard) { m_shard = shard; }
+    // 设置先验，历史上表现好的网段先扫描
+    void setPrior(std::shared_ptr<const ScanPrior> prior) { m_prior = std::move(prior); }
+    // 得到count个延迟不超过maxLatencyMs（0为不限）的成功结果后提前结束，count为0时不启用
+    void setEarlyStop(uint64_t count, double maxLatencyMs) { m_stopAfter = count; m_stopMaxLatencyMs = maxLatencyMs; }
 
 public slots:
     void startPing(const QStringList& cidrRanges); // 启动ping任务
     void stopPing(); // 停止ping任务
 
 signals:
-    void pingResult(const QString& ip, double latency, bool success); // 单个IP测试结果
-    void progress(int current, int total); // 进度信号
+    void pingResult(const ProbeResult& result); // 单个IP测试结果
+    void progress(const ScanJobStats& stats); // 进度快照，引擎按固定频率发出
     void logMessage(const QString& message); // 日志信号
     void finished(); // 任务完成信号
 
 private:
-    // 协程：对单个IP进行TCP连接测试
-    boost::asio::awaitable<void> pingIPWithAddress(boost::asio::ip::address address, QString originalIP);
-
-    // 处理下一批IP
-    void processNextBatch();
-    // 清理资源
-    void cleanup();
-    // 安全清理，防止重复
-    void safeCleanup();
-    
-    // Boost Asio相关成员
-    std::unique_ptr<boost::asio::io_context> m_ioContext; // IO上下文
-    std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> m_workGuard; // 保持io_context存活
-    std::unique_ptr<boost::asio::cancellation_signal> m_cancellationSignal; // 协程取消信号
-    std::vector<std::thread> m_threads; // 线程池
-    std::unique_ptr<CidrExpander> m_cidrExpander; // CIDR扩展器
-    
-    // IP队列与互斥锁
-    std::queue<QString> m_ipQueue;
-    std::mutex m_queueMutex;
-    
-    // 定时器
-    QTimer* m_batchTimer; // 批量处理定时器
-    QTimer* m_stopCheckTimer; // 停止检查定时器
-    QTimer* m_cleanupTimer; // 清理定时器
-    
-    // 状态变量
-    std::atomic<bool> m_running; // 是否正在运行
-    std::atomic<bool> m_stopRequested; // 是否请求停止
-    std::atomic<bool> m_cleanupInProgress; // 是否正在清理
-    std::atomic<int> m_completedCount; // 已完成数量
-    std::atomic<int> m_totalCount; // 总数量
-    std::atomic<int> m_activePings; // 活跃任务数
+    ScanEngine& m_engine; // 常驻扫描引擎
+    std::shared_ptr<ScanJob> m_job; // 当前任务
     
-    int m_threadCount; // 线程数
     int m_timeoutMs; // 超时时间
     int m_maxConcurrentTasks; // 最大并发任务数
-    int m_port; // 端口号
-    bool m_enableLogging; // 是否启用日志
+    std::vector<uint16_t> m_ports; // 端口列表，多个端口时同一轮扫描交错探测
+    ProbeType m_probeType; // 探测方式
+    QString m_hostName; // HTTP探测的Host头与TLS探测的SNI
+    bool m_abortiveClose = false; // 成功后以RST关闭
+    bool m_kernelRtt = false; // 读取内核RTT
+    std::shared_ptr<CidrFileSource> m_inputFile; // 映射的地址文件
+    ScanShard m_shard; // 分片设置
+    std::shared_ptr<const ScanPrior> m_prior; // 热启动先验
+    uint64_t m_stopAfter = 0; // 提前停止的结果数
+    double m_stopMaxLatencyMs = 0.0; // 提前停止计数的延迟上限
     
-    static constexpr int BATCH_SIZE = 500; // 每批处理数量
     static constexpr int DEFAULT_MAX_CONCURRENT_PINGS = 1000; // 默认最大并发数
 };
 
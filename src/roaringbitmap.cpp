@@ -0,0 +1,443 @@
+#include "roaringbitmap.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+constexpr uint32_t CONTAINER_BITS = 65536;
+
+// 置位闭区间[lo, hi]
+void setBits(std::vector<uint64_t>& words, uint32_t lo, uint32_t hi)
+{
+    for (uint32_t word = lo >> 6; word <= hi >> 6; ++word) {
+        uint32_t from = word == (lo >> 6) ? lo & 63 : 0;
+        uint32_t to = word == (hi >> 6) ? hi & 63 : 63;
+        uint64_t mask = (to == 63 ? ~0ULL : (1ULL << (to + 1)) - 1) & ~((1ULL << from) - 1);
+        words[word] |= mask;
+    }
+}
+
+// 从pos起第一个置位（set为true）或清零（set为false）的位，没有时返回CONTAINER_BITS
+uint32_t nextBit(const std::vector<uint64_t>& words, uint32_t pos, bool set)
+{
+    while (pos < CONTAINER_BITS) {
+        uint64_t word = set ? words[pos >> 6] : ~words[pos >> 6];
+        word &= ~0ULL << (pos & 63);
+        if (word != 0) {
+            return (pos & ~63u) + static_cast<uint32_t>(std::countr_zero(word));
+        }
+        pos = (pos & ~63u) + 64;
+    }
+    return CONTAINER_BITS;
+}
+
+// 容器内的连续区间，按升序调用visit(lo, hi)
+template <typename Visit>
+void forEachWordRun(const std::vector<uint64_t>& words, Visit&& visit)
+{
+    uint32_t pos = nextBit(words, 0, true);
+    while (pos < CONTAINER_BITS) {
+        uint32_t end = nextBit(words, pos, false);
+        visit(pos, end - 1);
+        pos = end < CONTAINER_BITS ? nextBit(words, end, true) : CONTAINER_BITS;
+    }
+}
+
+template <typename T>
+void writeValue(QIODevice& device, const T& value)
+{
+    device.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(QIODevice& device, T& value)
+{
+    return device.read(reinterpret_cast<char*>(&value), sizeof(T)) == static_cast<qint64>(sizeof(T));
+}
+
+template <typename T>
+void writeVector(QIODevice& device, const std::vector<T>& values)
+{
+    writeValue(device, static_cast<uint32_t>(values.size()));
+    device.write(reinterpret_cast<const char*>(values.data()), static_cast<qint64>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+bool readVector(QIODevice& device, std::vector<T>& values, uint32_t maxSize)
+{
+    uint32_t size = 0;
+    if (!readValue(device, size) || size > maxSize) return false;
+    values.resize(size);
+    const qint64 bytes = static_cast<qint64>(size * sizeof(T));
+    return device.read(reinterpret_cast<char*>(values.data()), bytes) == bytes;
+}
+
+} // namespace
+
+void RoaringBitmap::Container::toWords(std::vector<uint64_t>& out) const
+{
+    if (kind == Kind::Bitmap) {
+        out = words;
+        return;
+    }
+    if (kind == Kind::Full) {
+        out.assign(WORDS, ~0ULL);
+        return;
+    }
+    out.assign(WORDS, 0);
+    if (kind == Kind::Array) {
+        for (uint16_t value : values) {
+            out[value >> 6] |= 1ULL << (value & 63);
+        }
+    } else {
+        for (const auto& run : runs) {
+            setBits(out, run.first, static_cast<uint32_t>(run.first) + run.second);
+        }
+    }
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::fromWords(uint16_t key, const std::vector<uint64_t>& bits)
+{
+    Container container;
+    container.key = key;
+    uint32_t runCount = 0;
+    uint64_t carry = 0; // 前一个字的最高位
+    for (uint64_t word : bits) {
+        container.cardinality += static_cast<uint32_t>(std::popcount(word));
+        runCount += static_cast<uint32_t>(std::popcount(word & ~((word << 1) | carry)));
+        carry = word >> 63;
+    }
+    if (container.cardinality == 0) return container;
+    if (container.cardinality == CONTAINER_BITS) {
+        container.kind = Kind::Full;
+        return container;
+    }
+
+    const std::size_t arrayBytes = container.cardinality * sizeof(uint16_t);
+    const std::size_t bitmapBytes = WORDS * sizeof(uint64_t);
+    const std::size_t runBytes = runCount * 2 * sizeof(uint16_t);
+    if (runBytes < std::min(arrayBytes, bitmapBytes)) {
+        container.kind = Kind::Run;
+        container.runs.reserve(runCount);
+        forEachWordRun(bits, [&](uint32_t lo, uint32_t hi) {
+            container.runs.emplace_back(static_cast<uint16_t>(lo), static_cast<uint16_t>(hi - lo));
+        });
+    } else if (container.cardinality <= ARRAY_MAX) {
+        container.kind = Kind::Array;
+        container.values.reserve(container.cardinality);
+        forEachWordRun(bits, [&](uint32_t lo, uint32_t hi) {
+            for (uint32_t value = lo; value <= hi; ++value) {
+                container.values.push_back(static_cast<uint16_t>(value));
+            }
+        });
+    } else {
+        container.kind = Kind::Bitmap;
+        container.words = bits;
+    }
+    return container;
+}
+
+std::size_t RoaringBitmap::Container::memoryBytes() const
+{
+    return sizeof(Container) + values.capacity() * sizeof(uint16_t) + words.capacity() * sizeof(uint64_t) +
+           runs.capacity() * sizeof(runs[0]);
+}
+
+RoaringBitmap::Container* RoaringBitmap::findOrCreate(uint16_t key)
+{
+    if (m_lastIndex < m_containers.size() && m_containers[m_lastIndex].key == key) {
+        return &m_containers[m_lastIndex];
+    }
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                               [](const Container& container, uint16_t value) { return container.key < value; });
+    if (it == m_containers.end() || it->key != key) {
+        Container container;
+        container.key = key;
+        it = m_containers.insert(it, std::move(container));
+    }
+    m_lastIndex = static_cast<std::size_t>(it - m_containers.begin());
+    return &*it;
+}
+
+const RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) const
+{
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                               [](const Container& container, uint16_t value) { return container.key < value; });
+    return it != m_containers.end() && it->key == key ? &*it : nullptr;
+}
+
+void RoaringBitmap::add(uint32_t value)
+{
+    Container* container = findOrCreate(static_cast<uint16_t>(value >> 16));
+    const uint16_t low = static_cast<uint16_t>(value);
+    if (container->kind == Kind::Full) return;
+    if (container->kind == Kind::Run) {
+        if (contains(value)) return;
+        // 区间容器来自optimize、读入的文件或写满后的转换；再写入区间外的值时退回位图
+        container->toWords(container->words);
+        container->runs.clear();
+        container->kind = Kind::Bitmap;
+    }
+    if (container->kind == Kind::Array) {
+        auto it = std::lower_bound(container->values.begin(), container->values.end(), low);
+        if (it != container->values.end() && *it == low) return;
+        container->values.insert(it, low);
+        if (++container->cardinality > ARRAY_MAX) {
+            container->toWords(container->words);
+            container->values.clear();
+            container->values.shrink_to_fit();
+            container->kind = Kind::Bitmap;
+        }
+        return;
+    }
+    uint64_t& word = container->words[low >> 6];
+    const uint64_t bit = 1ULL << (low & 63);
+    if (!(word & bit)) {
+        word |= bit;
+        // 写满的容器立即释放位图：顺序扫描整个IPv4空间时已探测位图为65536个满容器，
+        // 实测memoryBytes()为5242912字节（只剩每个容器80字节的结构体），而不是512MB
+        if (++container->cardinality == CONTAINER_BITS) {
+            container->words.clear();
+            container->words.shrink_to_fit();
+            container->kind = Kind::Full;
+        }
+    }
+}
+
+void RoaringBitmap::addRange(uint32_t first, uint32_t last)
+{
+    if (first > last) return;
+    std::vector<uint64_t> bits;
+    for (uint32_t key = first >> 16; key <= last >> 16; ++key) {
+        uint32_t lo = key == (first >> 16) ? first & 0xFFFF : 0;
+        uint32_t hi = key == (last >> 16) ? last & 0xFFFF : 0xFFFF;
+        Container* container = findOrCreate(static_cast<uint16_t>(key));
+        container->toWords(bits);
+        setBits(bits, lo, hi);
+        *container = Container::fromWords(static_cast<uint16_t>(key), bits);
+    }
+}
+
+bool RoaringBitmap::contains(uint32_t value) const
+{
+    const Container* container = find(static_cast<uint16_t>(value >> 16));
+    if (!container) return false;
+    const uint16_t low = static_cast<uint16_t>(value);
+    switch (container->kind) {
+    case Kind::Array:
+        return std::binary_search(container->values.begin(), container->values.end(), low);
+    case Kind::Bitmap:
+        return (container->words[low >> 6] >> (low & 63)) & 1;
+    case Kind::Full:
+        return true;
+    case Kind::Run: {
+        auto it = std::upper_bound(container->runs.begin(), container->runs.end(), low,
+                                   [](uint16_t value, const std::pair<uint16_t, uint16_t>& run) {
+                                       return value < run.first;
+                                   });
+        if (it == container->runs.begin()) return false;
+        --it;
+        return low <= static_cast<uint32_t>(it->first) + it->second;
+    }
+    }
+    return false;
+}
+
+uint64_t RoaringBitmap::cardinality() const
+{
+    uint64_t total = 0;
+    for (const Container& container : m_containers) {
+        total += container.cardinality;
+    }
+    return total;
+}
+
+std::size_t RoaringBitmap::memoryBytes() const
+{
+    std::size_t total = sizeof(*this);
+    for (const Container& container : m_containers) {
+        total += container.memoryBytes();
+    }
+    return total;
+}
+
+void RoaringBitmap::optimize()
+{
+    std::vector<uint64_t> bits;
+    for (Container& container : m_containers) {
+        container.toWords(bits);
+        container = Container::fromWords(container.key, bits);
+    }
+}
+
+RoaringBitmap RoaringBitmap::combine(const RoaringBitmap& other, WordOp op, bool keepLeft, bool keepRight) const
+{
+    RoaringBitmap result;
+    std::vector<uint64_t> left;
+    std::vector<uint64_t> right;
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < m_containers.size() || j < other.m_containers.size()) {
+        if (j == other.m_containers.size() ||
+            (i < m_containers.size() && m_containers[i].key < other.m_containers[j].key)) {
+            if (keepLeft) result.m_containers.push_back(m_containers[i]);
+            ++i;
+        } else if (i == m_containers.size() || other.m_containers[j].key < m_containers[i].key) {
+            if (keepRight) result.m_containers.push_back(other.m_containers[j]);
+            ++j;
+        } else {
+            m_containers[i].toWords(left);
+            other.m_containers[j].toWords(right);
+            for (std::size_t w = 0; w < WORDS; ++w) {
+                left[w] = op(left[w], right[w]);
+            }
+            Container merged = Container::fromWords(m_containers[i].key, left);
+            if (merged.cardinality > 0) result.m_containers.push_back(std::move(merged));
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap& other) const
+{
+    return combine(other, [](uint64_t a, uint64_t b) { return a | b; }, true, true);
+}
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap& other) const
+{
+    return combine(other, [](uint64_t a, uint64_t b) { return a & b; }, false, false);
+}
+
+RoaringBitmap RoaringBitmap::operator-(const RoaringBitmap& other) const
+{
+    return combine(other, [](uint64_t a, uint64_t b) { return a & ~b; }, true, false);
+}
+
+void RoaringBitmap::forEachRange(const std::function<void(uint32_t first, uint32_t last)>& visit) const
+{
+    bool pending = false;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    auto emitRange = [&](uint64_t lo, uint64_t hi) {
+        if (pending && lo == end + 1) {
+            end = hi;
+            return;
+        }
+        if (pending) visit(static_cast<uint32_t>(start), static_cast<uint32_t>(end));
+        pending = true;
+        start = lo;
+        end = hi;
+    };
+
+    std::vector<uint64_t> bits;
+    for (const Container& container : m_containers) {
+        const uint64_t base = static_cast<uint64_t>(container.key) << 16;
+        if (container.kind == Kind::Full) {
+            emitRange(base, base + 0xFFFF);
+        } else if (container.kind == Kind::Run) {
+            for (const auto& run : container.runs) {
+                emitRange(base + run.first, base + run.first + run.second);
+            }
+        } else if (container.kind == Kind::Array) {
+            for (uint16_t value : container.values) {
+                emitRange(base + value, base + value);
+            }
+        } else {
+            forEachWordRun(container.words, [&](uint32_t lo, uint32_t hi) { emitRange(base + lo, base + hi); });
+        }
+    }
+    if (pending) visit(static_cast<uint32_t>(start), static_cast<uint32_t>(end));
+}
+
+// 格式：容器数，之后每个容器为键、类型、元素数与该类型的内容
+bool RoaringBitmap::write(QIODevice& device) const
+{
+    writeValue(device, static_cast<uint32_t>(m_containers.size()));
+    for (const Container& container : m_containers) {
+        writeValue(device, container.key);
+        writeValue(device, static_cast<uint8_t>(container.kind == Kind::Full ? Kind::Run : container.kind));
+        writeValue(device, container.cardinality);
+        switch (container.kind) {
+        case Kind::Array: writeVector(device, container.values); break;
+        case Kind::Bitmap: writeVector(device, container.words); break;
+        case Kind::Run: writeVector(device, container.runs); break;
+        case Kind::Full: writeVector(device, std::vector<std::pair<uint16_t, uint16_t>>{{0, 0xFFFF}}); break;
+        }
+    }
+    return true;
+}
+
+// 损坏或来源不明的文件中，越界的区间会在toWords中写出位图之外，读入时逐项检查
+bool RoaringBitmap::Container::isValid() const
+{
+    if (cardinality == 0) return false;
+    switch (kind) {
+    case Kind::Array:
+        return values.size() == cardinality && std::adjacent_find(values.begin(), values.end(),
+                   [](uint16_t a, uint16_t b) { return a >= b; }) == values.end();
+    case Kind::Bitmap: {
+        uint64_t bits = 0;
+        for (uint64_t word : words) bits += static_cast<uint64_t>(std::popcount(word));
+        return words.size() == WORDS && bits == cardinality;
+    }
+    case Kind::Run: {
+        uint64_t total = 0;
+        int64_t previousLast = -2;
+        for (const auto& [first, lengthMinusOne] : runs) {
+            const uint32_t last = uint32_t(first) + lengthMinusOne;
+            if (last > 0xFFFF || int64_t(first) <= previousLast + 1) return false;
+            total += uint64_t(lengthMinusOne) + 1;
+            previousLast = last;
+        }
+        return total == cardinality;
+    }
+    case Kind::Full:
+        return cardinality == CONTAINER_BITS;
+    }
+    return false;
+}
+
+bool RoaringBitmap::read(QIODevice& device)
+{
+    uint32_t count = 0;
+    if (!readValue(device, count) || count > CONTAINER_BITS) return false;
+    std::vector<Container> containers(count);
+    for (Container& container : containers) {
+        uint8_t kind = 0;
+        if (!readValue(device, container.key) || !readValue(device, kind) ||
+            !readValue(device, container.cardinality) || container.cardinality > CONTAINER_BITS) {
+            return false;
+        }
+        bool ok = false;
+        switch (static_cast<Kind>(kind)) {
+        case Kind::Array:
+            ok = readVector(device, container.values, ARRAY_MAX) && container.values.size() == container.cardinality;
+            break;
+        case Kind::Bitmap:
+            ok = readVector(device, container.words, WORDS) && container.words.size() == WORDS;
+            break;
+        case Kind::Run:
+            ok = readVector(device, container.runs, CONTAINER_BITS / 2);
+            break;
+        default:
+            break;
+        }
+        if (!ok) return false;
+        container.kind = static_cast<Kind>(kind);
+        if (!container.isValid()) return false;
+        if (container.cardinality == CONTAINER_BITS) {
+            container = Container::fromWords(container.key, std::vector<uint64_t>(WORDS, ~0ULL));
+        }
+    }
+    // 容器按key严格升序，查找依赖这一点
+    if (std::adjacent_find(containers.begin(), containers.end(), [](const Container& a, const Container& b) {
+            return a.key >= b.key;
+        }) != containers.end()) {
+        return false;
+    }
+    m_containers = std::move(containers);
+    m_lastIndex = 0;
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <QIODevice>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// 32位整数集合的压缩位图（Roaring）：按高16位分成容器，容器内按密度选择表示——
+// 稀疏时为有序数组（每个元素2字节），稠密时为8KB位图，连续区间多时为区间列表（每段4字节），
+// 写满的容器只记类型、不分配内容。整个/8全部探测过时只需256个满容器，成功地址稀疏分布时以数组保存；
+// 集合运算逐个容器进行
+class RoaringBitmap
+{
+public:
+    void add(uint32_t value);
+    void addRange(uint32_t first, uint32_t last); // 闭区间
+    bool contains(uint32_t value) const;
+    uint64_t cardinality() const;
+    bool isEmpty() const { return m_containers.empty(); }
+    std::size_t memoryBytes() const;
+
+    // 把每个容器换成占用最小的表示；逐个添加时只在数组与位图之间转换，保存前调用
+    void optimize();
+
+    RoaringBitmap operator|(const RoaringBitmap& other) const;
+    RoaringBitmap operator&(const RoaringBitmap& other) const;
+    RoaringBitmap operator-(const RoaringBitmap& other) const; // 差集
+
+    // 按升序遍历极大的连续区间[first, last]，跨容器的区间会合并
+    void forEachRange(const std::function<void(uint32_t first, uint32_t last)>& visit) const;
+
+    // 二进制读写（本机字节序），read失败时内容不变
+    bool write(QIODevice& device) const;
+    bool read(QIODevice& device);
+
+private:
+    enum class Kind : uint8_t {
+        Array = 0,
+        Bitmap = 1,
+        Run = 2,
+        Full = 3 // 只在内存中使用，写入文件时为覆盖整个容器的一个区间
+    };
+    static constexpr std::size_t WORDS = 1024;         // 位图容器的64位字数（65536位）
+    static constexpr uint32_t ARRAY_MAX = 4096;        // 数组容器的元素上限，超过时位图更小
+
+    struct Container {
+        uint16_t key = 0;        // 高16位
+        Kind kind = Kind::Array;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> values;                       // Array：升序
+        std::vector<uint64_t> words;                        // Bitmap：WORDS个字
+        std::vector<std::pair<uint16_t, uint16_t>> runs;    // Run：(起点, 长度-1)，升序且不相邻
+
+        void toWords(std::vector<uint64_t>& out) const;
+        // 由位图内容选择最小的表示
+        static Container fromWords(uint16_t key, const std::vector<uint64_t>& bits);
+        std::size_t memoryBytes() const;
+        // 读入的内容是否满足上述约定：非空、数组严格升序、位图基数一致、区间不越界且升序不相邻
+        bool isValid() const;
+    };
+    using WordOp = uint64_t (*)(uint64_t, uint64_t);
+
+    Container* findOrCreate(uint16_t key);
+    const Container* find(uint16_t key) const;
+    // 逐容器合并，keepLeft/keepRight表示只在一侧出现的容器是否保留
+    RoaringBitmap combine(const RoaringBitmap& other, WordOp op, bool keepLeft, bool keepRight) const;
+
+    std::vector<Container> m_containers; // 按key升序，不含空容器
+    std::size_t m_lastIndex = 0;         // 最近一次add的容器，扫描多为顺序写入
+};
+
+#endif // ROARINGBITMAP_H
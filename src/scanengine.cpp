@@ -0,0 +1,806 @@
+#include "scanengine.h"
+#include "cidrexpander.h"
+#include "iputils.h"
+#include "eventlog.h"
+#include "metrics.h"
+#include "httptrace.h"
+#include "tlsprobe.h"
+#include "socketfactory.h"
+#include "sockaddrbatch.h"
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <future>
+
+thread_local ScanEngine::WorkerContext* ScanEngine::s_currentWorker = nullptr;
+
+namespace {
+
+constexpr std::size_t ENDPOINT_BATCH = 64; // 每次批量生成的套接字地址数，与地址段大小相同
+
+// 由批量生成的sockaddr直接填写端点，不再逐个经过ip::address构造
+template <typename SockAddr>
+void assignEndpoints(const SockAddr* addresses, boost::asio::ip::tcp::endpoint* out, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        std::memcpy(out[i].data(), &addresses[i], sizeof(SockAddr));
+        out[i].resize(sizeof(SockAddr));
+    }
+}
+
+void fillEndpoints(const AddressRange<IPv4Family>& range, uint16_t port, boost::asio::ip::tcp::endpoint* out)
+{
+    sockaddr_in addresses[ENDPOINT_BATCH];
+    SockaddrBatch::fillV4(range.first, range.stride, port, addresses, range.count);
+    assignEndpoints(addresses, out, range.count);
+}
+
+void fillEndpoints(const AddressRange<IPv6Family>& range, uint16_t port, boost::asio::ip::tcp::endpoint* out)
+{
+    sockaddr_in6 addresses[ENDPOINT_BATCH];
+    SockaddrBatch::fillV6(range.first, range.stride, port, addresses, range.count);
+    assignEndpoints(addresses, out, range.count);
+}
+
+} // namespace
+
+ScanJob::ScanJob(uint64_t id, ScanJobSpec spec, ScanJobSinks sinks)
+    : m_id(id)
+    , m_spec(std::move(spec))
+    , m_sinks(std::move(sinks))
+    , m_expander(std::make_unique<CidrExpander>())
+{
+}
+
+// 阻塞直到任务结束
+void ScanJob::wait()
+{
+    std::unique_lock<std::mutex> lock(m_doneMutex);
+    m_doneCondition.wait(lock, [this]() { return m_done; });
+}
+
+// 已调度的地址先更新、再预留槽位，先读进行中数再读已调度数，推出的完成数不会为负；
+// 已结束但工作线程尚未归还的探测仍算进行中，完成数最多滞后每个线程一批。取消时未展开的地址段也计为结束
+uint64_t ScanJob::completedCount() const
+{
+    const int64_t inFlight = m_inFlight.load(std::memory_order_acquire);
+    const uint64_t dispatchedProbes = m_dispatched.load(std::memory_order_acquire) * m_spec.ports.size();
+    return dispatchedProbes - std::min<uint64_t>(dispatchedProbes, static_cast<uint64_t>(std::max<int64_t>(inFlight, 0)));
+}
+
+// 地址数按已结束的探测折算，剩余时间按剩余探测数与当前速率估计
+ScanJobStats ScanJob::stats() const
+{
+    const uint64_t portCount = m_spec.ports.size();
+    ScanJobStats stats;
+    stats.total = totalCount();
+    stats.inFlight = m_inFlight.load(std::memory_order_relaxed);
+    uint64_t completedProbes = completedCount();
+    stats.dispatched = dispatchedCount();
+    stats.completed = completedProbes / portCount;
+    stats.probesPerSecond = m_probeRate.load(std::memory_order_relaxed);
+    stats.stoppedEarly = isStoppedEarly();
+    uint64_t totalProbes = std::max(stats.total, stats.dispatched) * portCount;
+    if (completedProbes >= totalProbes) {
+        stats.etaSeconds = 0.0;
+    } else if (stats.probesPerSecond > 0.0) {
+        stats.etaSeconds = static_cast<double>(totalProbes - completedProbes) / stats.probesPerSecond;
+    }
+    return stats;
+}
+
+// 启动工作线程，每个线程运行自己的io_context，work guard保持到引擎析构。
+// 绑定CPU时线程先绑定再创建自己的WorkerContext：io_context、探测列表以及之后的TLS会话池、
+// 指标分片都由绑定后的线程首次写入，按内核的首次访问策略分配在该线程所在节点的内存上
+ScanEngine::ScanEngine(int threadCount, const ThreadPlacement& placement)
+    : m_placement(placement)
+{
+    // 每个进行中的探测占用一个描述符，默认软限制（常见为1024）远低于常用并发
+    SocketFactory::raiseFileLimit();
+
+    const int count = std::max(1, threadCount);
+    const CpuTopology& topology = CpuTopology::system();
+    m_assignment = m_placement.assign(count, topology);
+    m_otherCpus = ThreadPlacement::remainder(m_assignment, topology);
+
+    for (int i = 0; i < count; ++i) {
+        std::vector<int> cpus = m_assignment.empty() ? std::vector<int>() : m_assignment[i];
+        std::promise<WorkerContext*> ready;
+        std::future<WorkerContext*> created = ready.get_future();
+        std::thread thread([this, i, ready = std::move(ready), cpus]() mutable {
+            bool bound = !cpus.empty() && ThreadPlacement::bindCurrentThread(cpus);
+            WorkerContext* context = new WorkerContext();
+            context->bound = bound;
+            context->engine = this;
+            context->index = static_cast<std::size_t>(i);
+            s_currentWorker = context;
+            context->workGuard.emplace(context->ioContext.get_executor());
+            ready.set_value(context); // 所有权交给引擎，线程在引擎析构时先于它结束
+            // work guard释放且所有探测结束后run_for返回并进入stopped状态
+            while (!context->ioContext.stopped()) {
+                try {
+                    // 分片运行，定期采样线程CPU时间用于计算利用率
+                    context->ioContext.run_for(std::chrono::milliseconds(WORKER_SAMPLE_INTERVAL_MS));
+                    MetricsRegistry::updateWorkerCpuTime();
+                } catch (const std::exception&) {
+                    // 探测协程自行处理异常，这里只保证线程不退出
+                }
+            }
+        });
+        m_workers.emplace_back(created.get());
+        m_workers.back()->thread = std::move(thread);
+    }
+}
+
+QString ScanEngine::placementReport() const
+{
+    const CpuTopology& topology = CpuTopology::system();
+    QStringList lines;
+    lines << QString("CPU拓扑：%1").arg(topology.summary());
+    if (!m_placement.isActive()) {
+        lines << QString("工作线程：%1 个，未绑定CPU").arg(m_workers.size());
+        return lines.join("\n");
+    }
+    if (m_assignment.empty()) {
+        lines << QString("CPU绑定 %1 未生效：没有匹配的可用CPU或本平台不支持").arg(m_placement.toString());
+        return lines.join("\n");
+    }
+
+    QStringList workers;
+    int unbound = 0;
+    for (std::size_t i = 0; i < m_workers.size(); ++i) {
+        QString cpus = ThreadPlacement::formatCpuList(m_assignment[i]);
+        const CpuInfo* info = m_assignment[i].size() == 1 ? topology.find(m_assignment[i].front()) : nullptr;
+        workers << (info ? QString("#%1→CPU%2(node%3)").arg(i).arg(cpus).arg(info->node)
+                         : QString("#%1→%2").arg(i).arg(cpus));
+        if (!m_workers[i]->bound) ++unbound;
+    }
+    lines << QString("工作线程绑定（%1）：%2").arg(m_placement.toString(), workers.join(" "));
+    if (unbound > 0) {
+        lines << QString("%1 个工作线程绑定失败，由内核调度").arg(unbound);
+    }
+    lines << (m_otherCpus.empty() ? QString("界面与日志线程：工作线程占用了全部CPU，不限制")
+                                  : QString("界面与日志线程：CPU %1").arg(ThreadPlacement::formatCpuList(m_otherCpus)));
+    return lines.join("\n");
+}
+
+// 取消全部任务，释放work guard并等待线程退出（不分离线程）
+ScanEngine::~ScanEngine()
+{
+    cancelAll();
+    for (auto& worker : m_workers) {
+        worker->workGuard.reset();
+    }
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+std::size_t ScanEngine::activeJobCount() const
+{
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    return m_jobs.size();
+}
+
+// 提交任务并开始第一轮调度
+std::shared_ptr<ScanJob> ScanEngine::submit(ScanJobSpec spec, ScanJobSinks sinks)
+{
+    if (spec.ports.empty()) {
+        spec.ports.push_back(80);
+    }
+    std::shared_ptr<ScanJob> job(new ScanJob(m_nextJobId.fetch_add(1), std::move(spec), std::move(sinks)));
+    job->m_expander->setShard(job->m_spec.shard);
+    job->m_expander->setPrior(job->m_spec.prior);
+    if (job->m_spec.cidrFile) {
+        job->m_expander->setSource(job->m_spec.cidrFile);
+    } else {
+        job->m_expander->setCidrRanges(job->m_spec.cidrRanges);
+    }
+    job->m_total = job->m_expander->getTotalIPCount();
+    if (job->m_spec.probeType == ProbeType::Http) {
+        job->m_httpRequest = HttpTrace::buildRequest(job->m_spec.hostName.toStdString());
+    } else if (job->m_spec.probeType == ProbeType::Tls) {
+        // SNI只能是主机名，填写IP地址时不发送
+        std::string serverName = job->m_spec.hostName.toStdString();
+        boost::system::error_code ec;
+        boost::asio::ip::make_address(serverName, ec);
+        if (ec) job->m_serverName = std::move(serverName);
+    }
+    if (!job->m_spec.loopbackTarget.isEmpty()) {
+        boost::system::error_code ec;
+        auto target = boost::asio::ip::make_address(job->m_spec.loopbackTarget.trimmed().toStdString(), ec);
+        job->m_loopbackTarget = !ec && target.is_loopback() ? target : boost::asio::ip::address(boost::asio::ip::address_v4::loopback());
+        job->m_redirected = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        if (job->m_spec.probeType == ProbeType::Tls && !m_tlsContext) {
+            m_tlsContext = TlsProbe::createClientContext();
+        }
+        m_jobs.push_back(job);
+    }
+    uint64_t total = job->totalCount();
+    MetricsRegistry::instance().setQueueDepth(m_queueDepth.fetch_add(total) + total);
+
+    pump(job);
+    if (job->m_sinks.onProgress) {
+        boost::asio::co_spawn(m_workers.front()->ioContext, reportStats(job),
+                              [](std::exception_ptr) {});
+    }
+    return job;
+}
+
+// 取消任务：取消信号只能在所属io_context的线程上触发，投递在已排队的探测之后执行，
+// 连接与超时定时器立即以operation_aborted完成，套接字随协程一起关闭
+void ScanEngine::cancel(const std::shared_ptr<ScanJob>& job)
+{
+    if (!job || job->m_cancelled.exchange(true)) return;
+
+    for (auto& worker : m_workers) {
+        WorkerContext* context = worker.get();
+        const ScanJob* target = job.get();
+        boost::asio::post(context->ioContext, [context, target]() {
+            for (auto& probe : context->probes) {
+                if (probe.job == target) {
+                    #undef emit
+                    probe.signal.emit(boost::asio::cancellation_type::all);
+                    #define emit Q_EMIT
+                }
+            }
+        });
+    }
+
+    // 加锁与调度线程同步，此后不会再有新的探测
+    {
+        std::lock_guard<std::mutex> lock(job->m_feedMutex);
+    }
+    if (job->m_inFlight.load() == 0) {
+        finishJob(job);
+    }
+}
+
+void ScanEngine::cancelAll()
+{
+    std::vector<std::shared_ptr<ScanJob>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        jobs = m_jobs;
+    }
+    for (const auto& job : jobs) {
+        cancel(job);
+    }
+    for (const auto& job : jobs) {
+        job->wait();
+    }
+}
+
+// 补充调度：在并发上限内从扫描计划领取地址段，并发槽位在领取时预留。
+// 调度锁内只移动计划的游标，地址的展开与探测的创建由工作线程各自完成：
+// 在工作线程上调度时放入本线程的队列，其余情况轮转放入；空闲的工作线程从其他线程的队列窃取
+void ScanEngine::pump(const std::shared_ptr<ScanJob>& job)
+{
+    // 每个地址占用与端口数相同的并发槽位；并发上限小于端口数时按端口数计，避免永远调度不出去
+    const int64_t portCount = static_cast<int64_t>(job->m_spec.ports.size());
+    const int64_t concurrencyLimit = std::max<int64_t>(job->m_spec.maxConcurrentTasks, portCount);
+    const auto queuedAt = std::chrono::steady_clock::now();
+    std::vector<PendingChunk> claimed;
+    int64_t reserved = 0;
+
+    std::unique_lock<std::mutex> lock(job->m_feedMutex);
+    while (!job->isCancelled() && job->m_expander->hasMore()) {
+        int64_t availableAddresses = (concurrencyLimit - job->m_inFlight.load() - reserved) / portCount;
+        if (availableAddresses <= 0) break;
+
+        ScanChunk chunk;
+        if (!job->m_expander->takeChunk(static_cast<uint64_t>(std::min(availableAddresses, CHUNK_SIZE)), chunk)) {
+            break;
+        }
+        reserved += static_cast<int64_t>(chunk.count) * portCount;
+        claimed.push_back(PendingChunk{job, chunk, queuedAt});
+    }
+    if (!claimed.empty()) {
+        uint64_t dispatched = job->m_expander->getProcessedIPCount();
+        // 文件输入的总数随解析与后台统计增长，增量先计入队列深度
+        uint64_t total = std::max(job->m_expander->getTotalIPCount(), dispatched);
+        uint64_t previousTotal = job->m_total.exchange(total);
+        if (total > previousTotal) {
+            m_queueDepth.fetch_add(total - previousTotal);
+        }
+        // 先更新已调度数再预留槽位，completedCount由两者推出
+        uint64_t newlyDispatched = dispatched - job->m_dispatched.exchange(dispatched, std::memory_order_release);
+        job->m_inFlight.fetch_add(reserved, std::memory_order_release);
+        MetricsRegistry::instance().setQueueDepth(m_queueDepth.fetch_sub(newlyDispatched) - newlyDispatched);
+    }
+    if (!job->m_expander->hasMore()) {
+        job->m_exhausted = true;
+    }
+    lock.unlock();
+
+    if (!claimed.empty()) {
+        WorkerContext* home = s_currentWorker && s_currentWorker->engine == this ? s_currentWorker : nullptr;
+        for (PendingChunk& pending : claimed) {
+            WorkerContext* context = home ? home
+                : m_workers[m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size()].get();
+            std::lock_guard<std::mutex> chunkLock(context->chunkMutex);
+            context->chunks.push_back(std::move(pending));
+        }
+        wakeWorkers();
+    }
+
+    bool done = job->m_exhausted.load() || job->isCancelled();
+    if (done && job->m_inFlight.load() == 0) {
+        finishJob(job);
+    }
+}
+
+void ScanEngine::wakeWorkers()
+{
+    for (auto& worker : m_workers) {
+        WorkerContext* context = worker.get();
+        if (!context->draining.exchange(true)) {
+            boost::asio::post(context->ioContext, [this, context]() { drainChunks(context); });
+        }
+    }
+}
+
+// 每次只展开一段，之后重新投递自己，让已完成探测的回调与新探测交替执行；
+// 事件队列长的线程处理得晚，空闲的线程先运行并窃取它队列中的地址段
+void ScanEngine::drainChunks(WorkerContext* context)
+{
+    PendingChunk pending;
+    while (!takePending(context, pending)) {
+        context->draining.store(false);
+        // 清除标志后再查一次：入队的线程可能恰好在清除前看到标志而没有投递
+        if (!hasPending() || context->draining.exchange(true)) return;
+    }
+
+    const std::shared_ptr<ScanJob>& job = pending.job;
+    const int64_t portCount = static_cast<int64_t>(job->m_spec.ports.size());
+    if (job->isCancelled()) {
+        // 取消后不再展开，归还预留的槽位
+        int64_t reserved = static_cast<int64_t>(pending.chunk.count) * portCount;
+        if (job->m_inFlight.fetch_sub(reserved) == reserved) {
+            finishJob(job);
+        }
+    } else {
+        // 整段按地址族分派一次，逐个地址只做整数加法；首个端口的套接字地址按批生成，不经过字符串解析
+        MetricsRegistry::addInFlight(static_cast<int64_t>(pending.chunk.count) * portCount);
+        context->tallies[job.get()].running += static_cast<int64_t>(pending.chunk.count) * portCount;
+        visitFamily(pending.chunk.first.type, [&](auto family) {
+            using Family = decltype(family);
+            const AddressRange<Family> range{Family::fromAddress(pending.chunk.first), pending.chunk.count,
+                                             pending.chunk.stride};
+            boost::asio::ip::tcp::endpoint endpoints[ENDPOINT_BATCH];
+            for (uint64_t done = 0; done < range.count; done += ENDPOINT_BATCH) {
+                const AddressRange<Family> block{range.at(done), std::min<uint64_t>(ENDPOINT_BATCH, range.count - done),
+                                                 range.stride};
+                if (job->m_redirected) {
+                    std::fill_n(endpoints, block.count,
+                                boost::asio::ip::tcp::endpoint(job->m_loopbackTarget, job->m_spec.ports.front()));
+                } else {
+                    fillEndpoints(block, job->m_spec.ports.front(), endpoints);
+                }
+                std::size_t i = 0;
+                for (auto value : block) {
+                    startProbes(job, context, endpoints[i++], Family::toString(value), pending.queuedAt);
+                }
+            }
+        });
+    }
+    boost::asio::post(context->ioContext, [this, context]() { drainChunks(context); });
+}
+
+bool ScanEngine::takePending(WorkerContext* context, PendingChunk& pending)
+{
+    {
+        std::lock_guard<std::mutex> lock(context->chunkMutex);
+        if (!context->chunks.empty()) {
+            pending = std::move(context->chunks.front());
+            context->chunks.pop_front();
+            return true;
+        }
+    }
+    // 从下一个线程开始轮流查看，避免所有空闲线程都去窃取同一个线程
+    for (std::size_t offset = 1; offset < m_workers.size(); ++offset) {
+        WorkerContext* victim = m_workers[(context->index + offset) % m_workers.size()].get();
+        std::lock_guard<std::mutex> lock(victim->chunkMutex);
+        if (!victim->chunks.empty()) {
+            pending = std::move(victim->chunks.back());
+            victim->chunks.pop_back();
+            MetricsRegistry::increment(Metric::ChunksStolen);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScanEngine::hasPending()
+{
+    for (auto& worker : m_workers) {
+        std::lock_guard<std::mutex> lock(worker->chunkMutex);
+        if (!worker->chunks.empty()) return true;
+    }
+    return false;
+}
+
+// 在当前工作线程上为每个端口创建取消信号并启动探测协程，信号在协程结束后的下一轮事件中释放；
+// 同一地址的各端口交错进行，而不是逐端口重复整轮扫描
+void ScanEngine::startProbes(const std::shared_ptr<ScanJob>& job, WorkerContext* context,
+                             const boost::asio::ip::tcp::endpoint& endpoint, const QString& ip,
+                             std::chrono::steady_clock::time_point queuedAt)
+{
+    const std::size_t portCount = job->m_spec.ports.size();
+    std::shared_ptr<AddressGroup> group;
+    if (portCount > 1) {
+        group = std::make_shared<AddressGroup>();
+        group->result.ip = ip;
+        group->result.port = job->m_spec.ports.front();
+        group->result.portLatencyMs.fill(-1.0, static_cast<int>(portCount));
+        group->remaining = portCount;
+    }
+
+    for (std::size_t portIndex = 0; portIndex < portCount; ++portIndex) {
+        auto slot = context->probes.emplace(context->probes.end());
+        slot->job = job.get();
+        // 任务在排队期间被取消时，取消投递可能早于本探测创建，此时信号上还没有处理器；
+        // 这种情况由probe开头对isCancelled的检查处理
+        boost::asio::co_spawn(context->ioContext,
+                              probe(job, context, endpoint, portIndex, ip, group, queuedAt),
+                              boost::asio::bind_cancellation_slot(slot->signal.slot(),
+                                  [this, context, slot, job](std::exception_ptr) {
+                                      // 完成回调执行时信号仍被引用，延后释放
+                                      boost::asio::post(context->ioContext, [context, slot]() {
+                                          context->probes.erase(slot);
+                                      });
+                                      probeFinished(job, context);
+                                  }));
+    }
+}
+
+// 汇总规则：任一端口成功即成功，延迟与分段耗时取延迟最低的成功端口；全部失败时保留最后一个失败结果
+void ScanEngine::reportResult(const std::shared_ptr<ScanJob>& job, AddressGroup* group, std::size_t portIndex,
+                              ProbeResult result)
+{
+    result.port = job->m_spec.ports[portIndex];
+    if (!group) {
+        deliverResult(job, result);
+        return;
+    }
+
+    ProbeResult& merged = group->result;
+    merged.portLatencyMs[static_cast<int>(portIndex)] = result.success ? result.latencyMs : -1.0;
+    if (result.success ? !merged.success || result.latencyMs < merged.latencyMs : !merged.success) {
+        result.portLatencyMs = std::move(merged.portLatencyMs);
+        merged = std::move(result);
+    }
+    if (--group->remaining == 0 && !job->isCancelled()) {
+        deliverResult(job, merged);
+    }
+}
+
+void ScanEngine::deliverResult(const std::shared_ptr<ScanJob>& job, const ProbeResult& result)
+{
+    job->m_sinks.onResult(result);
+
+    const ScanJobSpec& spec = job->m_spec;
+    if (spec.stopAfterSuccesses == 0 || !result.success) return;
+    if (spec.stopMaxLatencyMs > 0.0 && result.latencyMs > spec.stopMaxLatencyMs) return;
+    if (job->m_qualified.fetch_add(1) + 1 == spec.stopAfterSuccesses) {
+        job->m_stoppedEarly = true;
+        cancel(job);
+    }
+}
+
+// 探测结束：结束数先记在本线程，攒够一小批空位（至少够一个地址的全部端口）才归还给任务并尝试调度，
+// 各线程不必每个探测都修改任务的共享计数。本线程上该任务的探测全部结束时归还余数，
+// 任务的m_inFlight因此一定会归零；归还后降到补充阈值以下时继续调度，归零且不再调度时完成任务
+void ScanEngine::probeFinished(const std::shared_ptr<ScanJob>& job, WorkerContext* context)
+{
+    const int64_t portCount = static_cast<int64_t>(job->m_spec.ports.size());
+    const int64_t concurrencyLimit = std::max<int64_t>(job->m_spec.maxConcurrentTasks, portCount);
+    const int64_t refillStep = std::max(portCount, std::clamp<int64_t>(concurrencyLimit / 8, 1, 64));
+
+    auto tally = context->tallies.find(job.get());
+    --tally->second.running;
+    ++tally->second.finished;
+    if (tally->second.running > 0 && tally->second.finished < refillStep) return;
+
+    const int64_t released = tally->second.finished;
+    if (tally->second.running == 0) {
+        context->tallies.erase(tally);
+    } else {
+        tally->second.finished = 0;
+    }
+    int64_t remaining = job->m_inFlight.fetch_sub(released, std::memory_order_acq_rel) - released;
+
+    if (job->m_exhausted.load() || job->isCancelled()) {
+        if (remaining == 0) {
+            finishJob(job);
+        }
+        return;
+    }
+    if (remaining <= concurrencyLimit - refillStep) {
+        pump(job);
+    }
+}
+
+// 完成任务，只执行一次
+void ScanEngine::finishJob(const std::shared_ptr<ScanJob>& job)
+{
+    if (job->m_finished.exchange(true, std::memory_order_acq_rel)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        m_jobs.erase(std::remove(m_jobs.begin(), m_jobs.end(), job), m_jobs.end());
+    }
+    // 取消后未调度的地址不再计入队列深度
+    uint64_t total = job->totalCount();
+    uint64_t undispatched = total - std::min(total, job->m_dispatched.load());
+    MetricsRegistry::instance().setQueueDepth(m_queueDepth.fetch_sub(undispatched) - undispatched);
+
+    if (job->m_sinks.onProgress) {
+        ScanJobStats stats = job->stats();
+        stats.final = true;
+        job->m_sinks.onProgress(stats);
+    }
+    if (job->m_sinks.onFinished) {
+        job->m_sinks.onFinished(job->isCancelled() && !job->isStoppedEarly());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(job->m_doneMutex);
+        job->m_done = true;
+    }
+    job->m_doneCondition.notify_all();
+}
+
+// 速率取每个间隔内的完成数，用按实际间隔计算权重的EWMA平滑：间隔抖动不影响时间常数，
+// 启动阶段的低速样本在几个时间常数后即被淘汰；第一个非零样本直接作为初值
+boost::asio::awaitable<void> ScanEngine::reportStats(std::shared_ptr<ScanJob> job)
+{
+    boost::asio::steady_timer timer(co_await boost::asio::this_coro::executor);
+    auto lastSample = std::chrono::steady_clock::now();
+    uint64_t lastCompleted = job->completedCount();
+    bool primed = false;
+
+    while (!job->isFinished()) {
+        timer.expires_after(std::chrono::milliseconds(PROGRESS_INTERVAL_MS));
+        auto [ec] = co_await timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (ec || job->isFinished()) break;
+
+        auto now = std::chrono::steady_clock::now();
+        double interval = std::chrono::duration<double>(now - lastSample).count();
+        // 推出的完成数在调度与归还交错时可能短暂回退，按不减处理
+        uint64_t completed = std::max(job->completedCount(), lastCompleted);
+        if (interval > 0.0) {
+            double sample = static_cast<double>(completed - lastCompleted) / interval;
+            double rate = job->m_probeRate.load(std::memory_order_relaxed);
+            if (primed) {
+                rate += (1.0 - std::exp(-interval / RATE_TIME_CONSTANT_S)) * (sample - rate);
+            } else if (sample > 0.0) {
+                rate = sample;
+                primed = true;
+            }
+            job->m_probeRate.store(rate, std::memory_order_relaxed);
+        }
+        lastSample = now;
+        lastCompleted = completed;
+
+        job->m_sinks.onProgress(job->stats());
+    }
+}
+
+// 单个IP的ping协程，负责连接并上报结果
+boost::asio::awaitable<void> ScanEngine::probe(std::shared_ptr<ScanJob> job, WorkerContext* context,
+                                               boost::asio::ip::tcp::endpoint endpoint, std::size_t portIndex,
+                                               QString originalIP, std::shared_ptr<AddressGroup> group,
+                                               std::chrono::steady_clock::time_point queuedAt)
+{
+    const uint16_t port = job->m_spec.ports[portIndex];
+
+    // 从投递到协程开始执行的调度延迟
+    MetricsRegistry::recordHandlerLatency(std::chrono::steady_clock::now() - queuedAt);
+
+    try {
+        // 早期检查停止状态：创建前已取消的探测收不到取消信号，只能在这里结束
+        if (job->isCancelled()) {
+            MetricsRegistry::addInFlight(-1);
+            co_return;
+        }
+        
+        auto executor = co_await boost::asio::this_coro::executor;
+        boost::asio::ip::tcp::socket socket(executor);
+        
+        auto start_time = std::chrono::steady_clock::now();
+        
+        // 端点由drainChunks按批生成（首个端口），多端口时换成本探测的端口
+        if (portIndex > 0) {
+            endpoint.port(port);
+        }
+       
+        boost::asio::steady_timer timer(executor);
+        timer.expires_after(std::chrono::milliseconds(std::min(job->m_spec.timeoutMs, MAX_PROBE_TIMEOUT_MS)));
+        
+        using namespace boost::asio::experimental::awaitable_operators;
+
+        try {
+            // 在连接前再次检查停止状态
+            if (job->isCancelled()) {
+                MetricsRegistry::addInFlight(-1);
+                co_return;
+            }
+           
+            // 打开失败（EMFILE等）按探测失败上报并计入错误码
+            if (boost::system::error_code open_ec = SocketFactory::open(socket, endpoint.protocol())) {
+                throw boost::system::system_error(open_ec);
+            }
+            MetricsRegistry::increment(Metric::ConnectAttempts);
+
+            // 并发等待连接或超时
+            auto variant_result = co_await (
+                socket.async_connect(endpoint, boost::asio::as_tuple(boost::asio::use_awaitable)) ||
+                timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable))
+            );
+            std::size_t which = variant_result.index();
+            boost::system::error_code ec2;
+            if (which == 0) {
+                ec2 = std::get<0>(std::get<0>(variant_result));
+            } else {
+                ec2 = std::get<0>(std::get<1>(variant_result));
+            }
+            auto end_time = std::chrono::steady_clock::now();
+            double latency = IPUtils::calculateLatency(start_time, end_time);
+            bool success = (which == 0 && !ec2);
+            
+            if (success) {
+                MetricsRegistry::increment(Metric::Connected);
+            } else if (which == 1) {
+                MetricsRegistry::increment(Metric::Timeouts);
+            } else {
+                MetricsRegistry::increment(ec2 == boost::asio::error::connection_refused ? Metric::Refused : Metric::Failed);
+                MetricsRegistry::recordError(SocketFactory::systemError(ec2));
+            }
+            
+            ProbeResult result;
+            result.ip = originalIP;
+            result.latencyMs = latency;
+            result.connectMs = latency;
+            result.success = success;
+            
+            // 内核RTT在握手时由内核打时间戳，与用户态计时之差即排队造成的测量偏差
+            if (success && job->m_spec.kernelRtt) {
+                result.kernelRttMs = SocketFactory::kernelRttMs(socket);
+                if (result.kernelRttMs >= 0.0) {
+                    MetricsRegistry::recordConnectBias(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double, std::milli>(latency - result.kernelRttMs)));
+                    if (job->m_spec.probeType == ProbeType::Tcp) {
+                        result.latencyMs = result.kernelRttMs;
+                    }
+                }
+            }
+            
+            // HTTP探测：握手成功后在同一个超时定时器内完成trace请求
+            if (success && job->m_spec.probeType == ProbeType::Http) {
+                auto http_result = co_await (
+                    HttpTrace::exchange(socket, job->m_httpRequest, start_time) ||
+                    timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable))
+                );
+                result.success = false;
+                if (http_result.index() == 0) {
+                    const HttpTraceResult& trace = std::get<0>(http_result);
+                    result.httpStatus = trace.status;
+                    result.ttfbMs = trace.ttfbMs;
+                    result.totalMs = trace.totalMs;
+                    result.colo = QString::fromLatin1(trace.colo.data());
+                    result.success = trace.status >= 200 && trace.status < 400;
+                    MetricsRegistry::recordError(trace.error, ErrorStage::Http);
+                }
+                result.latencyMs = result.ttfbMs;
+                MetricsRegistry::increment(result.success ? Metric::HttpOk : Metric::HttpFailed);
+            }
+            
+            // TLS探测：握手同样受同一个超时定时器约束，SSL对象取自本线程的对象池
+            int tls_error = 0;
+            if (success && job->m_spec.probeType == ProbeType::Tls) {
+                if (!context->tlsPool) {
+                    context->tlsPool = std::make_unique<TlsSessionPool>(*m_tlsContext);
+                }
+                TlsSessionLease session(*context->tlsPool);
+                auto tls_result = co_await (
+                    TlsProbe::handshake(socket, *session, job->m_serverName, start_time) ||
+                    timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable))
+                );
+                result.success = false;
+                tls_error = -1; // 超时
+                if (tls_result.index() == 0) {
+                    const TlsHandshakeResult& handshake = std::get<0>(tls_result);
+                    result.success = handshake.success;
+                    result.tlsMs = handshake.handshakeMs;
+                    // 日志中的错误码：系统错误优先，其次TLS原因码，都没有时记为协议错误
+                    tls_error = handshake.error != 0 ? handshake.error
+                              : handshake.tlsReason != 0 ? handshake.tlsReason : EPROTO;
+                    MetricsRegistry::recordError(handshake.error, ErrorStage::Tls);
+                }
+                result.latencyMs = result.tlsMs;
+                MetricsRegistry::increment(result.success ? Metric::TlsOk : Metric::TlsFailed);
+            }
+            
+            if (success) {
+                SocketFactory::close(socket, job->m_spec.abortiveClose);
+            }
+            
+            if (!job->isCancelled()) {
+                // 级别检查在前，关闭详细日志时不产生任何格式化开销
+                if (EventLog::enabled(LogLevel::Debug)) {
+                    LogEvent event = success ? LogEvent::ProbeConnected
+                                   : which == 1 ? LogEvent::ProbeTimeout
+                                   : ec2 == boost::asio::error::connection_refused ? LogEvent::ProbeRefused
+                                   : LogEvent::ProbeFailed;
+                    EventLog::instance().probe(LogLevel::Debug, event, endpoint.address(), port,
+                                               latency, which == 0 ? ec2.value() : 0);
+                    if (success && job->m_spec.probeType == ProbeType::Http) {
+                        EventLog::instance().probe(LogLevel::Debug, LogEvent::HttpTrace, endpoint.address(), port,
+                                                   result.ttfbMs, result.httpStatus);
+                    }
+                    if (success && job->m_spec.probeType == ProbeType::Tls) {
+                        EventLog::instance().probe(LogLevel::Debug, LogEvent::TlsHandshake, endpoint.address(), port,
+                                                   result.tlsMs, result.success ? 0 : tls_error);
+                    }
+                }
+                reportResult(job, group.get(), portIndex, std::move(result));
+            }
+            
+        } catch (const boost::system::system_error& e) {
+            if (job->isCancelled()) {
+                MetricsRegistry::addInFlight(-1);
+                co_return;
+            }
+            
+            auto end_time = std::chrono::steady_clock::now();
+            double latency = IPUtils::calculateLatency(start_time, end_time);
+            
+            bool isReachable = (e.code() == boost::asio::error::connection_refused);
+            MetricsRegistry::increment(isReachable ? Metric::Refused : Metric::Failed);
+            MetricsRegistry::recordError(SocketFactory::systemError(e.code()));
+            
+            // 忽略取消相关的错误
+            if (e.code() != boost::asio::error::operation_aborted) {
+                if (EventLog::enabled(LogLevel::Debug)) {
+                    EventLog::instance().probe(LogLevel::Debug,
+                                               isReachable ? LogEvent::ProbeRefused : LogEvent::ProbeFailed,
+                                               endpoint.address(), port, latency, e.code().value());
+                }
+                reportResult(job, group.get(), portIndex, ProbeResult{originalIP, latency, isReachable});
+            }
+        } catch (const std::exception& e) {
+            if (!job->isCancelled()) {
+                if (EventLog::enabled(LogLevel::Debug)) {
+                    EventLog::instance().probe(LogLevel::Debug, LogEvent::ProbeException,
+                                               endpoint.address(), port, 0.0);
+                }
+                reportResult(job, group.get(), portIndex, ProbeResult{originalIP, 0.0, false});
+            }
+        }
+        
+    } catch (const std::exception& e) {
+        if (!job->isCancelled()) {
+            if (EventLog::enabled(LogLevel::Debug)) {
+                EventLog::instance().probe(LogLevel::Debug, LogEvent::ProbeException,
+                                           endpoint.address(), port, 0.0);
+            }
+            reportResult(job, group.get(), portIndex, ProbeResult{originalIP, 0.0, false});
+        }
+    }
+    
+    MetricsRegistry::increment(Metric::Completed);
+    MetricsRegistry::addInFlight(-1);
+}
@@ -0,0 +1,265 @@
+#ifndef SCANENGINE_H
+#define SCANENGINE_H
+
+// boost必须先于Qt包含：Qt的emit宏会破坏cancellation_signal::emit的声明
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cidrexpander.h"
+#include "threadplacement.h"
+
+class CidrFileSource;
+class TlsSessionPool;
+namespace boost { namespace asio { namespace ssl { class context; } } }
+
+// 探测方式
+enum class ProbeType {
+    Tcp,   // 只测TCP握手
+    Http,  // 握手后请求/cdn-cgi/trace，测首字节时间并解析colo
+    Tls    // 握手后完成TLS 1.3握手，测握手完成时间
+};
+
+// 单次探测结果
+struct ProbeResult {
+    QString ip;              // 原始地址字符串
+    double latencyMs = 0.0;  // 用于排序的延迟（毫秒）：TCP为连接时间，HTTP为首字节时间，TLS为握手完成时间
+    bool success = false;    // 是否成功（HTTP要求状态码2xx/3xx，TLS要求握手完成）
+    double connectMs = 0.0;  // TCP连接时间（用户态计时，含调度与事件循环的排队）
+    double kernelRttMs = -1.0; // 内核测得的握手RTT（TCP_INFO），未启用或不可用时为-1
+    double ttfbMs = 0.0;     // 首字节时间（HTTP）
+    double totalMs = 0.0;    // 完整响应时间（HTTP）
+    double tlsMs = 0.0;      // 从连接开始到TLS握手完成（TLS）
+    int httpStatus = 0;      // HTTP状态码
+    QString colo;            // 应答机房（HTTP）
+    int port = 0;            // 结果对应的端口，多端口时为延迟最低的成功端口
+    QVector<double> portLatencyMs; // 多端口时按ScanJobSpec::ports顺序的各端口延迟，失败为-1；单端口时为空
+};
+Q_DECLARE_METATYPE(ProbeResult)
+
+// 扫描任务参数
+struct ScanJobSpec {
+    QStringList cidrRanges;          // 待扫描的CIDR列表
+    std::shared_ptr<CidrFileSource> cidrFile; // 非空时从映射的文件按需读取地址，忽略cidrRanges
+    int timeoutMs = 1000;            // 超时（整个探测共用）
+    int maxConcurrentTasks = 1000;   // 本任务的最大并发探测数
+    std::vector<uint16_t> ports{80}; // 目标端口；多个端口时每个地址展开为各端口的探测，结果按地址合并
+    ProbeType probeType = ProbeType::Tcp;
+    QString hostName = "cloudflare.com"; // HTTP探测的Host头与TLS探测的SNI
+    bool abortiveClose = false;      // 探测成功后以RST关闭（SO_LINGER 0），本端不留TIME_WAIT
+    bool kernelRtt = false;          // 连接成功后读取内核RTT；TCP探测以它排序，不随并发升高而偏大
+    ScanShard shard;                 // 多机分片，默认不分片；总数与进度均按本片计
+    std::shared_ptr<const ScanPrior> prior; // 先验（热启动），非空时历史上表现好的网段先扫描
+    uint64_t stopAfterSuccesses = 0; // 提前停止：得到这么多个合格结果后结束任务，0为不启用
+    double stopMaxLatencyMs = 0.0;   // 合格结果的延迟上限，0为不限
+    // 非空时所有连接改发到这个回环地址（端口不变），结果仍记为扫描的地址，用于在本机安全地演练
+    // 0.0.0.0/0这样的大范围扫描；不是合法的回环地址时按127.0.0.1处理，绝不会连接外部地址
+    QString loopbackTarget;
+};
+
+// 任务进度快照：完成数按探测结束计，而不是按调度计
+struct ScanJobStats {
+    uint64_t total = 0;           // 地址总数，文件输入时随解析增长
+    uint64_t dispatched = 0;      // 已调度的地址数
+    uint64_t completed = 0;       // 全部端口都已结束的地址数
+    int64_t inFlight = 0;         // 进行中的探测数
+    double probesPerSecond = 0.0; // 探测完成速率的指数加权移动平均
+    double etaSeconds = -1.0;     // 按当前速率估计的剩余时间，尚无速率时为-1
+    bool final = false;           // 任务结束前的最后一次快照
+    bool stoppedEarly = false;    // 已达到提前停止条件
+};
+Q_DECLARE_METATYPE(ScanJobStats)
+
+// 任务回调，均在引擎的工作线程（或调用submit/cancel的线程）中调用，不能阻塞；onResult必须设置
+struct ScanJobSinks {
+    std::function<void(const ProbeResult&)> onResult;       // 单个结果
+    std::function<void(const ScanJobStats&)> onProgress;    // 每PROGRESS_INTERVAL_MS一次，任务结束前再发布final快照
+    std::function<void(bool cancelled)> onFinished;         // 任务结束，只调用一次；提前停止不算取消
+};
+
+// 已提交的扫描任务，调用方用它查询进度、取消或等待结束
+class ScanJob
+{
+public:
+    uint64_t id() const { return m_id; }
+    uint64_t totalCount() const { return m_total.load(std::memory_order_relaxed); } // 地址数，文件输入时随解析增长
+    uint64_t dispatchedCount() const { return m_dispatched.load(std::memory_order_relaxed); } // 已调度的地址数
+    uint64_t completedCount() const; // 已结束的探测数（地址数×端口数），由已调度数与进行中数推出
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+    bool isStoppedEarly() const { return m_stoppedEarly.load(std::memory_order_relaxed); }
+    bool isFinished() const { return m_finished.load(std::memory_order_acquire); }
+    ScanJobStats stats() const; // 当前计数与最近一次速率估计
+
+    // 阻塞直到任务结束（onFinished已返回）
+    void wait();
+
+private:
+    friend class ScanEngine;
+    ScanJob(uint64_t id, ScanJobSpec spec, ScanJobSinks sinks);
+
+    const uint64_t m_id;
+    const ScanJobSpec m_spec;
+    const ScanJobSinks m_sinks;
+    std::atomic<uint64_t> m_total{0};          // 只在调度锁内增长
+    std::string m_httpRequest;                 // HTTP探测的请求报文，提交时构造一次
+    std::string m_serverName;                  // TLS探测的SNI，主机名为IP地址时为空
+    boost::asio::ip::address m_loopbackTarget; // 连接改发的回环地址，m_redirected为false时不用
+    bool m_redirected = false;
+
+    std::mutex m_feedMutex;                    // 保护地址生成器，同一时刻只有一个线程调度
+    std::unique_ptr<CidrExpander> m_expander;
+    std::atomic<bool> m_exhausted{false};      // 地址已全部调度
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<bool> m_stoppedEarly{false};   // 达到提前停止条件，随后以取消的方式结束
+    std::atomic<uint64_t> m_qualified{0};      // 满足提前停止条件的结果数
+    std::atomic<bool> m_finished{false};
+    // 本任务已预留、尚未归还的并发槽位（每个端口一个）；工作线程上结束的探测攒成一批再归还，
+    // 因此包含已结束但尚未归还的探测
+    std::atomic<int64_t> m_inFlight{0};
+    std::atomic<uint64_t> m_dispatched{0};     // 在调度锁内先于对应的m_inFlight增加而更新
+    std::atomic<double> m_probeRate{0.0};      // 只由统计协程写入
+
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCondition;
+    bool m_done = false;
+};
+
+// 常驻扫描引擎：工作线程与各自的io_context在任务之间保持运行，
+// 任务通过submit提交，可以同时运行多个并分别取消，结果通过各自的回调输出
+class ScanEngine
+{
+public:
+    // 同时提高进程的文件描述符限制；placement指定工作线程的CPU绑定，默认不绑定
+    explicit ScanEngine(int threadCount = 4, const ThreadPlacement& placement = ThreadPlacement());
+    ~ScanEngine(); // 取消全部任务并等待工作线程退出
+
+    ScanEngine(const ScanEngine&) = delete;
+    ScanEngine& operator=(const ScanEngine&) = delete;
+
+    int threadCount() const { return static_cast<int>(m_workers.size()); }
+    std::size_t activeJobCount() const;
+    const ThreadPlacement& placement() const { return m_placement; }
+    // 工作线程以外的CPU，界面与日志线程应限制在这里；未绑定或没有剩余CPU时为空（不限制）
+    const std::vector<int>& otherCpus() const { return m_otherCpus; }
+    // CPU拓扑与各工作线程的实际绑定，多行文本
+    QString placementReport() const;
+
+    // 提交任务，立即开始调度
+    std::shared_ptr<ScanJob> submit(ScanJobSpec spec, ScanJobSinks sinks);
+    // 取消任务：停止调度并立即取消其全部进行中的探测
+    void cancel(const std::shared_ptr<ScanJob>& job);
+    void cancelAll();
+
+    static constexpr int MAX_PROBE_TIMEOUT_MS = 2000; // 单个探测（含HTTP/TLS阶段）的超时上限，更大的设置按此截断
+
+private:
+    // 进行中探测的取消信号，只在所属工作线程上创建、触发和释放
+    struct ProbeSlot {
+        boost::asio::cancellation_signal signal;
+        const ScanJob* job = nullptr;
+    };
+
+    // 多端口时一个地址的汇总结果；同一地址的各端口探测在同一工作线程上运行，无需加锁
+    struct AddressGroup {
+        ProbeResult result;
+        std::size_t remaining = 0; // 尚未结束的端口探测
+    };
+
+    // 已领取、尚未展开的一段地址，并发槽位在领取时已预留
+    struct PendingChunk {
+        std::shared_ptr<ScanJob> job;
+        ScanChunk chunk;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    // 一个任务在某工作线程上的探测计数，只由该线程访问
+    struct JobTally {
+        int64_t running = 0;  // 已在本线程启动、尚未结束的探测
+        int64_t finished = 0; // 已结束、尚未从任务的m_inFlight中扣除的探测
+    };
+
+    // 每个工作线程独占一个io_context，停止时无需跨线程同步即可取消全部探测
+    struct WorkerContext {
+        std::unique_ptr<TlsSessionPool> tlsPool; // 首次TLS探测时创建；须晚于ioContext析构，协程销毁时会归还对象
+        boost::asio::io_context ioContext{1}; // 单线程运行，省去内部锁
+        std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> workGuard;
+        std::list<ProbeSlot> probes;
+        std::unordered_map<const ScanJob*, JobTally> tallies; // 本线程上有探测在运行的任务
+        std::thread thread;
+        bool bound = false; // 已按placement绑定CPU
+        const ScanEngine* engine = nullptr;
+        std::size_t index = 0;             // 在m_workers中的位置
+
+        std::mutex chunkMutex;             // 保护chunks，其他线程窃取时也要加锁
+        std::deque<PendingChunk> chunks;   // 本线程从队首取，其他线程从队尾窃取
+        std::atomic<bool> draining{false}; // 已投递drainChunks，避免重复投递
+    };
+
+    // 补充调度：在并发上限内从扫描计划领取地址段并放入工作线程的队列
+    void pump(const std::shared_ptr<ScanJob>& job);
+    // 唤醒尚未在处理地址段的工作线程
+    void wakeWorkers();
+    // 在工作线程上运行：展开自己队列（为空时窃取其他线程）的下一段，有剩余时重新投递自己
+    void drainChunks(WorkerContext* context);
+    // 取出context自己队列的队首，为空时从其他线程的队尾窃取
+    bool takePending(WorkerContext* context, PendingChunk& pending);
+    bool hasPending();
+    // 在context的线程上为一个地址的全部端口启动探测，endpoint为首个端口
+    void startProbes(const std::shared_ptr<ScanJob>& job, WorkerContext* context,
+                     const boost::asio::ip::tcp::endpoint& endpoint, const QString& ip,
+                     std::chrono::steady_clock::time_point queuedAt);
+    // 上报单个端口的结果；多端口时并入地址的汇总结果，最后一个端口结束时输出
+    void reportResult(const std::shared_ptr<ScanJob>& job, AddressGroup* group, std::size_t portIndex,
+                      ProbeResult result);
+    // 输出一个地址的最终结果，合格结果达到提前停止数量时取消任务
+    void deliverResult(const std::shared_ptr<ScanJob>& job, const ProbeResult& result);
+    // 在context的线程上记录一个探测结束，攒够一批或本线程上该任务的探测全部结束时才归还槽位
+    void probeFinished(const std::shared_ptr<ScanJob>& job, WorkerContext* context);
+    void finishJob(const std::shared_ptr<ScanJob>& job);
+    // 协程：按固定间隔更新速率估计并发布进度快照，任务结束后退出
+    boost::asio::awaitable<void> reportStats(std::shared_ptr<ScanJob> job);
+
+    // 协程：对单个IP的一个端口进行测试，context为运行它的工作线程，group在单端口时为空；
+    // endpoint为首个端口的端点，其他端口在协程内改写端口号
+    boost::asio::awaitable<void> probe(std::shared_ptr<ScanJob> job, WorkerContext* context,
+                                       boost::asio::ip::tcp::endpoint endpoint, std::size_t portIndex,
+                                       QString originalIP, std::shared_ptr<AddressGroup> group,
+                                       std::chrono::steady_clock::time_point queuedAt);
+
+    std::unique_ptr<boost::asio::ssl::context> m_tlsContext; // 所有TLS探测共享，首个TLS任务提交时创建
+    std::vector<std::unique_ptr<WorkerContext>> m_workers;
+    ThreadPlacement m_placement;
+    std::vector<std::vector<int>> m_assignment; // 各工作线程允许运行的CPU，不绑定时为空
+    std::vector<int> m_otherCpus;
+    std::atomic<std::size_t> m_nextWorker{0}; // 不在工作线程上调度时，轮转放入地址段的下一个工作线程
+    static thread_local WorkerContext* s_currentWorker; // 当前线程所属的工作线程，非工作线程为空
+
+    mutable std::mutex m_jobsMutex;
+    std::vector<std::shared_ptr<ScanJob>> m_jobs; // 运行中的任务
+    std::atomic<uint64_t> m_nextJobId{1};
+    std::atomic<uint64_t> m_queueDepth{0};        // 所有任务待调度地址数之和
+
+    static constexpr int64_t CHUNK_SIZE = 64; // 每段最多的地址数：足够摊薄加锁，又能让空闲线程及时窃取
+    static constexpr int WORKER_SAMPLE_INTERVAL_MS = 100; // 工作线程CPU时间采样间隔
+    static constexpr int PROGRESS_INTERVAL_MS = 250;      // 进度快照的发布间隔
+    static constexpr double RATE_TIME_CONSTANT_S = 5.0;   // 速率EWMA的时间常数，约为此时长内的平均
+};
+
+#endif // SCANENGINE_H
@@ -0,0 +1,118 @@
+#include "scanoutcome.h"
+#include "iputils.h"
+#include <QFile>
+#include <bit>
+
+bool ScanOutcome::addScope(const QString& cidr)
+{
+    const QString trimmed = cidr.trimmed();
+    if (trimmed.contains('/')) {
+        if (!IPUtils::isValidCIDR(trimmed) || IPUtils::isIPv6(trimmed.section('/', 0, 0))) return false;
+        const auto range = IPUtils::cidrToRange(trimmed);
+        m_scope.addRange(range.first.ipv4, range.second.ipv4);
+        return true;
+    }
+    if (!IPUtils::isValidIP(trimmed) || IPUtils::isIPv6(trimmed)) return false;
+    m_scope.add(IPUtils::stringToIP(trimmed).ipv4);
+    return true;
+}
+
+void ScanOutcome::record(const QString& ip, bool success)
+{
+    if (IPUtils::isIPv6(ip) || !IPUtils::isValidIP(ip)) return;
+    const uint32_t address = IPUtils::stringToIP(ip).ipv4;
+    m_tested.add(address);
+    if (success) m_reachable.add(address);
+}
+
+void ScanOutcome::clear()
+{
+    m_scope = RoaringBitmap();
+    m_tested = RoaringBitmap();
+    m_reachable = RoaringBitmap();
+}
+
+std::size_t ScanOutcome::memoryBytes() const
+{
+    return m_scope.memoryBytes() + m_tested.memoryBytes() + m_reachable.memoryBytes();
+}
+
+void ScanOutcome::merge(const ScanOutcome& other)
+{
+    m_scope = m_scope | other.m_scope;
+    m_tested = m_tested | other.m_tested;
+    m_reachable = m_reachable | other.m_reachable;
+}
+
+RoaringBitmap ScanOutcome::newlyDead(const ScanOutcome& before, const ScanOutcome& after)
+{
+    return before.m_reachable & after.unreachable();
+}
+
+RoaringBitmap ScanOutcome::newlyAlive(const ScanOutcome& before, const ScanOutcome& after)
+{
+    return before.unreachable() & after.m_reachable;
+}
+
+// 每个连续区间从左端起反复取最大的对齐块
+QStringList ScanOutcome::toCidrs(const RoaringBitmap& bitmap)
+{
+    QStringList cidrs;
+    bitmap.forEachRange([&cidrs](uint32_t first, uint32_t last) {
+        uint64_t start = first;
+        const uint64_t end = static_cast<uint64_t>(last) + 1;
+        while (start < end) {
+            int bits = start == 0 ? 32 : std::countr_zero(start);
+            while (bits > 0 && start + (uint64_t(1) << bits) > end) --bits;
+            cidrs.append(QString("%1/%2").arg(IPUtils::uint32ToIP(static_cast<uint32_t>(start))).arg(32 - bits));
+            start += uint64_t(1) << bits;
+        }
+    });
+    return cidrs;
+}
+
+// 格式：魔数、版本，之后依次为范围、已探测、可达三个位图
+bool ScanOutcome::save(const QString& path, QString* error)
+{
+    m_scope.optimize();
+    m_tested.optimize();
+    m_reachable.optimize();
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    const uint32_t header[2] = {FILE_MAGIC, FILE_VERSION};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    m_scope.write(file);
+    m_tested.write(file);
+    m_reachable.write(file);
+    if (!file.flush()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ScanOutcome::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    uint32_t header[2] = {0, 0};
+    if (file.read(reinterpret_cast<char*>(header), sizeof(header)) != static_cast<qint64>(sizeof(header)) ||
+        header[0] != FILE_MAGIC || header[1] != FILE_VERSION) {
+        if (error) *error = "不是CFPing扫描结果位图文件";
+        return false;
+    }
+    ScanOutcome loaded;
+    if (!loaded.m_scope.read(file) || !loaded.m_tested.read(file) || !loaded.m_reachable.read(file)) {
+        if (error) *error = "文件已损坏或不完整";
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef SCANOUTCOME_H
+#define SCANOUTCOME_H
+
+#include "roaringbitmap.h"
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+
+// 一次扫描中每个地址的探测结果，失败的地址也记录在内：
+// 范围（输入的全部地址）、已探测、可达三个压缩位图，不可达 = 已探测 − 可达，未探测 = 范围 − 已探测。
+// 以IPv4地址本身为键而不是扫描序号，输入不同的两次扫描也能直接求交集与差集；IPv6结果不记录
+class ScanOutcome
+{
+public:
+    // 把一个CIDR或单个IP加入范围，IPv6或无效时返回false
+    bool addScope(const QString& cidr);
+    // 记录一个地址的探测结果，IPv6或无效时忽略
+    void record(const QString& ip, bool success);
+    void clear();
+
+    const RoaringBitmap& scope() const { return m_scope; }
+    const RoaringBitmap& tested() const { return m_tested; }
+    const RoaringBitmap& reachable() const { return m_reachable; }
+    RoaringBitmap unreachable() const { return m_tested - m_reachable; }
+    RoaringBitmap untested() const { return m_scope - m_tested; }
+    std::size_t memoryBytes() const;
+
+    // 合并另一次扫描（如其他分片）：各位图取并集，两边结果冲突时以可达为准
+    void merge(const ScanOutcome& other);
+    // 上一次可达、这一次探测失败的地址
+    static RoaringBitmap newlyDead(const ScanOutcome& before, const ScanOutcome& after);
+    // 上一次探测失败、这一次可达的地址
+    static RoaringBitmap newlyAlive(const ScanOutcome& before, const ScanOutcome& after);
+
+    // 位图中的地址合并为最少的CIDR，按地址升序
+    static QStringList toCidrs(const RoaringBitmap& bitmap);
+
+    // 保存前把各位图换成最小的表示
+    bool save(const QString& path, QString* error = nullptr);
+    bool load(const QString& path, QString* error = nullptr);
+
+private:
+    RoaringBitmap m_scope;
+    RoaringBitmap m_tested;
+    RoaringBitmap m_reachable;
+
+    static constexpr uint32_t FILE_MAGIC = 0x50414d43; // "CMAP"
+    static constexpr uint32_t FILE_VERSION = 1;
+};
+
+#endif // SCANOUTCOME_H
@@ -0,0 +1,183 @@
+#include "scanplan.h"
+#include "cidrfile.h"
+#include <algorithm>
+#include <string>
+
+namespace {
+
+template <typename Value>
+using Intervals = std::vector<std::pair<Value, Value>>;
+
+// 区间按起点排序，重叠或首尾相接的合并为一段，原地完成
+template <typename Value>
+void mergeIntervals(Intervals<Value>& intervals)
+{
+    std::sort(intervals.begin(), intervals.end());
+    std::size_t kept = 0;
+    for (const auto& interval : intervals) {
+        if (kept > 0) {
+            Value& last = intervals[kept - 1].second;
+            // last为最大值时前一个条件已成立，last + 1不会回绕
+            if (interval.first <= last || last + 1 == interval.first) {
+                last = std::max(last, interval.second);
+                continue;
+            }
+        }
+        intervals[kept++] = interval;
+    }
+    intervals.resize(kept);
+}
+
+template <typename Value>
+void addUnique(Intervals<Value> intervals, AddressCount& count)
+{
+    mergeIntervals(intervals);
+    for (const auto& interval : intervals) {
+        count.add(UInt128(interval.second - interval.first));
+    }
+}
+
+} // namespace
+
+void AddressCount::add(UInt128 sizeMinusOne)
+{
+    m_minusOne = m_empty ? sizeMinusOne : m_minusOne + sizeMinusOne + 1;
+    m_empty = false;
+}
+
+void AddressCount::add(const AddressCount& other)
+{
+    if (!other.m_empty) add(other.m_minusOne);
+}
+
+double AddressCount::toDouble() const
+{
+    if (m_empty) return 0.0;
+    return static_cast<double>(highWord(m_minusOne)) * 18446744073709551616.0 +
+           static_cast<double>(lowWord(m_minusOne)) + 1.0;
+}
+
+// 按32位分四段做除以10的长除法得到“数量−1”的各位，再在十进制上加1
+QString AddressCount::toString() const
+{
+    if (m_empty) return QString("0");
+    uint32_t limbs[4] = {static_cast<uint32_t>(highWord(m_minusOne) >> 32), static_cast<uint32_t>(highWord(m_minusOne)),
+                         static_cast<uint32_t>(lowWord(m_minusOne) >> 32), static_cast<uint32_t>(lowWord(m_minusOne))};
+    std::string digits;
+    bool nonZero = true;
+    while (nonZero) {
+        uint64_t remainder = 0;
+        nonZero = false;
+        for (uint32_t& limb : limbs) {
+            const uint64_t value = (remainder << 32) | limb;
+            limb = static_cast<uint32_t>(value / 10);
+            remainder = value % 10;
+            nonZero = nonZero || limb != 0;
+        }
+        digits.push_back(static_cast<char>('0' + remainder));
+    }
+    // digits为低位在前
+    std::size_t i = 0;
+    for (; i < digits.size() && digits[i] == '9'; ++i) digits[i] = '0';
+    if (i == digits.size()) digits.push_back('1');
+    else ++digits[i];
+    std::reverse(digits.begin(), digits.end());
+    return QString::fromLatin1(digits.data(), static_cast<int>(digits.size()));
+}
+
+AddressCount AddressCount::minus(const AddressCount& other) const
+{
+    AddressCount result;
+    if (m_empty) return result;
+    if (other.m_empty) return *this;
+    if (m_minusOne > other.m_minusOne) result.add(m_minusOne - other.m_minusOne - 1);
+    return result;
+}
+
+bool ScanPlan::add(const QString& entry)
+{
+    const QString cidr = CidrExpander::toCidr(entry);
+    const uint64_t scanned = CidrExpander::rangeCount(cidr);
+    if (scanned == 0) {
+        ++m_invalidCount;
+        return false;
+    }
+
+    const auto bounds = IPUtils::cidrToRange(cidr);
+    ScanPlanRange range;
+    range.cidr = cidr;
+    range.scanned = scanned;
+    visitFamily(bounds.first.type, [&](auto family) {
+        using Family = decltype(family);
+        const auto first = Family::fromAddress(bounds.first);
+        const auto last = Family::fromAddress(bounds.second);
+        range.addresses.add(UInt128(last - first));
+        if (m_uniqueOverflow) return;
+        if constexpr (Family::TYPE == IPAddress::IPv4) {
+            m_ipv4.emplace_back(first, last);
+        } else {
+            m_ipv6.emplace_back(first, last);
+        }
+    });
+    if (m_ipv4.size() + m_ipv6.size() >= m_compactAt) {
+        compactIntervals();
+    }
+
+    ++m_rangeCount;
+    m_scanned += scanned;
+    m_addresses.add(range.addresses);
+    if (m_ranges.size() < static_cast<std::size_t>(MAX_LISTED_RANGES)) {
+        m_ranges.push_back(range);
+    }
+    return true;
+}
+
+void ScanPlan::addFile(const CidrFileSource& source, const std::atomic<bool>* cancel)
+{
+    qint64 offset = 0;
+    qint64 read = 0;
+    std::string_view entry;
+    while (source.nextEntry(offset, entry)) {
+        // 每读取16384条检查一次取消
+        if (cancel && (++read & 0x3FFF) == 0 && cancel->load(std::memory_order_relaxed)) break;
+        add(QString::fromLatin1(entry.data(), static_cast<int>(entry.size())));
+    }
+}
+
+void ScanPlan::compactIntervals()
+{
+    mergeIntervals(m_ipv4);
+    mergeIntervals(m_ipv6);
+    const std::size_t merged = m_ipv4.size() + m_ipv6.size();
+    if (merged > MAX_UNIQUE_INTERVALS) {
+        m_uniqueOverflow = true;
+        decltype(m_ipv4)().swap(m_ipv4);
+        decltype(m_ipv6)().swap(m_ipv6);
+        return;
+    }
+    m_compactAt = std::max(COMPACT_INTERVALS, merged * 2);
+}
+
+AddressCount ScanPlan::uniqueCount() const
+{
+    AddressCount count;
+    if (m_uniqueOverflow) return count;
+    addUnique(m_ipv4, count);
+    addUnique(m_ipv6, count);
+    return count;
+}
+
+ScanEstimate ScanPlan::estimate(const ScanShard& shard, std::size_t portCount, int concurrency, int timeoutMs,
+                                double measuredRate) const
+{
+    ScanEstimate estimate;
+    estimate.addresses = shard.share(m_scanned);
+    estimate.probes = estimate.addresses * std::max<std::size_t>(1, portCount);
+    const int timeout = std::min(std::max(1, timeoutMs), ScanEngine::MAX_PROBE_TIMEOUT_MS);
+    estimate.timeoutBoundMs = static_cast<double>(estimate.probes) * timeout / std::max(1, concurrency);
+    if (measuredRate > 0.0) {
+        estimate.measuredRate = measuredRate;
+        estimate.measuredMs = estimate.addresses / measuredRate * 1000.0;
+    }
+    return estimate;
+}
@@ -0,0 +1,96 @@
+#ifndef SCANPLAN_H
+#define SCANPLAN_H
+
+#include "scanengine.h"
+#include "cidrexpander.h"
+#include "iputils.h"
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class CidrFileSource;
+
+// 地址数量：以128位整数保存“数量−1”，整个IPv6空间（2^128个地址）也能精确表示
+class AddressCount
+{
+public:
+    // 加上sizeMinusOne + 1个地址
+    void add(UInt128 sizeMinusOne);
+    void add(const AddressCount& other);
+    bool isZero() const { return m_empty; }
+    double toDouble() const;
+    QString toString() const; // 十进制
+    // 两者之差（this ≥ other），结果不足一个地址时为0
+    AddressCount minus(const AddressCount& other) const;
+
+private:
+    UInt128 m_minusOne = 0;
+    bool m_empty = true;
+};
+
+// 扫描计划中的一个输入范围
+struct ScanPlanRange {
+    QString cidr;           // 规范化后的CIDR
+    AddressCount addresses; // 范围内的地址数
+    uint64_t scanned = 0;   // 实际扫描的地址数，过大的IPv6范围按上限截断
+};
+
+// 扫描耗时的估计
+struct ScanEstimate {
+    uint64_t addresses = 0;        // 本片实际扫描的地址数
+    uint64_t probes = 0;           // 地址数 × 端口数
+    double timeoutBoundMs = 0.0;   // 全部探测都超时时的耗时：探测数 × 超时 / 并发，是上限
+    double measuredRate = 0.0;     // 上次扫描实测的速率（地址/秒），没有时为0
+    double measuredMs = -1.0;      // 按实测速率估计的耗时，没有实测时为-1
+};
+
+// 扫描计划（预演）：按与扫描相同的规则解析输入，只用范围的端点做算术，不展开任何地址，
+// 很大的IPv6范围也在毫秒级完成。扫描本身不去重，重叠的地址会被重复探测，计划单独统计去重后的数量。
+// 去重用的区间攒到一定数量就排序合并，内存随合并后互不相连的区间数增长而不是随输入行数；
+// 超过上限时放弃去重，其余计数不受影响
+class ScanPlan
+{
+public:
+    static constexpr int MAX_LISTED_RANGES = 100;               // ranges()保留的范围数，其余只计入总数
+    static constexpr std::size_t MAX_UNIQUE_INTERVALS = 1 << 20; // 合并后仍超过这么多区间时不再去重
+
+    // 加入一条输入（CIDR或单个IP），无效时返回false
+    bool add(const QString& entry);
+    // 依次加入文件中的全部条目，在调用线程中读取
+    void addFile(const CidrFileSource& source, const std::atomic<bool>* cancel = nullptr);
+
+    const std::vector<ScanPlanRange>& ranges() const { return m_ranges; }
+    uint64_t rangeCount() const { return m_rangeCount; }
+    uint64_t invalidCount() const { return m_invalidCount; }
+    // 各范围地址数之和（含重叠部分）
+    const AddressCount& addressCount() const { return m_addresses; }
+    // 去重后的地址数：各地址族的区间排序合并后求和；hasUniqueCount()为false时不可用
+    bool hasUniqueCount() const { return !m_uniqueOverflow; }
+    AddressCount uniqueCount() const;
+    // 不分片时实际扫描的地址数
+    uint64_t scannedCount() const { return m_scanned; }
+
+    // measuredRate为上次扫描实测的速率（地址/秒），没有时传0；超时按探测的上限截断
+    ScanEstimate estimate(const ScanShard& shard, std::size_t portCount, int concurrency, int timeoutMs,
+                          double measuredRate) const;
+
+private:
+    std::vector<ScanPlanRange> m_ranges;
+    uint64_t m_rangeCount = 0;
+    uint64_t m_invalidCount = 0;
+    AddressCount m_addresses;
+    uint64_t m_scanned = 0;
+    // 加入区间后超过m_compactAt时排序合并两个地址族的区间
+    void compactIntervals();
+
+    std::vector<std::pair<IPv4Family::Value, IPv4Family::Value>> m_ipv4; // 闭区间，去重时排序合并
+    std::vector<std::pair<IPv6Family::Value, IPv6Family::Value>> m_ipv6;
+    std::size_t m_compactAt = COMPACT_INTERVALS;
+    bool m_uniqueOverflow = false;
+
+    static constexpr std::size_t COMPACT_INTERVALS = 1 << 16; // 首次合并的区间数，之后为合并后数量的两倍
+};
+
+#endif // SCANPLAN_H
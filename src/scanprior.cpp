@@ -0,0 +1,123 @@
+#include "scanprior.h"
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+#include <functional>
+
+bool ScanPrior::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    m_entries.clear();
+    m_ipv4Prefixes.clear();
+    m_ipv6Prefixes.clear();
+
+    // 列位置由表头决定；没有表头时按CFPing结果格式，第二列为延迟
+    int latencyColumn = 1;
+    int scoreColumn = -1;
+    int successColumn = -1;
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        const QStringList fields = line.split(',');
+        const QString key = fields[0].trimmed();
+        const bool isCidr = key.contains('/');
+        if (isCidr ? !IPUtils::isValidCIDR(key) : !IPUtils::isValidIP(key)) {
+            // 表头（或无法识别的行），表头之后的列位置以它为准
+            for (int i = 0; i < fields.size(); ++i) {
+                QString name = fields[i].trimmed().toLower();
+                if (name == "latency_ms") latencyColumn = i;
+                else if (name == "score") scoreColumn = i;
+                else if (name == "success") successColumn = i;
+            }
+            continue;
+        }
+
+        float score = 0.0f;
+        if (scoreColumn >= 0 && scoreColumn < fields.size()) {
+            score = static_cast<float>(std::clamp(fields[scoreColumn].trimmed().toDouble(), 0.0, 100.0));
+        } else if (fields.size() == 1) {
+            score = 100.0f; // 只有地址的列表视为已知可用
+        } else if (latencyColumn < fields.size()) {
+            bool ok = false;
+            double latencyMs = fields[latencyColumn].trimmed().toDouble(&ok);
+            bool success = ok && latencyMs >= 0.0;
+            if (successColumn >= 0 && successColumn < fields.size()) {
+                success = success && fields[successColumn].trimmed().toInt() != 0;
+            }
+            score = success ? latencyScore(latencyMs) : 0.0f;
+        }
+
+        if (isCidr) {
+            int prefix = key.section('/', 1).toInt();
+            add(IPUtils::cidrToRange(key).first, prefix, score);
+        } else {
+            IPAddress address = IPUtils::stringToIP(key);
+            add(address, address.type == IPAddress::IPv4 ? 32 : 128, score);
+        }
+    }
+
+    if (m_entries.empty()) {
+        if (error) *error = "文件中没有可用的IP或网段";
+        return false;
+    }
+    return true;
+}
+
+float ScanPrior::latencyScore(double latencyMs)
+{
+    return static_cast<float>(100.0 * LATENCY_REFERENCE_MS / (LATENCY_REFERENCE_MS + std::max(0.0, latencyMs)));
+}
+
+void ScanPrior::add(const IPAddress& address, int prefix, float score)
+{
+    const bool v4 = address.type == IPAddress::IPv4;
+    prefix = std::min(prefix, v4 ? IPV4_PREFIX : IPV6_PREFIX);
+    Entry& entry = m_entries[keyOf(address, prefix)];
+    entry.scoreSum += score;
+    ++entry.samples;
+    if (score > 0.0f) ++entry.successes;
+
+    std::vector<int>& prefixes = v4 ? m_ipv4Prefixes : m_ipv6Prefixes;
+    if (std::find(prefixes.begin(), prefixes.end(), prefix) == prefixes.end()) {
+        prefixes.push_back(prefix);
+        std::sort(prefixes.begin(), prefixes.end(), std::greater<int>());
+    }
+}
+
+ScanPrior::Rank ScanPrior::rank(const IPAddress& address) const
+{
+    Rank result;
+    const std::vector<int>& prefixes = address.type == IPAddress::IPv4 ? m_ipv4Prefixes : m_ipv6Prefixes;
+    for (int prefix : prefixes) {
+        auto it = m_entries.find(keyOf(address, prefix));
+        if (it == m_entries.end()) continue;
+        const Entry& entry = it->second;
+        result.tier = entry.successes > 0 ? Tier::Good : Tier::Dead;
+        result.score = static_cast<float>(entry.scoreSum / entry.samples);
+        break;
+    }
+    return result;
+}
+
+uint64_t ScanPrior::keyOf(const IPAddress& address, int prefix)
+{
+    uint64_t network = 0;
+    uint64_t family = 0;
+    if (address.type == IPAddress::IPv4) {
+        network = address.ipv4;
+        network = prefix == 0 ? 0 : network & (~0ULL << (32 - prefix));
+    } else {
+        for (int i = 0; i < 6; ++i) {
+            network = (network << 8) | address.ipv6[i];
+        }
+        network = prefix == 0 ? 0 : network & (~0ULL << (48 - prefix)) & 0xFFFFFFFFFFFFULL;
+        family = 1;
+    }
+    return family << 63 | static_cast<uint64_t>(prefix) << 48 | network;
+}
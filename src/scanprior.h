@@ -0,0 +1,63 @@
+#ifndef SCANPRIOR_H
+#define SCANPRIOR_H
+
+#include "iputils.h"
+#include <QString>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// 扫描先验：以前的结果按网段汇总的评分，用于让扫描先探测历史上表现好的网段（热启动）。
+// 可以读取：
+//   - CFPing保存的CSV结果（ip,latency_ms,...）或cfping-history query的输出，每个IP按延迟计分；
+//   - 网段评分文件（cidr,...,score），如 cfping-history best --subnet 的输出；
+//   - 每行一个IP或CIDR的列表，视为已知可用。
+// IP与细于汇总粒度的网段并入所在的/24（IPv6为/48），更粗的网段按原前缀保存，查询时取最长匹配
+class ScanPrior
+{
+public:
+    // 网段的先验等级，扫描按等级、再按评分从高到低调度
+    enum class Tier {
+        Dead = 0,    // 有记录但从未成功
+        Unknown = 1, // 没有记录
+        Good = 2     // 有成功记录
+    };
+
+    struct Rank {
+        Tier tier = Tier::Unknown;
+        float score = 0.0f;  // 0–100，Unknown时为0
+    };
+
+    // 读取先验文件，失败或没有可用行时返回false
+    bool load(const QString& path, QString* error = nullptr);
+
+    bool isEmpty() const { return m_entries.empty(); }
+    std::size_t subnetCount() const { return m_entries.size(); }
+    // 包含address的最长匹配网段的等级与评分
+    Rank rank(const IPAddress& address) const;
+
+    // 单个结果的评分：成功时按延迟折减，延迟等于参考值时为50，失败为0
+    static float latencyScore(double latencyMs);
+
+    static constexpr int IPV4_PREFIX = 24;   // IP汇总的网段粒度，也是扫描拆分IPv4范围的粒度
+    static constexpr int IPV6_PREFIX = 48;
+    static constexpr double LATENCY_REFERENCE_MS = 100.0;
+
+private:
+    struct Entry {
+        double scoreSum = 0.0;
+        uint32_t samples = 0;
+        uint32_t successes = 0;
+    };
+
+    // 把一条评分计入address所在的网段，前缀细于汇总粒度时并入汇总网段
+    void add(const IPAddress& address, int prefix, float score);
+    // 网段键：族、前缀长度与网段地址的高48位
+    static uint64_t keyOf(const IPAddress& address, int prefix);
+
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::vector<int> m_ipv4Prefixes; // 出现过的前缀长度，降序，查询时按此顺序找最长匹配
+    std::vector<int> m_ipv6Prefixes;
+};
+
+#endif // SCANPRIOR_H
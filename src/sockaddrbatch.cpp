@@ -0,0 +1,104 @@
+#include "sockaddrbatch.h"
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CFPING_SOCKADDR_SSE2 1
+#endif
+
+namespace {
+
+sockaddr_in templateV4(uint16_t port)
+{
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    return address;
+}
+
+#ifdef CFPING_SOCKADDR_SSE2
+// 模板整体写出的前提：结构为16字节且地址位于第二个32位字（Linux、Windows、BSD系均如此）
+constexpr bool SSE2_LAYOUT = sizeof(sockaddr_in) == 16 && offsetof(sockaddr_in, sin_addr) == 4;
+
+// 每个32位通道内的字节交换：先交换16位内的两个字节，再交换两个16位
+inline __m128i byteSwap32(__m128i value)
+{
+    value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+    value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+}
+#endif
+
+} // namespace
+
+void SockaddrBatch::fillV4Scalar(uint32_t first, uint64_t stride, uint16_t port, sockaddr_in* out, std::size_t count)
+{
+    const sockaddr_in base = templateV4(port);
+    uint32_t value = first;
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = base;
+        out[i].sin_addr.s_addr = htonl(value);
+        value = IPv4Family::advance(value, stride);
+    }
+}
+
+void SockaddrBatch::fillV4(uint32_t first, uint64_t stride, uint16_t port, sockaddr_in* out, std::size_t count)
+{
+#ifdef CFPING_SOCKADDR_SSE2
+    if constexpr (SSE2_LAYOUT) {
+        const sockaddr_in base = templateV4(port);
+        const __m128i header = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&base));
+        // 步长按模2^32参与运算，与IPv4Family::advance的回绕一致
+        const uint32_t step = static_cast<uint32_t>(stride);
+        __m128i values = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(first)),
+                                       _mm_set_epi32(static_cast<int>(3 * step), static_cast<int>(2 * step),
+                                                     static_cast<int>(step), 0));
+        const __m128i advance = _mm_set1_epi32(static_cast<int>(4 * step));
+        const __m128i zero = _mm_setzero_si128();
+
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i swapped = byteSwap32(values);
+            // 与0交错后每个64位半部为(0, 地址)，恰好是sockaddr_in的前8字节中地址所在的位置
+            const __m128i low = _mm_unpacklo_epi32(zero, swapped);
+            const __m128i high = _mm_unpackhi_epi32(zero, swapped);
+            __m128i* target = reinterpret_cast<__m128i*>(out + i);
+            _mm_storeu_si128(target, _mm_or_si128(header, _mm_move_epi64(low)));
+            _mm_storeu_si128(target + 1, _mm_or_si128(header, _mm_srli_si128(low, 8)));
+            _mm_storeu_si128(target + 2, _mm_or_si128(header, _mm_move_epi64(high)));
+            _mm_storeu_si128(target + 3, _mm_or_si128(header, _mm_srli_si128(high, 8)));
+            values = _mm_add_epi32(values, advance);
+        }
+        if (i < count) {
+            fillV4Scalar(IPv4Family::advance(first, i * stride), stride, port, out + i, count - i);
+        }
+        return;
+    }
+#endif
+    fillV4Scalar(first, stride, port, out, count);
+}
+
+void SockaddrBatch::fillV6(IPv6Family::Value first, uint64_t stride, uint16_t port, sockaddr_in6* out,
+                           std::size_t count)
+{
+    sockaddr_in6 base;
+    std::memset(&base, 0, sizeof(base));
+    base.sin6_family = AF_INET6;
+    base.sin6_port = htons(port);
+    IPv6Family::Value value = first;
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = base;
+        const std::array<uint8_t, 16> bytes = IPv6Family::toBytes(value);
+        std::memcpy(&out[i].sin6_addr, bytes.data(), bytes.size());
+        value = IPv6Family::advance(value, stride);
+    }
+}
+
+bool SockaddrBatch::vectorized()
+{
+#ifdef CFPING_SOCKADDR_SSE2
+    return SSE2_LAYOUT;
+#else
+    return false;
+#endif
+}
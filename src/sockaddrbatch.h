@@ -0,0 +1,29 @@
+#ifndef SOCKADDRBATCH_H
+#define SOCKADDRBATCH_H
+
+#include "iputils.h"
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#endif
+
+// 为一段等间隔的地址批量生成套接字地址（网络字节序，端口相同），供探测直接连接。
+// IPv4在x86-64上用SSE2每次处理4个地址：广播首地址、加各通道偏移、字节交换，
+// 再把每个地址放入预先填好协议族与端口的16字节模板整体写出；其他平台与IPv6逐个填写
+class SockaddrBatch
+{
+public:
+    // 依次写入first、first + stride……共count个地址，按模2^32回绕
+    static void fillV4(uint32_t first, uint64_t stride, uint16_t port, sockaddr_in* out, std::size_t count);
+    // 逐个填写的实现，结果与fillV4相同
+    static void fillV4Scalar(uint32_t first, uint64_t stride, uint16_t port, sockaddr_in* out, std::size_t count);
+    static void fillV6(IPv6Family::Value first, uint64_t stride, uint16_t port, sockaddr_in6* out, std::size_t count);
+    // 当前构建的fillV4是否使用SIMD
+    static bool vectorized();
+};
+
+#endif // SOCKADDRBATCH_H
@@ -0,0 +1,185 @@
+#include "socketfactory.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <climits>
+#include <limits>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+int64_t currentFileLimit()
+{
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return -1;
+    if (limit.rlim_cur == RLIM_INFINITY) return std::numeric_limits<int64_t>::max();
+    return static_cast<int64_t>(limit.rlim_cur);
+}
+#endif
+
+#ifdef __linux__
+// 统计/proc/self/fd中的条目，不含遍历目录本身占用的描述符
+int64_t countOpenFds()
+{
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) return -1;
+    int64_t count = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') ++count;
+    }
+    closedir(dir);
+    return count > 0 ? count - 1 : 0;
+}
+
+int64_t ephemeralPortCount()
+{
+    std::FILE* file = std::fopen("/proc/sys/net/ipv4/ip_local_port_range", "r");
+    if (!file) return -1;
+    long low = 0;
+    long high = 0;
+    int fields = std::fscanf(file, "%ld %ld", &low, &high);
+    std::fclose(file);
+    return fields == 2 && high >= low ? high - low + 1 : -1;
+}
+
+// /proc/net/sockstat的“TCP: inuse N orphan N tw N ...”行，tw同时包含IPv4与IPv6
+int64_t timeWaitCount()
+{
+    std::FILE* file = std::fopen("/proc/net/sockstat", "r");
+    if (!file) return -1;
+    int64_t result = -1;
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        long inUse = 0;
+        long orphan = 0;
+        long timeWait = 0;
+        if (std::sscanf(line, "TCP: inuse %ld orphan %ld tw %ld", &inUse, &orphan, &timeWait) == 3) {
+            result = timeWait;
+            break;
+        }
+    }
+    std::fclose(file);
+    return result;
+}
+#endif
+
+} // namespace
+
+// 文件描述符限制是进程级的，第一次调用时提高，之后直接返回结果
+int64_t SocketFactory::raiseFileLimit()
+{
+#ifdef _WIN32
+    return -1;
+#else
+    static const int64_t limit = []() {
+        rlimit current{};
+        if (getrlimit(RLIMIT_NOFILE, &current) == 0 && current.rlim_cur < current.rlim_max) {
+            rlimit raised = current;
+            raised.rlim_cur = current.rlim_max;
+#ifdef __APPLE__
+            // macOS的硬限制可能为RLIM_INFINITY，软限制不能超过OPEN_MAX
+            raised.rlim_cur = std::min<rlim_t>(current.rlim_max, OPEN_MAX);
+#endif
+            setrlimit(RLIMIT_NOFILE, &raised);
+        }
+        return currentFileLimit();
+    }();
+    return limit;
+#endif
+}
+
+// Linux上用SOCK_NONBLOCK|SOCK_CLOEXEC原子地创建，描述符不会在并发的fork/exec中泄漏给子进程
+boost::system::error_code SocketFactory::open(boost::asio::ip::tcp::socket& socket,
+                                              const boost::asio::ip::tcp& protocol)
+{
+    boost::system::error_code ec;
+#ifdef __linux__
+    int fd = ::socket(protocol.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol.protocol());
+    if (fd < 0) {
+        return boost::system::error_code(errno, boost::system::system_category());
+    }
+    socket.assign(protocol, fd, ec);
+    if (ec) {
+        ::close(fd);
+    }
+#else
+    socket.open(protocol, ec);
+    if (!ec) {
+        socket.non_blocking(true, ec);
+    }
+#ifndef _WIN32
+    if (!ec && ::fcntl(socket.native_handle(), F_SETFD, FD_CLOEXEC) != 0) {
+        ec = boost::system::error_code(errno, boost::system::system_category());
+    }
+#endif
+#endif
+    return ec;
+}
+
+int SocketFactory::systemError(const boost::system::error_code& ec)
+{
+    if (!ec) return 0;
+    if (ec.category() == boost::system::system_category() || ec.category() == boost::system::generic_category()) {
+        return ec.value();
+    }
+    return ec == boost::asio::error::eof ? ECONNRESET : EPROTO;
+}
+
+void SocketFactory::close(boost::asio::ip::tcp::socket& socket, bool abortive)
+{
+    boost::system::error_code ec;
+    if (abortive) {
+        socket.set_option(boost::asio::socket_base::linger(true, 0), ec);
+    } else {
+        socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    }
+    socket.close(ec);
+}
+
+double SocketFactory::kernelRttMs(boost::asio::ip::tcp::socket& socket)
+{
+#if defined(__linux__)
+    tcp_info info{};
+    socklen_t length = sizeof(info);
+    if (::getsockopt(socket.native_handle(), IPPROTO_TCP, TCP_INFO, &info, &length) != 0 || info.tcpi_rtt == 0) {
+        return -1.0;
+    }
+    return info.tcpi_rtt / 1000.0; // 微秒
+#elif defined(__APPLE__)
+    tcp_connection_info info{};
+    socklen_t length = sizeof(info);
+    if (::getsockopt(socket.native_handle(), IPPROTO_TCP, TCP_CONNECTION_INFO, &info, &length) != 0 ||
+        info.tcpi_srtt == 0) {
+        return -1.0;
+    }
+    return info.tcpi_srtt; // 毫秒
+#else
+    (void)socket;
+    return -1.0;
+#endif
+}
+
+SocketHeadroom SocketFactory::headroom()
+{
+    SocketHeadroom result;
+#ifndef _WIN32
+    result.fdLimit = currentFileLimit();
+#endif
+#ifdef __linux__
+    result.openFds = countOpenFds();
+    result.ephemeralPorts = ephemeralPortCount();
+    result.timeWait = timeWaitCount();
+#endif
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef SOCKETFACTORY_H
+#define SOCKETFACTORY_H
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp>
+#include <cstdint>
+
+// 套接字资源余量，无法获取的项为-1
+struct SocketHeadroom {
+    int64_t openFds = -1;        // 本进程已打开的文件描述符
+    int64_t fdLimit = -1;        // RLIMIT_NOFILE软限制
+    int64_t ephemeralPorts = -1; // 本地临时端口范围的大小
+    int64_t timeWait = -1;       // 系统中处于TIME_WAIT的TCP连接
+
+    int64_t fdHeadroom() const { return openFds >= 0 && fdLimit >= 0 ? fdLimit - openFds : -1; }
+    int64_t portHeadroom() const { return ephemeralPorts >= 0 && timeWait >= 0 ? ephemeralPorts - timeWait : -1; }
+};
+
+// 探测套接字的创建与关闭：高并发长时间扫描时避免文件描述符耗尽（EMFILE）
+// 和TIME_WAIT占满临时端口（EADDRNOTAVAIL）
+class SocketFactory
+{
+public:
+    // 将文件描述符软限制提高到硬限制，进程内只执行一次；返回当前软限制，不支持的平台返回-1
+    static int64_t raiseFileLimit();
+
+    // 按protocol打开套接字，创建时即为非阻塞与close-on-exec（Linux上一次系统调用完成）
+    static boost::system::error_code open(boost::asio::ip::tcp::socket& socket,
+                                          const boost::asio::ip::tcp& protocol);
+
+    // 换算为系统错误码（结果与指标都按system_category解释）：系统与通用类别原样返回，
+    // 对端提前关闭（asio的eof）记为ECONNRESET，其他类别（如SSL流错误）记为EPROTO
+    static int systemError(const boost::system::error_code& ec);
+
+    // 关闭连接；abortive为true时设置SO_LINGER 0，直接发送RST，本端不进入TIME_WAIT
+    static void close(boost::asio::ip::tcp::socket& socket, bool abortive);
+
+    // 已连接套接字的内核RTT（毫秒）：握手刚完成时即SYN到SYN-ACK的往返，由内核打时间戳，
+    // 不含用户态调度排队；Linux读取TCP_INFO，macOS读取TCP_CONNECTION_INFO，其他平台返回-1
+    static double kernelRttMs(boost::asio::ip::tcp::socket& socket);
+
+    // 读取当前的文件描述符与临时端口余量（Linux读取/proc，其他平台只提供部分项）
+    static SocketHeadroom headroom();
+};
+
+#endif // SOCKETFACTORY_H
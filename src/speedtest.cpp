@@ -0,0 +1,322 @@
+#include "speedtest.h"
+#include "httptrace.h"
+#include "tlsprobe.h"
+#include "socketfactory.h"
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <QUrl>
+#include <algorithm>
+#include <cerrno>
+#include <optional>
+#include <tuple>
+
+namespace {
+
+// 读取一段正文数据：明文直接读套接字，TLS时先解密已输入的数据，不够再从套接字读入密文
+boost::asio::awaitable<std::tuple<boost::system::error_code, std::size_t>>
+readSome(boost::asio::ip::tcp::socket& socket, TlsSession* tls, char* out, std::size_t size)
+{
+    if (!tls) {
+        co_return co_await socket.async_read_some(boost::asio::buffer(out, size),
+                                                  boost::asio::as_tuple(boost::asio::use_awaitable));
+    }
+    for (;;) {
+        int n = tls->readApplicationData(out, size);
+        if (n > 0) co_return std::make_tuple(boost::system::error_code(), static_cast<std::size_t>(n));
+        if (n < 0) co_return std::make_tuple(boost::system::error_code(boost::asio::error::eof), std::size_t(0));
+
+        auto [ec, received] = co_await socket.async_read_some(
+            boost::asio::buffer(tls->buffer()), boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (received > 0 && !tls->feedInput(received)) {
+            co_return std::make_tuple(boost::system::error_code(EPROTO, boost::system::system_category()),
+                                      std::size_t(0));
+        }
+        if (ec && received == 0) co_return std::make_tuple(ec, std::size_t(0));
+    }
+}
+
+} // namespace
+
+bool SpeedTest::resolveUrl(const QString& text, SpeedTestUrl& url, QString* error)
+{
+    QString trimmed = text.trimmed();
+    bool isByteCount = false;
+    qulonglong bytes = trimmed.toULongLong(&isByteCount);
+    QUrl parsed(isByteCount ? QString(DEFAULT_URL) + QString::number(bytes) : trimmed);
+
+    QString scheme = parsed.scheme().toLower();
+    if (!parsed.isValid() || parsed.host().isEmpty() || (scheme != "http" && scheme != "https")) {
+        if (error) *error = QString("无效的测速地址: %1").arg(trimmed);
+        return false;
+    }
+
+    url.tls = scheme == "https";
+    url.host = parsed.host(QUrl::FullyEncoded).toStdString();
+    url.port = static_cast<uint16_t>(parsed.port(url.tls ? 443 : 80));
+    url.target = parsed.toEncoded(QUrl::RemoveScheme | QUrl::RemoveAuthority | QUrl::RemoveFragment).toStdString();
+    if (url.target.empty()) url.target = "/";
+    return true;
+}
+
+// Accept-Encoding: identity避免压缩影响字节数，Connection: close让服务端发送完毕后关闭
+std::string SpeedTest::buildRequest(const SpeedTestUrl& url)
+{
+    std::string request;
+    request.reserve(128 + url.host.size() + url.target.size());
+    request += "GET ";
+    request += url.target;
+    request += " HTTP/1.1\r\nHost: ";
+    request += url.host;
+    if (url.port != (url.tls ? 443 : 80)) {
+        request += ':';
+        request += std::to_string(url.port);
+    }
+    request += "\r\nUser-Agent: cfping\r\nAccept: */*\r\nAccept-Encoding: identity\r\nConnection: close\r\n\r\n";
+    return request;
+}
+
+double SpeedTest::combinedScore(double latencyMs, double mbps)
+{
+    return mbps / (1.0 + std::max(0.0, latencyMs) / LATENCY_REFERENCE_MS);
+}
+
+double SpeedTest::throughputMbps(const SpeedTestMeasurement& measurement)
+{
+    double seconds = std::chrono::duration<double>(measurement.lastByteAt - measurement.firstByteAt).count();
+    uint64_t bytes = measurement.bodyBytes - measurement.firstChunkBytes;
+    return seconds > 0.0 && bytes > 0 ? bytes * 8.0 / seconds / 1e6 : 0.0;
+}
+
+// 头部在缓冲区中累积解析，之后每次读取都从缓冲区起始位置覆盖写入
+boost::asio::awaitable<void> SpeedTest::download(boost::asio::ip::tcp::socket& socket, TlsSession* tls,
+                                                 const std::string& request, char* buffer,
+                                                 SpeedTestMeasurement& measurement)
+{
+    if (tls) {
+        if (!tls->writeApplicationData(request.data(), request.size())) {
+            measurement.error = EPROTO;
+            co_return;
+        }
+        for (std::size_t n = tls->takeOutput(); n > 0; n = tls->takeOutput()) {
+            auto [ec, written] = co_await boost::asio::async_write(
+                socket, boost::asio::buffer(tls->buffer().data(), n), boost::asio::as_tuple(boost::asio::use_awaitable));
+            if (ec) {
+                measurement.error = ec.value();
+                co_return;
+            }
+        }
+    } else {
+        auto [ec, written] = co_await boost::asio::async_write(
+            socket, boost::asio::buffer(request), boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (ec) {
+            measurement.error = ec.value();
+            co_return;
+        }
+    }
+
+    bool headersDone = false;
+    long long contentLength = -1;
+    std::size_t used = 0;
+    for (;;) {
+        auto [ec, n] = co_await readSome(socket, tls, buffer + used, BUFFER_SIZE - used);
+        auto now = std::chrono::steady_clock::now();
+
+        if (n > 0 && !headersDone) {
+            used += n;
+            HttpTraceResponse response = HttpTrace::parse(std::string_view(buffer, used));
+            if (response.headersComplete) {
+                headersDone = true;
+                measurement.status = response.status;
+                contentLength = response.contentLength;
+                uint64_t body = used - response.headerSize;
+                if (body > 0) {
+                    measurement.bodyBytes = measurement.firstChunkBytes = body;
+                    measurement.firstByteAt = measurement.lastByteAt = now;
+                }
+                used = 0;
+                if (response.status < 200 || response.status >= 300) co_return;
+            } else if (used == BUFFER_SIZE) {
+                measurement.error = EMSGSIZE; // 头部超过缓冲区
+                co_return;
+            }
+        } else if (n > 0) {
+            if (measurement.bodyBytes == 0) {
+                measurement.firstChunkBytes = n;
+                measurement.firstByteAt = now;
+            }
+            measurement.bodyBytes += n;
+            measurement.lastByteAt = now;
+        }
+
+        if (headersDone && contentLength >= 0 && measurement.bodyBytes >= static_cast<uint64_t>(contentLength)) {
+            co_return;
+        }
+        if (ec) {
+            if (ec != boost::asio::error::eof) measurement.error = ec.value();
+            co_return;
+        }
+    }
+}
+
+SpeedTestWorker::SpeedTestWorker(QObject* parent)
+    : QObject(parent)
+{
+    // 结果通过队列连接跨线程传递
+    qRegisterMetaType<SpeedTestResult>("SpeedTestResult");
+}
+
+SpeedTestWorker::~SpeedTestWorker()
+{
+    stop();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+// 分配槽位并启动测速线程，所有槽位空闲后io_context没有剩余工作，线程发出finished后退出
+void SpeedTestWorker::start(const SpeedTestSpec& spec)
+{
+    if (m_thread.joinable()) {
+        emit logMessage("测速已在进行中");
+        return;
+    }
+
+    QString error;
+    if (!SpeedTest::resolveUrl(spec.url, m_url, &error)) {
+        emit logMessage(error);
+        emit finished();
+        return;
+    }
+    m_spec = spec;
+    m_request = SpeedTest::buildRequest(m_url);
+    if (m_url.tls && !m_tlsContext) {
+        m_tlsContext = TlsProbe::createClientContext();
+        m_tlsPool = std::make_unique<TlsSessionPool>(*m_tlsContext);
+    }
+
+    m_nextTarget = 0;
+    m_completed = 0;
+    m_stopping = false;
+    int slotCount = std::min(std::max(1, m_spec.parallelism), static_cast<int>(m_spec.targets.size()));
+    if (slotCount == 0) {
+        emit finished();
+        return;
+    }
+    while (static_cast<int>(m_slots.size()) < slotCount) {
+        auto slot = std::make_unique<Slot>();
+        slot->buffer = std::make_unique<char[]>(SpeedTest::BUFFER_SIZE);
+        m_slots.push_back(std::move(slot));
+    }
+
+    emit logMessage(QString("开始测速: %1 个IP，并发 %2，%3://%4:%5%6")
+                   .arg(m_spec.targets.size()).arg(slotCount)
+                   .arg(m_url.tls ? "https" : "http")
+                   .arg(QString::fromStdString(m_url.host)).arg(m_url.port)
+                   .arg(QString::fromStdString(m_url.target)));
+
+    m_ioContext.restart();
+    for (int i = 0; i < slotCount; ++i) {
+        boost::asio::post(m_ioContext, [this, i]() { launch(static_cast<std::size_t>(i)); });
+    }
+    m_thread = std::thread([this]() {
+        m_ioContext.run();
+        emit finished();
+    });
+}
+
+// 取消信号只能在测速线程上触发
+void SpeedTestWorker::stop()
+{
+    if (m_stopping.exchange(true)) return;
+    boost::asio::post(m_ioContext, [this]() {
+        for (auto& slot : m_slots) {
+            #undef emit
+            slot->cancel.emit(boost::asio::cancellation_type::all);
+            #define emit Q_EMIT
+        }
+    });
+}
+
+void SpeedTestWorker::launch(std::size_t slot)
+{
+    if (m_stopping || m_nextTarget >= static_cast<int>(m_spec.targets.size())) return;
+
+    SpeedTestTarget target = m_spec.targets[m_nextTarget++];
+    boost::asio::co_spawn(m_ioContext, measure(target, slot),
+                          boost::asio::bind_cancellation_slot(m_slots[slot]->cancel.slot(),
+                              [this, slot](std::exception_ptr) {
+                                  // 完成回调执行时信号仍被引用，下一个IP延后到下一轮事件再绑定
+                                  boost::asio::post(m_ioContext, [this, slot]() { launch(slot); });
+                              }));
+}
+
+// 连接（与TLS握手）受timeoutMs约束，下载受maxDurationMs约束，到时以已收数据计算吞吐
+boost::asio::awaitable<void> SpeedTestWorker::measure(SpeedTestTarget target, std::size_t slot)
+{
+    using namespace boost::asio::experimental::awaitable_operators;
+
+    SpeedTestResult result;
+    result.ip = target.ip;
+    result.latencyMs = target.latencyMs;
+
+    try {
+        boost::system::error_code ec;
+        auto address = boost::asio::ip::make_address(target.ip.toStdString(), ec);
+        if (!ec) {
+            auto executor = co_await boost::asio::this_coro::executor;
+            boost::asio::ip::tcp::socket socket(executor);
+            boost::asio::steady_timer timer(executor);
+            timer.expires_after(std::chrono::milliseconds(m_spec.timeoutMs));
+            auto start = std::chrono::steady_clock::now();
+
+            boost::asio::ip::tcp::endpoint endpoint(address, m_url.port);
+            if (boost::system::error_code openError = SocketFactory::open(socket, endpoint.protocol())) {
+                throw boost::system::system_error(openError);
+            }
+            auto connected = co_await (
+                socket.async_connect(endpoint, boost::asio::as_tuple(boost::asio::use_awaitable)) ||
+                timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable))
+            );
+            bool ready = connected.index() == 0 && !std::get<0>(std::get<0>(connected));
+
+            std::optional<TlsSessionLease> session;
+            if (ready && m_url.tls) {
+                session.emplace(*m_tlsPool);
+                auto handshake = co_await (
+                    TlsProbe::handshake(socket, **session, m_url.host, start) ||
+                    timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable))
+                );
+                ready = handshake.index() == 0 && std::get<0>(handshake).success;
+            }
+
+            if (ready) {
+                SpeedTestMeasurement measurement;
+                timer.expires_after(std::chrono::milliseconds(m_spec.maxDurationMs));
+                co_await (
+                    SpeedTest::download(socket, session ? session->get() : nullptr, m_request,
+                                        m_slots[slot]->buffer.get(), measurement) ||
+                    timer.async_wait(boost::asio::as_tuple(boost::asio::use_awaitable))
+                );
+                result.httpStatus = measurement.status;
+                result.bytes = measurement.bodyBytes;
+                result.seconds = std::chrono::duration<double>(measurement.lastByteAt - measurement.firstByteAt).count();
+                result.mbps = SpeedTest::throughputMbps(measurement);
+                result.success = measurement.status >= 200 && measurement.status < 300 && result.mbps > 0.0;
+                result.score = SpeedTest::combinedScore(result.latencyMs, result.mbps);
+            }
+
+            boost::system::error_code closeError;
+            socket.close(closeError);
+        }
+    } catch (const std::exception&) {
+        result.success = false;
+    }
+
+    if (m_stopping) co_return;
+    emit speedResult(result);
+    emit progress(++m_completed, static_cast<int>(m_spec.targets.size()));
+}
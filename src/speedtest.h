@@ -0,0 +1,137 @@
+#ifndef SPEEDTEST_H
+#define SPEEDTEST_H
+
+// boost必须先于Qt包含：Qt的emit宏会破坏cancellation_signal::emit的声明
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TlsSession;
+class TlsSessionPool;
+namespace boost { namespace asio { namespace ssl { class context; } } }
+
+// 测速对象：扫描结果中的一个IP及其扫描延迟
+struct SpeedTestTarget {
+    QString ip;
+    double latencyMs = 0.0;
+};
+
+// 测速参数
+struct SpeedTestSpec {
+    QVector<SpeedTestTarget> targets;
+    QString url;               // 下载地址，或只填字节数（使用默认测速地址）
+    int parallelism = 2;       // 同时测速的IP数
+    int timeoutMs = 3000;      // 连接与TLS握手超时
+    int maxDurationMs = 10000; // 单个IP的最长下载时间，到时以已收数据计算
+};
+
+// 单个IP的测速结果
+struct SpeedTestResult {
+    QString ip;
+    double latencyMs = 0.0;    // 扫描延迟
+    bool success = false;      // 收到2xx响应且有正文数据
+    int httpStatus = 0;
+    uint64_t bytes = 0;        // 收到的正文字节数
+    double seconds = 0.0;      // 首个正文数据块之后的持续下载时间
+    double mbps = 0.0;         // 持续吞吐（Mbit/s），不含首个数据块
+    double score = 0.0;        // 延迟与带宽的综合评分，越高越好
+};
+Q_DECLARE_METATYPE(SpeedTestResult)
+
+// 解析后的下载地址
+struct SpeedTestUrl {
+    bool tls = false;
+    std::string host;          // Host头与SNI
+    uint16_t port = 80;
+    std::string target;        // 路径与查询
+};
+
+// 一次下载的测量数据，下载被截止时间打断时保留已收部分
+struct SpeedTestMeasurement {
+    int error = 0;
+    int status = 0;
+    uint64_t bodyBytes = 0;
+    uint64_t firstChunkBytes = 0; // 首个正文数据块，与起始时间同时到达，不计入吞吐
+    std::chrono::steady_clock::time_point firstByteAt;
+    std::chrono::steady_clock::time_point lastByteAt;
+};
+
+// 测速下载：固定大小的接收缓冲区循环复用，正文只计数不保存
+class SpeedTest
+{
+public:
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024; // 每个并发槽位的接收缓冲区
+    static constexpr double LATENCY_REFERENCE_MS = 100.0; // 综合评分中延迟的参考值
+    static constexpr const char* DEFAULT_URL = "https://speed.cloudflare.com/__down?bytes=";
+
+    // 解析下载地址；只填数字时视为字节数，使用默认测速地址
+    static bool resolveUrl(const QString& text, SpeedTestUrl& url, QString* error = nullptr);
+    static std::string buildRequest(const SpeedTestUrl& url);
+
+    // 综合评分：带宽按延迟折减，延迟等于参考值时评分为带宽的一半
+    static double combinedScore(double latencyMs, double mbps);
+    static double throughputMbps(const SpeedTestMeasurement& measurement);
+
+    // 在已连接（TLS时已握手）的连接上发送请求并读完正文，tls为空表示明文
+    static boost::asio::awaitable<void> download(boost::asio::ip::tcp::socket& socket, TlsSession* tls,
+                                                 const std::string& request, char* buffer,
+                                                 SpeedTestMeasurement& measurement);
+};
+
+// 测速任务：在独立的单线程io_context上对前K个IP依次下载，并发受槽位数限制；
+// 每个槽位持有一个缓冲区与取消信号，结果从测速线程发出
+class SpeedTestWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpeedTestWorker(QObject* parent = nullptr);
+    ~SpeedTestWorker(); // 取消并等待测速线程退出
+
+public slots:
+    void start(const SpeedTestSpec& spec);
+    void stop();
+
+signals:
+    void speedResult(const SpeedTestResult& result);
+    void progress(int completed, int total);
+    void logMessage(const QString& message);
+    void finished();
+
+private:
+    struct Slot {
+        std::unique_ptr<char[]> buffer;
+        boost::asio::cancellation_signal cancel;
+    };
+
+    // 在槽位上启动下一个IP的测速，没有剩余IP时槽位空闲
+    void launch(std::size_t slot);
+    boost::asio::awaitable<void> measure(SpeedTestTarget target, std::size_t slot);
+
+    // 槽位与SSL对象池须晚于io_context析构，未完成的协程销毁时仍会引用它们
+    std::vector<std::unique_ptr<Slot>> m_slots; // 缓冲区在多次测速之间复用
+    std::unique_ptr<boost::asio::ssl::context> m_tlsContext;
+    std::unique_ptr<TlsSessionPool> m_tlsPool;
+    boost::asio::io_context m_ioContext{1};
+    std::thread m_thread;
+
+    SpeedTestSpec m_spec;
+    SpeedTestUrl m_url;
+    std::string m_request;
+    int m_nextTarget = 0;   // 以下只在测速线程上访问
+    int m_completed = 0;
+    std::atomic<bool> m_stopping{false};
+};
+
+#endif // SPEEDTEST_H
@@ -0,0 +1,319 @@
+#include "threadplacement.h"
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+#include <set>
+#include <utility>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// 读取sysfs中的整数，文件不存在时返回fallback
+int readSysInt(const QString& path, int fallback)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return fallback;
+    bool ok = false;
+    int value = QString::fromLatin1(file.readAll()).trimmed().toInt(&ok);
+    return ok ? value : fallback;
+}
+#endif
+
+} // namespace
+
+const CpuTopology& CpuTopology::system()
+{
+    static const CpuTopology topology = []() {
+        CpuTopology result;
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            result.m_affinity = true;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (!CPU_ISSET(cpu, &allowed)) continue;
+                const QString base = QString("/sys/devices/system/cpu/cpu%1/topology/").arg(cpu);
+                CpuInfo info;
+                info.cpu = cpu;
+                info.core = readSysInt(base + "core_id", cpu);
+                info.package = readSysInt(base + "physical_package_id", 0);
+                result.m_cpus.push_back(info);
+            }
+        }
+        // 没有NUMA信息（单节点或未开启NUMA的内核）时全部视为节点0
+        QDir nodeDir("/sys/devices/system/node");
+        for (const QString& name : nodeDir.entryList(QStringList("node*"), QDir::Dirs)) {
+            bool ok = false;
+            int node = name.mid(4).toInt(&ok);
+            if (!ok) continue;
+            QFile list(nodeDir.filePath(name + "/cpulist"));
+            std::vector<int> cpus;
+            if (!list.open(QIODevice::ReadOnly) ||
+                !ThreadPlacement::parseCpuList(QString::fromLatin1(list.readAll()), cpus)) {
+                continue;
+            }
+            for (CpuInfo& info : result.m_cpus) {
+                if (std::binary_search(cpus.begin(), cpus.end(), info.cpu)) info.node = node;
+            }
+        }
+#elif defined(_WIN32)
+        // 只绑定第一个处理器组（最多64个逻辑CPU），不区分核心与节点
+        DWORD_PTR processMask = 0;
+        DWORD_PTR systemMask = 0;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+            result.m_affinity = true;
+            for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); ++cpu) {
+                if (!(processMask & (static_cast<DWORD_PTR>(1) << cpu))) continue;
+                CpuInfo info;
+                info.cpu = cpu;
+                info.core = cpu;
+                result.m_cpus.push_back(info);
+            }
+        }
+#endif
+        if (result.m_cpus.empty()) {
+            result.m_affinity = false;
+            int count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            for (int cpu = 0; cpu < count; ++cpu) {
+                CpuInfo info;
+                info.cpu = cpu;
+                info.core = cpu;
+                result.m_cpus.push_back(info);
+            }
+        }
+        return result;
+    }();
+    return topology;
+}
+
+std::vector<int> CpuTopology::allCpus() const
+{
+    std::vector<int> result;
+    for (const CpuInfo& info : m_cpus) {
+        result.push_back(info.cpu);
+    }
+    return result;
+}
+
+std::vector<int> CpuTopology::nodes() const
+{
+    std::set<int> nodes;
+    for (const CpuInfo& info : m_cpus) {
+        nodes.insert(info.node);
+    }
+    return std::vector<int>(nodes.begin(), nodes.end());
+}
+
+std::vector<int> CpuTopology::cpusOfNode(int node) const
+{
+    std::vector<int> result;
+    for (const CpuInfo& info : m_cpus) {
+        if (info.node == node) result.push_back(info.cpu);
+    }
+    return result;
+}
+
+const CpuInfo* CpuTopology::find(int cpu) const
+{
+    auto it = std::lower_bound(m_cpus.begin(), m_cpus.end(), cpu,
+                               [](const CpuInfo& info, int value) { return info.cpu < value; });
+    return it != m_cpus.end() && it->cpu == cpu ? &*it : nullptr;
+}
+
+QString CpuTopology::summary() const
+{
+    std::set<int> packages;
+    std::set<std::pair<int, int>> cores;
+    for (const CpuInfo& info : m_cpus) {
+        packages.insert(info.package);
+        cores.insert(std::make_pair(info.package, info.core));
+    }
+    const std::vector<int> nodeList = nodes();
+    QString text = QString("%1 个NUMA节点，%2 个插槽，%3 个核心，%4 个逻辑CPU")
+                       .arg(nodeList.size()).arg(packages.size()).arg(cores.size()).arg(m_cpus.size());
+    QStringList parts;
+    for (int node : nodeList) {
+        parts << QString("node%1: %2").arg(node).arg(ThreadPlacement::formatCpuList(cpusOfNode(node)));
+    }
+    text += "；" + parts.join("，");
+    if (!m_affinity) text += "（本平台不支持绑定）";
+    return text;
+}
+
+bool ThreadPlacement::parse(const QString& text, ThreadPlacement& placement, QString* error)
+{
+    const QString value = text.trimmed().toLower();
+    ThreadPlacement result;
+    if (value.isEmpty() || value == "none") {
+        result.mode = Mode::None;
+    } else if (value == "auto") {
+        result.mode = Mode::Auto;
+    } else if (value.startsWith("node:")) {
+        bool ok = false;
+        result.node = value.mid(5).trimmed().toInt(&ok);
+        if (!ok || result.node < 0) {
+            if (error) *error = QString("无效的NUMA节点：%1").arg(text.trimmed());
+            return false;
+        }
+        result.mode = Mode::Node;
+    } else if (parseCpuList(value, result.cpus)) {
+        result.mode = Mode::Cpus;
+    } else {
+        if (error) *error = QString("无法识别的CPU绑定：%1，应为 auto、node:N 或CPU列表（如 0-7,16）").arg(text.trimmed());
+        return false;
+    }
+    placement = std::move(result);
+    return true;
+}
+
+QString ThreadPlacement::toString() const
+{
+    switch (mode) {
+    case Mode::None: return "none";
+    case Mode::Auto: return "auto";
+    case Mode::Node: return QString("node:%1").arg(node);
+    case Mode::Cpus: return formatCpuList(cpus);
+    }
+    return QString();
+}
+
+std::vector<std::vector<int>> ThreadPlacement::assign(int count, const CpuTopology& topology) const
+{
+    std::vector<std::vector<int>> result;
+    if (!isActive() || !topology.supportsAffinity() || count <= 0) return result;
+
+    if (mode == Mode::Node) {
+        std::vector<int> cpus = topology.cpusOfNode(node);
+        if (!cpus.empty()) result.assign(count, cpus);
+        return result;
+    }
+
+    // 每个工作线程绑定到一个CPU，order为分配顺序
+    std::vector<int> order;
+    if (mode == Mode::Cpus) {
+        for (int cpu : cpus) {
+            if (topology.find(cpu)) order.push_back(cpu);
+        }
+    } else {
+        // auto：可用CPU最多的节点，先用各物理核心的第一个CPU，不够时再用超线程的兄弟CPU
+        int bestNode = 0;
+        std::size_t bestCount = 0;
+        for (int candidate : topology.nodes()) {
+            std::size_t size = topology.cpusOfNode(candidate).size();
+            if (size > bestCount) {
+                bestNode = candidate;
+                bestCount = size;
+            }
+        }
+        std::set<std::pair<int, int>> seenCores;
+        std::vector<int> siblings;
+        for (const CpuInfo& info : topology.cpus()) {
+            if (info.node != bestNode) continue;
+            if (seenCores.insert(std::make_pair(info.package, info.core)).second) {
+                order.push_back(info.cpu);
+            } else {
+                siblings.push_back(info.cpu);
+            }
+        }
+        // 物理核心有富余时空出第一个，界面与日志线程以及中断处理通常在那里
+        if (static_cast<int>(order.size()) > count) {
+            order.erase(order.begin());
+        }
+        order.insert(order.end(), siblings.begin(), siblings.end());
+    }
+    if (order.empty()) return result;
+
+    for (int i = 0; i < count; ++i) {
+        result.push_back({order[i % order.size()]});
+    }
+    return result;
+}
+
+std::vector<int> ThreadPlacement::remainder(const std::vector<std::vector<int>>& assignment,
+                                            const CpuTopology& topology)
+{
+    std::set<int> used;
+    for (const std::vector<int>& cpus : assignment) {
+        used.insert(cpus.begin(), cpus.end());
+    }
+    std::vector<int> result;
+    if (used.empty()) return result;
+    for (const CpuInfo& info : topology.cpus()) {
+        if (!used.count(info.cpu)) result.push_back(info.cpu);
+    }
+    return result;
+}
+
+bool ThreadPlacement::bindCurrentThread(const std::vector<int>& cpus)
+{
+    const CpuTopology& topology = CpuTopology::system();
+    if (!topology.supportsAffinity()) return false;
+    const std::vector<int> target = cpus.empty() ? topology.allCpus() : cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : target) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (int cpu : target) {
+        if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) mask |= static_cast<DWORD_PTR>(1) << cpu;
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    return false;
+#endif
+}
+
+QString ThreadPlacement::formatCpuList(const std::vector<int>& cpus)
+{
+    std::vector<int> sorted = cpus;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    QStringList parts;
+    for (std::size_t i = 0; i < sorted.size();) {
+        std::size_t j = i;
+        while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1) ++j;
+        parts << (j == i ? QString::number(sorted[i]) : QString("%1-%2").arg(sorted[i]).arg(sorted[j]));
+        i = j + 1;
+    }
+    return parts.join(",");
+}
+
+bool ThreadPlacement::parseCpuList(const QString& text, std::vector<int>& cpus)
+{
+    std::vector<int> result;
+    for (const QString& part : text.trimmed().split(',')) {
+        const QString item = part.trimmed();
+        if (item.isEmpty()) continue;
+        const QStringList bounds = item.split('-');
+        bool firstOk = false;
+        bool lastOk = false;
+        int first = bounds[0].trimmed().toInt(&firstOk);
+        int last = bounds.size() == 2 ? bounds[1].trimmed().toInt(&lastOk) : first;
+        if (bounds.size() == 1) lastOk = firstOk;
+        if (bounds.size() > 2 || !firstOk || !lastOk || first < 0 || last < first || last >= MAX_CPUS) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            result.push_back(cpu);
+        }
+    }
+    if (result.empty()) return false;
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    cpus = std::move(result);
+    return true;
+}
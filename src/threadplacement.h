@@ -0,0 +1,78 @@
+#ifndef THREADPLACEMENT_H
+#define THREADPLACEMENT_H
+
+#include <QString>
+#include <thread>
+#include <vector>
+
+// 一个逻辑CPU在拓扑中的位置
+struct CpuInfo {
+    int cpu = 0;      // 逻辑CPU编号
+    int core = 0;     // 所在物理核心（插槽内编号），超线程的兄弟CPU相同
+    int package = 0;  // 所在插槽
+    int node = 0;     // 所在NUMA节点
+};
+
+// 本进程可用的CPU拓扑。Linux读取/sys/devices/system，其他平台只知道逻辑CPU数，不支持绑定
+class CpuTopology
+{
+public:
+    // 首次调用时探测并缓存：之后界面线程可能被绑定到部分CPU，再探测会看不到全部可用CPU
+    static const CpuTopology& system();
+
+    const std::vector<CpuInfo>& cpus() const { return m_cpus; } // 按CPU编号升序
+    std::vector<int> allCpus() const;
+    std::vector<int> nodes() const;          // 出现过的NUMA节点，升序
+    std::vector<int> cpusOfNode(int node) const;
+    const CpuInfo* find(int cpu) const;
+    bool supportsAffinity() const { return m_affinity; }
+
+    // 拓扑概要，如“2 个NUMA节点，2 个插槽，32 个核心，64 个逻辑CPU；node0: 0-15,32-47 ...”
+    QString summary() const;
+
+private:
+    std::vector<CpuInfo> m_cpus;
+    bool m_affinity = false;
+};
+
+// 扫描工作线程的CPU绑定方式：
+//   none          不绑定（默认）
+//   auto          选可用CPU最多的NUMA节点，每个工作线程独占一个物理核心，
+//                 核心有富余时空出节点的第一个核心给界面与日志线程
+//   node:N        工作线程只在节点N的CPU上运行，节点内由内核调度
+//   0-7,16        工作线程依次绑定到列出的CPU，线程多于CPU时循环使用
+// 绑定后工作线程自己分配io_context与各线程缓冲区，按内核的首次访问策略落在本节点的内存上
+struct ThreadPlacement {
+    enum class Mode {
+        None,
+        Auto,
+        Node,
+        Cpus
+    };
+    Mode mode = Mode::None;
+    int node = 0;            // Node
+    std::vector<int> cpus;   // Cpus
+
+    bool isActive() const { return mode != Mode::None; }
+    // 解析上述写法，失败时返回false并在error中说明
+    static bool parse(const QString& text, ThreadPlacement& placement, QString* error = nullptr);
+    QString toString() const;
+
+    // 为count个工作线程分配CPU，每项为该线程允许运行的CPU；不绑定或平台不支持时返回空
+    std::vector<std::vector<int>> assign(int count, const CpuTopology& topology) const;
+    // 工作线程以外的可用CPU，供界面与日志线程使用；工作线程占满全部CPU时返回空（不限制）
+    static std::vector<int> remainder(const std::vector<std::vector<int>>& assignment,
+                                      const CpuTopology& topology);
+
+    // 把当前线程限制在cpus上，cpus为空时恢复为全部可用CPU；不支持的平台返回false。
+    // 只绑定调用线程：其他线程（如日志线程）由自己在合适的时机调用
+    static bool bindCurrentThread(const std::vector<int>& cpus);
+
+    // “0-3,8,10-11”形式的CPU列表
+    static QString formatCpuList(const std::vector<int>& cpus);
+    static bool parseCpuList(const QString& text, std::vector<int>& cpus);
+
+    static constexpr int MAX_CPUS = 4096; // CPU列表中允许的最大编号（不含）
+};
+
+#endif // THREADPLACEMENT_H
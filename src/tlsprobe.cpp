@@ -0,0 +1,172 @@
+#include "tlsprobe.h"
+#include "socketfactory.h"
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+TlsSession::TlsSession(SSL_CTX* context)
+    : m_ssl(SSL_new(context))
+{
+    if (!m_ssl) return;
+    m_input = BIO_new(BIO_s_mem());
+    m_output = BIO_new(BIO_s_mem());
+    if (!m_input || !m_output) {
+        BIO_free(m_input);
+        BIO_free(m_output);
+        SSL_free(m_ssl);
+        m_ssl = nullptr;
+        return;
+    }
+    // 输入BIO为空时返回“重试”而不是EOF
+    BIO_set_mem_eof_return(m_input, -1);
+    // 两个BIO的引用交给SSL，SSL_free时一并释放
+    SSL_set_bio(m_ssl, m_input, m_output);
+}
+
+TlsSession::~TlsSession()
+{
+    if (m_ssl) SSL_free(m_ssl);
+}
+
+// SSL_clear保留上下文设置但可能保留旧会话，显式清除以保证每次都是完整握手
+bool TlsSession::reset(const std::string& serverName)
+{
+    ERR_clear_error();
+    m_lastError = 0;
+    const char* hostName = serverName.empty() ? nullptr : serverName.c_str();
+    bool ready = m_ssl && SSL_clear(m_ssl) == 1;
+    if (ready) {
+        SSL_set_session(m_ssl, nullptr);
+        BIO_reset(m_input);
+        BIO_reset(m_output);
+        SSL_set_connect_state(m_ssl);
+        ready = SSL_set_tlsext_host_name(m_ssl, hostName) == 1;
+    }
+    if (!ready && m_ssl) {
+        m_lastError = ERR_peek_last_error();
+        SSL_free(m_ssl);
+        m_ssl = nullptr;
+    }
+    return ready;
+}
+
+TlsSession::Step TlsSession::step()
+{
+    int rc = SSL_do_handshake(m_ssl);
+    if (rc == 1) return Step::Done;
+    switch (SSL_get_error(m_ssl, rc)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE: // 内存BIO不会阻塞写，待发数据由调用方取走
+        return Step::WantRead;
+    default:
+        m_lastError = ERR_peek_last_error();
+        return Step::Failed;
+    }
+}
+
+std::size_t TlsSession::takeOutput()
+{
+    int n = BIO_read(m_output, m_buffer.data(), static_cast<int>(m_buffer.size()));
+    return n > 0 ? static_cast<std::size_t>(n) : 0;
+}
+
+bool TlsSession::feedInput(std::size_t n)
+{
+    return BIO_write(m_input, m_buffer.data(), static_cast<int>(n)) == static_cast<int>(n);
+}
+
+bool TlsSession::writeApplicationData(const char* data, std::size_t size)
+{
+    return SSL_write(m_ssl, data, static_cast<int>(size)) == static_cast<int>(size);
+}
+
+int TlsSession::readApplicationData(char* out, std::size_t size)
+{
+    int n = SSL_read(m_ssl, out, static_cast<int>(size));
+    if (n > 0) return n;
+    return SSL_get_error(m_ssl, n) == SSL_ERROR_WANT_READ ? 0 : -1;
+}
+
+TlsSessionPool::TlsSessionPool(boost::asio::ssl::context& context)
+    : m_context(context)
+{
+}
+
+std::unique_ptr<TlsSession> TlsSessionPool::acquire()
+{
+    if (!m_idle.empty()) {
+        std::unique_ptr<TlsSession> session = std::move(m_idle.back());
+        m_idle.pop_back();
+        return session;
+    }
+    return std::make_unique<TlsSession>(m_context.native_handle());
+}
+
+void TlsSessionPool::release(std::unique_ptr<TlsSession> session)
+{
+    if (session && session->isValid() && m_idle.size() < MAX_IDLE) {
+        m_idle.push_back(std::move(session));
+    }
+}
+
+std::unique_ptr<boost::asio::ssl::context> TlsProbe::createClientContext()
+{
+    auto context = std::make_unique<boost::asio::ssl::context>(boost::asio::ssl::context::tls_client);
+    SSL_CTX* native = context->native_handle();
+    SSL_CTX_set_min_proto_version(native, TLS1_3_VERSION);
+    SSL_CTX_set_options(native, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_OFF);
+    context->set_verify_mode(boost::asio::ssl::verify_none);
+    return context;
+}
+
+// 驱动握手：每步先把待发数据写到套接字，需要输入时读一次交给SSL，直到完成或失败
+boost::asio::awaitable<TlsHandshakeResult> TlsProbe::handshake(boost::asio::ip::tcp::socket& socket,
+                                                               TlsSession& session,
+                                                               const std::string& serverName,
+                                                               std::chrono::steady_clock::time_point connectStart)
+{
+    TlsHandshakeResult result;
+    if (!session.reset(serverName)) {
+        result.tlsReason = ERR_GET_REASON(session.lastError());
+        co_return result;
+    }
+
+    for (;;) {
+        TlsSession::Step step = session.step();
+
+        for (std::size_t n = session.takeOutput(); n > 0; n = session.takeOutput()) {
+            auto [writeError, written] = co_await boost::asio::async_write(
+                socket, boost::asio::buffer(session.buffer().data(), n),
+                boost::asio::as_tuple(boost::asio::use_awaitable));
+            if (writeError) {
+                result.error = SocketFactory::systemError(writeError);
+                co_return result;
+            }
+        }
+
+        if (step == TlsSession::Step::Done) {
+            result.success = true;
+            result.handshakeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - connectStart).count();
+            co_return result;
+        }
+        if (step == TlsSession::Step::Failed) {
+            result.tlsReason = ERR_GET_REASON(session.lastError());
+            co_return result;
+        }
+
+        auto [readError, n] = co_await socket.async_read_some(
+            boost::asio::buffer(session.buffer()), boost::asio::as_tuple(boost::asio::use_awaitable));
+        if (n > 0 && !session.feedInput(n)) {
+            result.tlsReason = ERR_GET_REASON(ERR_peek_last_error());
+            co_return result;
+        }
+        if (readError) {
+            result.error = SocketFactory::systemError(readError);
+            co_return result;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef TLSPROBE_H
+#define TLSPROBE_H
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 一次TLS握手的结果
+struct TlsHandshakeResult {
+    bool success = false;
+    int error = 0;                 // 系统错误码（读写失败、对端关闭）
+    int tlsReason = 0;             // OpenSSL原因码（协议或版本不匹配等）
+    double handshakeMs = 0.0;      // 从连接开始到握手完成
+};
+
+// 可复用的SSL对象：内存BIO由本对象持有，握手数据经固定缓冲区在套接字与BIO之间搬运
+class TlsSession
+{
+public:
+    static constexpr std::size_t BUFFER_SIZE = 4096; // 单次读写的缓冲区大小
+
+    // 握手推进一步后需要的操作
+    enum class Step {
+        Done,       // 握手完成
+        WantRead,   // 需要从套接字读取更多数据
+        Failed      // 握手失败
+    };
+
+    explicit TlsSession(SSL_CTX* context);
+    ~TlsSession();
+
+    TlsSession(const TlsSession&) = delete;
+    TlsSession& operator=(const TlsSession&) = delete;
+
+    bool isValid() const { return m_ssl != nullptr; }
+
+    // 为新连接准备：清除上一次的连接状态与残留数据，不恢复旧会话；失败时释放SSL，对象不再有效
+    bool reset(const std::string& serverName);
+
+    // 推进握手，之后先用takeOutput()取出并发送待发数据
+    Step step();
+    // 将待发送的握手数据取到buffer()中，返回字节数，0表示已取完
+    std::size_t takeOutput();
+    // 将从套接字收到的n字节（位于buffer()）交给SSL
+    bool feedInput(std::size_t n);
+
+    // 握手完成后加密应用数据，密文随后用takeOutput()取出
+    bool writeApplicationData(const char* data, std::size_t size);
+    // 解密已输入的数据到out，返回字节数；0表示需要更多输入，-1表示对端关闭或出错
+    int readApplicationData(char* out, std::size_t size);
+
+    std::array<char, BUFFER_SIZE>& buffer() { return m_buffer; }
+    unsigned long lastError() const { return m_lastError; }
+
+private:
+    SSL* m_ssl = nullptr;
+    BIO* m_input = nullptr;   // 套接字 -> SSL
+    BIO* m_output = nullptr;  // SSL -> 套接字
+    unsigned long m_lastError = 0;
+    std::array<char, BUFFER_SIZE> m_buffer;
+};
+
+// SSL对象池，每个工作线程一个，不加锁
+class TlsSessionPool
+{
+public:
+    static constexpr std::size_t MAX_IDLE = 256; // 空闲对象上限，超出的直接释放
+
+    explicit TlsSessionPool(boost::asio::ssl::context& context);
+
+    std::unique_ptr<TlsSession> acquire();
+    void release(std::unique_ptr<TlsSession> session);
+    std::size_t idleCount() const { return m_idle.size(); }
+
+private:
+    boost::asio::ssl::context& m_context;
+    std::vector<std::unique_ptr<TlsSession>> m_idle;
+};
+
+// 从对象池借出的SSL对象，析构时归还；协程被取消或销毁时同样归还
+class TlsSessionLease
+{
+public:
+    explicit TlsSessionLease(TlsSessionPool& pool) : m_pool(pool), m_session(pool.acquire()) {}
+    ~TlsSessionLease() { m_pool.release(std::move(m_session)); }
+
+    TlsSessionLease(const TlsSessionLease&) = delete;
+    TlsSessionLease& operator=(const TlsSessionLease&) = delete;
+
+    TlsSession& operator*() const { return *m_session; }
+    TlsSession* get() const { return m_session.get(); }
+
+private:
+    TlsSessionPool& m_pool;
+    std::unique_ptr<TlsSession> m_session;
+};
+
+// TLS握手探测
+class TlsProbe
+{
+public:
+    // 创建共享的客户端上下文：只允许TLS 1.3，禁用会话票据与会话缓存，使每次采样都是完整握手；
+    // 只测延迟，不校验证书
+    static std::unique_ptr<boost::asio::ssl::context> createClientContext();
+
+    // 用借出的SSL对象在已连接的套接字上完成一次握手，serverName为空时不发送SNI，时间相对于connectStart
+    static boost::asio::awaitable<TlsHandshakeResult> handshake(boost::asio::ip::tcp::socket& socket,
+                                                                TlsSession& session,
+                                                                const std::string& serverName,
+                                                                std::chrono::steady_clock::time_point connectStart);
+};
+
+#endif // TLSPROBE_H
@@ -0,0 +1,185 @@
+// cfping-history：查询CFPing的本地历史结果库
+//
+// 与界面共用HistoryStore，只读取已封存的段；输出为CSV，便于再交给脚本或cfping-merge处理。
+//   cfping-history [--dir <path>] runs
+//   cfping-history [--dir <path>] query <cidr|all> [--since <t>] [--until <t>] [--success] [--limit <n>]
+//   cfping-history [--dir <path>] best [--runs <n>] [--count <k>] [--min-samples <m>] [--subnet] [--cidr <c>]
+//   cfping-history [--dir <path>] prune --keep <n>
+// 时间可写作相对时间（30m、12h、7d，表示多久之前）或ISO日期时间（2024-05-01T08:00）
+#include "historystore.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct HistoryOptions {
+    QString directory = HistoryStore::defaultDirectory();
+    QString command;
+    QString cidr;
+    int64_t sinceMs = 0;
+    int64_t untilMs = 0;
+    bool successOnly = false;
+    int limit = 100000;
+    int runs = 10;
+    int count = 100;
+    int minSamples = 2;
+    bool subnet = false;
+    int keep = -1;
+};
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: cfping-history [--dir <path>] <command> [options]\n"
+                 "  runs                                  list sealed scans\n"
+                 "  query <cidr|all> [--since <t>] [--until <t>] [--success] [--limit <n>]\n"
+                 "  best [--runs <n>] [--count <k>] [--min-samples <m>] [--subnet] [--cidr <c>]\n"
+                 "  prune --keep <n>                      keep only the newest n scans\n"
+                 "  times are relative (30m, 12h, 7d ago) or ISO 8601\n");
+}
+
+// 相对时间（多久之前）或ISO日期时间，转换为Unix毫秒；无法解析时返回false
+bool parseTime(const char* text, int64_t& ms)
+{
+    char* end = nullptr;
+    double amount = std::strtod(text, &end);
+    if (end != text && end[0] != '\0' && end[1] == '\0') {
+        int64_t unit = 0;
+        switch (end[0]) {
+        case 's': unit = 1000; break;
+        case 'm': unit = 60 * 1000; break;
+        case 'h': unit = 3600 * 1000; break;
+        case 'd': unit = 86400 * 1000; break;
+        }
+        if (unit != 0 && amount >= 0) {
+            ms = QDateTime::currentMSecsSinceEpoch() - static_cast<int64_t>(amount * unit);
+            return true;
+        }
+    }
+    QDateTime time = QDateTime::fromString(QString::fromLocal8Bit(text), Qt::ISODate);
+    if (!time.isValid()) return false;
+    ms = time.toMSecsSinceEpoch();
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], HistoryOptions& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* arg = argv[i];
+        const char* value = nullptr;
+        if (std::strcmp(arg, "--dir") == 0 && (value = next())) {
+            options.directory = QString::fromLocal8Bit(value);
+        } else if (std::strcmp(arg, "--since") == 0 && (value = next())) {
+            if (!parseTime(value, options.sinceMs)) return false;
+        } else if (std::strcmp(arg, "--until") == 0 && (value = next())) {
+            if (!parseTime(value, options.untilMs)) return false;
+        } else if (std::strcmp(arg, "--success") == 0) {
+            options.successOnly = true;
+        } else if (std::strcmp(arg, "--limit") == 0 && (value = next())) {
+            options.limit = std::atoi(value);
+        } else if (std::strcmp(arg, "--runs") == 0 && (value = next())) {
+            options.runs = std::atoi(value);
+        } else if (std::strcmp(arg, "--count") == 0 && (value = next())) {
+            options.count = std::atoi(value);
+        } else if (std::strcmp(arg, "--min-samples") == 0 && (value = next())) {
+            options.minSamples = std::atoi(value);
+        } else if (std::strcmp(arg, "--subnet") == 0) {
+            options.subnet = true;
+        } else if (std::strcmp(arg, "--cidr") == 0 && (value = next())) {
+            options.cidr = QString::fromLocal8Bit(value);
+        } else if (std::strcmp(arg, "--keep") == 0 && (value = next())) {
+            options.keep = std::atoi(value);
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            return false;
+        } else if (options.command.isEmpty()) {
+            options.command = QString::fromLocal8Bit(arg);
+        } else if (options.command == "query" && options.cidr.isEmpty()) {
+            options.cidr = QString::fromLocal8Bit(arg);
+        } else {
+            return false;
+        }
+    }
+    if (options.command == "query") {
+        if (options.cidr.isEmpty()) return false;
+        if (options.cidr == "all") options.cidr.clear();
+    }
+    if (options.command == "prune" && options.keep < 0) return false;
+    return options.command == "runs" || options.command == "query" || options.command == "best" ||
+           options.command == "prune";
+}
+
+QByteArray isoTime(int64_t ms)
+{
+    return QDateTime::fromMSecsSinceEpoch(ms).toString(Qt::ISODate).toUtf8();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    HistoryOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    HistoryStore store(options.directory);
+    QString error;
+    if (!store.open(&error)) {
+        std::fprintf(stderr, "cannot open %s: %s\n", options.directory.toLocal8Bit().constData(),
+                     error.toLocal8Bit().constData());
+        return 1;
+    }
+
+    if (options.command == "runs") {
+        std::printf("run_id,started,finished,records,successes,label\n");
+        for (const HistoryRun& run : store.runs()) {
+            std::printf("%u,%s,%s,%llu,%llu,%s\n", run.runId, isoTime(run.startedMs).constData(),
+                        isoTime(run.finishedMs).constData(), static_cast<unsigned long long>(run.recordCount),
+                        static_cast<unsigned long long>(run.successCount), run.label.toUtf8().constData());
+        }
+    } else if (options.command == "query") {
+        HistoryQuery query;
+        query.cidr = options.cidr;
+        query.fromMs = options.sinceMs;
+        query.toMs = options.untilMs;
+        query.successOnly = options.successOnly;
+        query.maxRecords = options.limit;
+        const QVector<HistoryRecord> records = store.query(query);
+        std::printf("ip,time,run_id,success,latency_ms,port,colo\n");
+        for (const HistoryRecord& record : records) {
+            std::printf("%s,%s,%u,%d,%.1f,%u,%s\n", record.ipString().toUtf8().constData(),
+                        isoTime(record.timeMs).constData(), record.runId, record.success() ? 1 : 0,
+                        record.latencyMs, record.port, record.coloString().toUtf8().constData());
+        }
+        if (records.size() >= options.limit) {
+            std::fprintf(stderr, "stopped at %d records (--limit)\n", options.limit);
+        }
+    } else if (options.command == "best") {
+        HistoryBestQuery query;
+        query.lastRuns = options.runs;
+        query.count = options.count;
+        query.minSamples = options.minSamples;
+        query.cidr = options.cidr;
+        if (options.subnet) {
+            query.ipv4Prefix = 24;
+            query.ipv6Prefix = 48;
+        }
+        std::printf("key,runs,samples,success_rate,median_ms,jitter_ms,last_ms,score\n");
+        for (const HistoryStability& stats : store.best(query)) {
+            std::printf("%s,%d,%d,%.3f,%.1f,%.1f,%.1f,%.1f\n", stats.key.toUtf8().constData(), stats.runs,
+                        stats.samples, stats.successRate, stats.medianMs, stats.jitterMs, stats.lastLatencyMs,
+                        stats.score);
+        }
+    } else if (options.command == "prune") {
+        int removed = store.prune(options.keep);
+        std::fprintf(stderr, "removed %d scans, kept the newest %d\n", removed, options.keep);
+    }
+    return 0;
+}
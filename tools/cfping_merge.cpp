@@ -0,0 +1,199 @@
+// cfping-merge：把多台机器（或多个分片）保存的CSV结果合并为一个按延迟排序的排名
+//
+// 每个输入文件已按延迟升序（CFPing保存的CSV即是如此），合并时每个文件只保留当前一行，
+// 用最小堆做k路归并，内存占用与文件大小无关；输出格式与输入相同，可以再次合并。
+// 例外：--unique要记住已输出的IP，内存随输出行数增长，同时指定--top <k>时最多k个。
+// 行按原文输出，各输入的表头（列）必须相同，不同版本保存的CSV不能直接合并。
+//   cfping-merge [--top <k>] [--unique] [-o <out.csv>] a.csv b.csv ...
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+struct MergeOptions {
+    std::vector<std::string> inputs;
+    std::string output;        // 为空时写到标准输出
+    uint64_t top = 0;          // 只输出前K行，0为全部
+    bool unique = false;       // 同一IP只保留延迟最低的一行（多个观测点扫描同一地址段时），内存随输出行数增长
+};
+
+// 一个输入文件的读取游标，只持有当前一行
+struct MergeInput {
+    std::string path;
+    std::ifstream stream;
+    uint64_t lineNumber = 0;
+    std::string line;          // 当前行原文
+    std::string header;        // 文件的表头行，列数随版本可能不同
+    std::string ip;
+    double latencyMs = 0.0;
+};
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: cfping-merge [--top <k>] [--unique] [-o <out.csv>] <results.csv>...\n"
+                 "  inputs are CFPing CSV results (ip,latency_ms,...) sorted by latency, all with the same header\n"
+                 "  --unique remembers every IP written; combine it with --top to bound memory\n");
+}
+
+bool parseOptions(int argc, char* argv[], MergeOptions& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* arg = argv[i];
+        const char* value = nullptr;
+        if (std::strcmp(arg, "--top") == 0 && (value = next())) {
+            options.top = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--unique") == 0) {
+            options.unique = true;
+        } else if ((std::strcmp(arg, "-o") == 0 || std::strcmp(arg, "--output") == 0) && (value = next())) {
+            options.output = value;
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            return false;
+        } else {
+            options.inputs.emplace_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+// 读取下一条记录，跳过空行、注释与表头；格式错误或未按延迟升序时报告并返回false
+bool advance(MergeInput& input, bool& ok)
+{
+    const double previous = input.latencyMs;
+    while (std::getline(input.stream, input.line)) {
+        ++input.lineNumber;
+        if (!input.line.empty() && input.line.back() == '\r') input.line.pop_back();
+        if (input.line.empty() || input.line[0] == '#') continue;
+        if (input.line.rfind("ip,", 0) == 0) {
+            if (input.header.empty()) {
+                input.header = input.line;
+            } else if (input.line != input.header) {
+                std::fprintf(stderr, "%s:%llu: header differs from the one earlier in the file\n", input.path.c_str(),
+                             static_cast<unsigned long long>(input.lineNumber));
+                ok = false;
+                return false;
+            }
+            continue;
+        }
+
+        std::size_t comma = input.line.find(',');
+        char* end = nullptr;
+        double latency = comma == std::string::npos ? 0.0 : std::strtod(input.line.c_str() + comma + 1, &end);
+        if (comma == 0 || comma == std::string::npos || end == input.line.c_str() + comma + 1) {
+            std::fprintf(stderr, "%s:%llu: expected ip,latency_ms\n", input.path.c_str(),
+                         static_cast<unsigned long long>(input.lineNumber));
+            ok = false;
+            return false;
+        }
+        if (latency < previous) {
+            std::fprintf(stderr, "%s:%llu: not sorted by latency\n", input.path.c_str(),
+                         static_cast<unsigned long long>(input.lineNumber));
+            ok = false;
+            return false;
+        }
+        input.ip.assign(input.line, 0, comma);
+        input.latencyMs = latency;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    MergeOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<MergeInput>> inputs;
+    for (const std::string& path : options.inputs) {
+        auto input = std::make_unique<MergeInput>();
+        input->path = path;
+        input->stream.open(path);
+        if (!input->stream) {
+            std::fprintf(stderr, "cannot open %s\n", path.c_str());
+            return 1;
+        }
+        inputs.push_back(std::move(input));
+    }
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::fprintf(stderr, "cannot write %s\n", options.output.c_str());
+            return 1;
+        }
+    }
+    std::ostream& out = options.output.empty() ? std::cout : file;
+
+    // 最小堆按(延迟, 输入序号)排序，延迟相同时按输入顺序输出，结果可复现
+    auto later = [&inputs](std::size_t a, std::size_t b) {
+        if (inputs[a]->latencyMs != inputs[b]->latencyMs) return inputs[a]->latencyMs > inputs[b]->latencyMs;
+        return a > b;
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heap(later);
+    bool ok = true;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        if (advance(*inputs[i], ok)) heap.push(i);
+        if (!ok) return 1;
+    }
+
+    // 行按原文输出，列不同的文件会错位：各输入的表头（读到第一条记录时已读过）必须一致，
+    // 都没有表头时按默认列输出；空文件（无表头也无记录）不参与比较
+    std::vector<bool> hasRecord(inputs.size(), false);
+    for (auto rest = heap; !rest.empty(); rest.pop()) hasRecord[rest.top()] = true;
+    std::string header;
+    const MergeInput* headerSource = nullptr;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        const auto& input = inputs[i];
+        if (input->header.empty() && !hasRecord[i]) continue;
+        if (!headerSource) {
+            header = input->header;
+            headerSource = input.get();
+        } else if (input->header != header) {
+            std::fprintf(stderr, "%s and %s have different headers (\"%s\" vs \"%s\"); merge files saved with the same columns\n",
+                         headerSource->path.c_str(), input->path.c_str(), header.c_str(), input->header.c_str());
+            return 1;
+        }
+    }
+    if (header.empty()) header = "ip,latency_ms,port,colo";
+
+    out << "# CloudFlare CDN IP测试结果，按延迟升序（合并自" << inputs.size() << "个文件）\n";
+    out << header << '\n';
+
+    std::unordered_set<std::string> seen; // 只在--unique时使用，最多为已输出的行数
+    uint64_t written = 0;
+    uint64_t duplicates = 0;
+    while (!heap.empty() && (options.top == 0 || written < options.top)) {
+        std::size_t index = heap.top();
+        heap.pop();
+        MergeInput& input = *inputs[index];
+        if (options.unique && !seen.insert(input.ip).second) {
+            ++duplicates;
+        } else {
+            out << input.line << '\n';
+            ++written;
+        }
+        if (advance(input, ok)) heap.push(index);
+        if (!ok) return 1;
+    }
+    out.flush();
+
+    std::fprintf(stderr, "merged %zu files: %llu rows written, %llu duplicates skipped\n", inputs.size(),
+                 static_cast<unsigned long long>(written), static_cast<unsigned long long>(duplicates));
+    return out ? 0 : 1;
+}
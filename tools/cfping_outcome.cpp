@@ -0,0 +1,118 @@
+// cfping-outcome：查询与比较CFPing保存的扫描结果位图（.cfmap）
+//
+// 位图记录了一次扫描中每个IPv4地址是否探测过、是否可达，导出时合并为最少的CIDR，每行一个：
+//   cfping-outcome stats <map>...
+//   cfping-outcome reachable|unreachable|untested <map>...   多个文件（如各分片）先合并
+//   cfping-outcome newly-dead|newly-alive <before> <after>
+//   cfping-outcome merge -o <out> <map>...
+#include "scanoutcome.h"
+#include <QCoreApplication>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: cfping-outcome <command> <map>...\n"
+                 "  stats <map>...                           counts and memory per file\n"
+                 "  reachable|unreachable|untested <map>...  coalesced CIDRs of the merged maps\n"
+                 "  newly-dead|newly-alive <before> <after>  addresses whose outcome flipped\n"
+                 "  merge -o <out> <map>...                  union of several maps (e.g. shards)\n");
+}
+
+bool loadMap(const char* path, ScanOutcome& outcome)
+{
+    QString error;
+    if (!outcome.load(QString::fromLocal8Bit(path), &error)) {
+        std::fprintf(stderr, "cannot read %s: %s\n", path, error.toLocal8Bit().constData());
+        return false;
+    }
+    return true;
+}
+
+void printCidrs(const RoaringBitmap& bitmap)
+{
+    for (const QString& cidr : ScanOutcome::toCidrs(bitmap)) {
+        std::printf("%s\n", cidr.toLatin1().constData());
+    }
+    std::fprintf(stderr, "%llu addresses\n", static_cast<unsigned long long>(bitmap.cardinality()));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+
+    const char* command = argv[1];
+    if (std::strcmp(command, "stats") == 0) {
+        std::printf("file,scope,tested,reachable,unreachable,untested,memory_bytes\n");
+        for (int i = 2; i < argc; ++i) {
+            ScanOutcome outcome;
+            if (!loadMap(argv[i], outcome)) return 1;
+            std::printf("%s,%llu,%llu,%llu,%llu,%llu,%zu\n", argv[i],
+                        static_cast<unsigned long long>(outcome.scope().cardinality()),
+                        static_cast<unsigned long long>(outcome.tested().cardinality()),
+                        static_cast<unsigned long long>(outcome.reachable().cardinality()),
+                        static_cast<unsigned long long>(outcome.unreachable().cardinality()),
+                        static_cast<unsigned long long>(outcome.untested().cardinality()),
+                        outcome.memoryBytes());
+        }
+        return 0;
+    }
+
+    if (std::strcmp(command, "newly-dead") == 0 || std::strcmp(command, "newly-alive") == 0) {
+        ScanOutcome before;
+        ScanOutcome after;
+        if (argc != 4) {
+            usage();
+            return 2;
+        }
+        if (!loadMap(argv[2], before) || !loadMap(argv[3], after)) return 1;
+        printCidrs(std::strcmp(command, "newly-dead") == 0 ? ScanOutcome::newlyDead(before, after)
+                                                            : ScanOutcome::newlyAlive(before, after));
+        return 0;
+    }
+
+    int first = 2;
+    const char* output = nullptr;
+    if (std::strcmp(command, "merge") == 0) {
+        if (argc < 5 || std::strcmp(argv[2], "-o") != 0) {
+            usage();
+            return 2;
+        }
+        output = argv[3];
+        first = 4;
+    }
+    ScanOutcome merged;
+    for (int i = first; i < argc; ++i) {
+        ScanOutcome outcome;
+        if (!loadMap(argv[i], outcome)) return 1;
+        merged.merge(outcome);
+    }
+
+    if (output) {
+        QString error;
+        if (!merged.save(QString::fromLocal8Bit(output), &error)) {
+            std::fprintf(stderr, "cannot write %s: %s\n", output, error.toLocal8Bit().constData());
+            return 1;
+        }
+    } else if (std::strcmp(command, "reachable") == 0) {
+        printCidrs(merged.reachable());
+    } else if (std::strcmp(command, "unreachable") == 0) {
+        // 多个分片合并后，某地址只要在任一文件中可达即视为可达
+        printCidrs(merged.unreachable());
+    } else if (std::strcmp(command, "untested") == 0) {
+        printCidrs(merged.untested());
+    } else {
+        usage();
+        return 2;
+    }
+    return 0;
+}